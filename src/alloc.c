@@ -0,0 +1,338 @@
+#include "alloc.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Forwards to malloc() of the C standard library.
+ */
+static void *
+_std_malloc(void *data, size_t size)
+{
+    (void) data;
+    return malloc(size);
+}
+
+/**
+ * Forwards to realloc() of the C standard library.
+ */
+static void *
+_std_realloc(void *data, void *ptr, size_t size)
+{
+    (void) data;
+    return realloc(ptr, size);
+}
+
+/**
+ * Forwards to free() of the C standard library.
+ */
+static void
+_std_free(void *data, void *ptr)
+{
+    (void) data;
+    free(ptr);
+}
+
+/**
+ * Allocator in use.
+ */
+static Allocator active = {_std_malloc, _std_realloc, _std_free, NULL};
+
+/**
+ * Names of subsystems (for output).
+ */
+static const char *const NAMES[ALLOC_NUM_SUBSYSTEMS] = {
+  [ALLOC_TUBE] = "tube",     [ALLOC_GAME] = "game",
+  [ALLOC_LOG] = "log",       [ALLOC_INPUT] = "input",
+  [ALLOC_SOLVER] = "solver", [ALLOC_CACHE] = "cache",
+  [ALLOC_CORPUS] = "corpus", [ALLOC_PROFILE] = "profile",
+};
+
+#ifdef TUBES_ALLOC_STATS
+/**
+ * Auxiliary header in front of every block (aligned for any type).
+ */
+typedef union {
+    struct {
+        size_t size;
+        int subsystem;
+        bool is_tracked; /* counted on allocation (thus also on free)? */
+    } info;
+    long double align_ld;
+    long long align_ll;
+    void *align_p;
+} AllocHeader;
+
+/**
+ * Counters per subsystem (totals are summed up when read, except for the peak
+ * which needs the current total below).
+ */
+static AllocStats counters[ALLOC_NUM_SUBSYSTEMS];
+static long total_current;
+static long total_peak;
+static bool is_tracking;
+
+/**
+ * Adds `value` to `*p` (atomically if supported) and returns the new value.
+ *
+ * @param[in,out] p pointer to counter
+ * @param[in] value value to add
+ *
+ * @return New value of counter
+ */
+static long
+_add(long *p, long value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_add_fetch(p, value, __ATOMIC_RELAXED);
+#else
+    return *p += value;
+#endif
+}
+
+/**
+ * Raises `*p` to `value` if smaller (atomically if supported).
+ *
+ * @param[in,out] p pointer to counter
+ * @param[in] value candidate maximum
+ */
+static void
+_max(long *p, long value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    long old = __atomic_load_n(p, __ATOMIC_RELAXED);
+    while (old < value
+           && !__atomic_compare_exchange_n(
+             p, &old, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED
+           )) {
+    }
+#else
+    if (*p < value) {
+        *p = value;
+    }
+#endif
+}
+
+/**
+ * Returns if allocations are currently counted.
+ *
+ * @return Is tracking enabled?
+ */
+static bool
+_is_tracking(void)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(&is_tracking, __ATOMIC_RELAXED);
+#else
+    return is_tracking;
+#endif
+}
+
+/**
+ * Accounts allocation (positive `delta`) or free (negative `delta`) of
+ * `subsystem`.
+ *
+ * @param[in] subsystem subsystem enumerator
+ * @param[in] delta change of current bytes
+ */
+static void
+_account(int subsystem, long delta)
+{
+    AllocStats *const stats = &counters[subsystem];
+    if (delta >= 0) {
+        _add(&stats->allocs, 1);
+        _add(&stats->bytes, delta);
+    } else {
+        _add(&stats->frees, 1);
+    }
+    _max(&stats->peak, _add(&stats->current, delta));
+    _max(&total_peak, _add(&total_current, delta));
+}
+#endif
+
+/**
+ * Prints `stats` as JSON object to `out`.
+ *
+ * @param[in] out output FILE stream
+ * @param[in] stats AllocStats to print
+ */
+static void
+_fprint_stats(FILE *out, const AllocStats *stats)
+{
+    fprintf(
+      out,
+      "{\"allocs\":%li,\"frees\":%li,\"bytes\":%li,\"current\":%li,"
+      "\"peak\":%li}",
+      stats->allocs, stats->frees, stats->bytes, stats->current, stats->peak
+    );
+}
+
+void
+Alloc_set_allocator(const Allocator *allocator)
+{
+    if (allocator == NULL) {
+        active.malloc = _std_malloc;
+        active.realloc = _std_realloc;
+        active.free = _std_free;
+        active.data = NULL;
+        return;
+    }
+    active = *allocator;
+}
+
+void *
+Alloc_malloc(int subsystem, size_t size)
+{
+#ifdef TUBES_ALLOC_STATS
+    AllocHeader *header = active.malloc(active.data, sizeof *header + size);
+    if (header == NULL) {
+        return NULL;
+    }
+    header->info.size = size;
+    header->info.subsystem = subsystem;
+    header->info.is_tracked = _is_tracking();
+    if (header->info.is_tracked == true) {
+        _account(subsystem, (long) size);
+    }
+    return header + 1;
+#else
+    (void) subsystem;
+    return active.malloc(active.data, size);
+#endif
+}
+
+void *
+Alloc_calloc(int subsystem, size_t count, size_t size)
+{
+    if (size != 0 && count > (size_t) -1 / size) {
+        return NULL;
+    }
+    void *ptr = Alloc_malloc(subsystem, count * size);
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void *
+Alloc_realloc(int subsystem, void *ptr, size_t size)
+{
+#ifdef TUBES_ALLOC_STATS
+    if (ptr == NULL) {
+        return Alloc_malloc(subsystem, size);
+    }
+    AllocHeader *header = (AllocHeader *) ptr - 1;
+    const size_t old_size = header->info.size;
+    header = active.realloc(active.data, header, sizeof *header + size);
+    if (header == NULL) {
+        return NULL;
+    }
+    /* Counted as free of old and allocation of new block */
+    if (header->info.is_tracked == true) {
+        _account(header->info.subsystem, -(long) old_size);
+    }
+    header->info.size = size;
+    header->info.is_tracked = _is_tracking();
+    if (header->info.is_tracked == true) {
+        _account(header->info.subsystem, (long) size);
+    }
+    return header + 1;
+#else
+    (void) subsystem;
+    return active.realloc(active.data, ptr, size);
+#endif
+}
+
+void
+Alloc_free(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+#ifdef TUBES_ALLOC_STATS
+    AllocHeader *header = (AllocHeader *) ptr - 1;
+    if (header->info.is_tracked == true) {
+        _account(header->info.subsystem, -(long) header->info.size);
+    }
+    active.free(active.data, header);
+#else
+    active.free(active.data, ptr);
+#endif
+}
+
+void
+Alloc_set_tracking(bool is_enabled)
+{
+#ifdef TUBES_ALLOC_STATS
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_store_n(&is_tracking, is_enabled, __ATOMIC_RELAXED);
+#else
+    is_tracking = is_enabled;
+#endif
+#else
+    (void) is_enabled;
+#endif
+}
+
+void
+Alloc_reset_peak(void)
+{
+#ifdef TUBES_ALLOC_STATS
+#if defined(__GNUC__) || defined(__clang__)
+    for (int i = 0; i < ALLOC_NUM_SUBSYSTEMS; ++i) {
+        __atomic_store_n(
+          &counters[i].peak,
+          __atomic_load_n(&counters[i].current, __ATOMIC_RELAXED),
+          __ATOMIC_RELAXED
+        );
+    }
+    __atomic_store_n(
+      &total_peak, __atomic_load_n(&total_current, __ATOMIC_RELAXED),
+      __ATOMIC_RELAXED
+    );
+#else
+    for (int i = 0; i < ALLOC_NUM_SUBSYSTEMS; ++i) {
+        counters[i].peak = counters[i].current;
+    }
+    total_peak = total_current;
+#endif
+#endif
+}
+
+void
+Alloc_get_stats(int subsystem, AllocStats *stats)
+{
+#ifdef TUBES_ALLOC_STATS
+    if (subsystem < ALLOC_NUM_SUBSYSTEMS) {
+        *stats = counters[subsystem];
+        return;
+    }
+    memset(stats, 0, sizeof *stats);
+    for (int i = 0; i < ALLOC_NUM_SUBSYSTEMS; ++i) {
+        stats->allocs += counters[i].allocs;
+        stats->frees += counters[i].frees;
+        stats->bytes += counters[i].bytes;
+    }
+    stats->current = total_current;
+    stats->peak = total_peak;
+#else
+    (void) subsystem;
+    memset(stats, 0, sizeof *stats);
+#endif
+}
+
+void
+Alloc_fprint_json(FILE *out)
+{
+    AllocStats stats;
+    Alloc_get_stats(ALLOC_NUM_SUBSYSTEMS, &stats);
+    fprintf(out, "{\"total\":");
+    _fprint_stats(out, &stats);
+    for (int i = 0; i < ALLOC_NUM_SUBSYSTEMS; ++i) {
+        Alloc_get_stats(i, &stats);
+        fprintf(out, ",\"%s\":", NAMES[i]);
+        _fprint_stats(out, &stats);
+    }
+    fprintf(out, "}\n");
+}
@@ -0,0 +1,151 @@
+/** alloc.h
+ *
+ * Header for the allocation layer of 'tubes'. All allocations of the library go
+ * through the functions below, which forward them to an (injectable) Allocator
+ * and attribute them to a subsystem.
+ *
+ * If compiled with TUBES_ALLOC_STATS, every block carries a small header with
+ * its size and subsystem. While tracking is enabled (see Alloc_set_tracking()),
+ * the number of allocations and frees, allocated bytes, current bytes and peak
+ * bytes are counted per subsystem (with atomic updates on GCC and Clang, so the
+ * counts are exact with several threads). Blocks allocated while tracking was
+ * enabled are also counted when freed, so tracking may be enabled for parts of
+ * a run only. Otherwise, the calls are plain forwards and all counters stay
+ * zero.
+ */
+
+#ifndef ALLOC_H_INCLUDED
+#define ALLOC_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Subsystem enumerator (for attribution of allocations).
+ */
+enum {
+    ALLOC_TUBE,
+    ALLOC_GAME,
+    ALLOC_LOG,
+    ALLOC_INPUT,
+    ALLOC_SOLVER,
+    ALLOC_CACHE,
+    ALLOC_CORPUS,
+    ALLOC_PROFILE,
+    ALLOC_NUM_SUBSYSTEMS,
+};
+
+/**
+ * Struct for (custom) allocator. The functions have the semantics of their C
+ * standard library counterparts and get `data` as first argument.
+ */
+typedef struct {
+    void *(*malloc)(void *data, size_t size);
+    void *(*realloc)(void *data, void *ptr, size_t size);
+    void (*free)(void *data, void *ptr);
+    void *data;
+} Allocator;
+
+/**
+ * Struct for allocation counters (of a subsystem or in total).
+ */
+typedef struct {
+    long allocs;  /* number of allocations (including reallocs) */
+    long frees;   /* number of frees */
+    long bytes;   /* bytes allocated in total */
+    long current; /* bytes currently allocated */
+    long peak;    /* maximum of `current` */
+} AllocStats;
+
+/**
+ * Sets allocator used by all subsequent allocations (NULL for the C standard
+ * library). Must be called before any object of the library is created, as
+ * blocks must be freed by the allocator that allocated them.
+ *
+ * @param[in] allocator Allocator to use (copied)
+ */
+void
+Alloc_set_allocator(const Allocator *allocator);
+
+/**
+ * Allocates `size` bytes for subsystem `subsystem`.
+ *
+ * @param[in] subsystem subsystem enumerator
+ * @param[in] size number of bytes
+ *
+ * @return Pointer to allocated memory (or NULL on error)
+ */
+void *
+Alloc_malloc(int subsystem, size_t size);
+
+/**
+ * Allocates zero-initialized array of `count` elements of size `size` for
+ * subsystem `subsystem`.
+ *
+ * @param[in] subsystem subsystem enumerator
+ * @param[in] count number of elements
+ * @param[in] size size of element
+ *
+ * @return Pointer to allocated memory (or NULL on error)
+ */
+void *
+Alloc_calloc(int subsystem, size_t count, size_t size);
+
+/**
+ * Resizes block `ptr` (allocated by this layer or NULL) to `size` bytes for
+ * subsystem `subsystem`.
+ *
+ * @param[in] subsystem subsystem enumerator
+ * @param[in] ptr block to resize
+ * @param[in] size new number of bytes
+ *
+ * @return Pointer to resized memory (or NULL on error, `ptr` is still valid)
+ */
+void *
+Alloc_realloc(int subsystem, void *ptr, size_t size);
+
+/**
+ * Frees block `ptr` (allocated by this layer or NULL).
+ *
+ * @param[in] ptr block to free
+ */
+void
+Alloc_free(void *ptr);
+
+/**
+ * Enables or disables counting of allocations (disabled by default, as the
+ * atomic updates are not free).
+ *
+ * @param[in] is_enabled count allocations?
+ */
+void
+Alloc_set_tracking(bool is_enabled);
+
+/**
+ * Lowers the peak counters (of all subsystems and in total) to the current
+ * numbers of bytes, so a following Alloc_get_stats() reports the peak since
+ * this call (e.g., of a single phase).
+ */
+void
+Alloc_reset_peak(void);
+
+/**
+ * Writes counters of subsystem `subsystem` (or the total counters if
+ * `subsystem` is ALLOC_NUM_SUBSYSTEMS) to `stats`.
+ *
+ * @param[in] subsystem subsystem enumerator
+ * @param[out] stats AllocStats to write to
+ */
+void
+Alloc_get_stats(int subsystem, AllocStats *stats);
+
+/**
+ * Prints total and per-subsystem counters as single-line JSON object to `out`.
+ *
+ * @param[in] out output FILE stream
+ */
+void
+Alloc_fprint_json(FILE *out);
+
+#endif /* ALLOC_H_INCLUDED */
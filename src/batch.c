@@ -0,0 +1,521 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "batch.h"
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bulk.h"
+#include "corpus.h"
+#include "gameinfo.h"
+#include "json.h"
+#include "queue.h"
+#include "segment.h"
+#include "util.h"
+
+#define BATCH_QUEUE_CAPACITY 256
+#define BATCH_LINE_BUFFER_SIZE 4096
+#define BATCH_SEGMENT_FLUSH_INTERVAL 64
+
+/**
+ * Auxiliary struct for a single game passing through the pipeline.
+ */
+typedef struct {
+    long id;
+    unsigned int seed;
+    char *filename;         /* NULL for games from seed or corpus */
+    const char *corpusname; /* NULL for games from seed or file */
+    GameInfo *info;
+    SolverResult result;
+    double parse_ms;
+    double solve_ms;
+} BatchJob;
+
+/**
+ * Destroys `job` and frees memory.
+ *
+ * @param[in] job BatchJob to be destroyed
+ */
+static void
+BatchJob_destroy(BatchJob *job)
+{
+    if (job == NULL) {
+        return;
+    }
+
+    GameInfo_destroy(job->info);
+    free(job->filename);
+
+    free(job);
+}
+
+/**
+ * Auxiliary struct for shared state of pipeline.
+ */
+typedef struct {
+    const BatchOptions *opts;
+    FILE *out;
+    FILE *list;
+    Corpus *corpus;
+    FILE *segment;
+    IdSet *done;
+    Queue *to_solve;
+    Queue *to_write;
+    DeadTable *dead;       /* boards proven unsolvable (all sizes) */
+    pthread_mutex_t mutex; /* for accumulating statistics */
+    int num_traces;        /* number of search traces opened (under mutex) */
+} Batch;
+
+/**
+ * Returns if game with id `id` is to be solved by this run of `batch`.
+ *
+ * @param[in] batch Batch to check
+ * @param[in] id id of game
+ *
+ * @return Is game to be solved?
+ */
+static bool
+Batch_is_due(const Batch *batch, long id)
+{
+    const BatchOptions *const opts = batch->opts;
+    if (opts->num_shards > 0 && id % opts->num_shards != opts->shard_index) {
+        return false;
+    }
+    if (batch->done != NULL && IdSet_contains(batch->done, id) == true) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Returns monotonic wall time in milliseconds.
+ *
+ * @return Current time in milliseconds
+ */
+static double
+_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+/**
+ * Reads next filename from list `in` (skipping blank lines and comments).
+ *
+ * @param[in] in list FILE stream
+ *
+ * @return Newly allocated filename or NULL at end of list
+ */
+static char *
+_read_filename(FILE *in)
+{
+    char buffer[BATCH_LINE_BUFFER_SIZE];
+    while (fgets(buffer, sizeof buffer, in) != NULL) {
+        size_t len = strlen(buffer);
+        while (len > 0 && isspace((unsigned char) buffer[len - 1])) {
+            buffer[--len] = '\0';
+        }
+        if (len == 0 || buffer[0] == '#') {
+            continue;
+        }
+        char *filename = malloc(len + 1);
+        memcpy(filename, buffer, len + 1);
+        return filename;
+    }
+    return NULL;
+}
+
+/**
+ * Parser stage: creates games and passes them on to the solvers.
+ *
+ * @param[in] arg pointer to Batch
+ *
+ * @return NULL
+ */
+static void *
+_parser(void *arg)
+{
+    Batch *const batch = arg;
+    const BatchOptions *const opts = batch->opts;
+
+    long id = 0;
+    unsigned int seed = opts->seed_first;
+    for (;;) {
+        BatchJob *job = calloc(1, sizeof *job);
+        job->id = id;
+        const double start = _now_ms();
+        if (batch->list != NULL) {
+            job->filename = _read_filename(batch->list);
+            if (job->filename == NULL) {
+                BatchJob_destroy(job);
+                break;
+            }
+            if (Batch_is_due(batch, id) == true) {
+                job->info = GameInfo_create_from_file(job->filename, NULL);
+            }
+        } else if (batch->corpus != NULL) {
+            if (id == batch->corpus->num_games) {
+                BatchJob_destroy(job);
+                break;
+            }
+            job->corpusname = opts->corpusname;
+        } else if (Batch_is_due(batch, id) == true) {
+            job->seed = seed;
+            job->info = GameInfo_create_from_seed(
+              opts->num_colors, opts->num_extra, opts->num_slots, seed
+            );
+        }
+        job->parse_ms = _now_ms() - start;
+        if (Batch_is_due(batch, id) == true) {
+            Queue_push(batch->to_solve, job);
+        } else {
+            BatchJob_destroy(job);
+        }
+        ++id;
+        if (batch->list == NULL && batch->corpus == NULL) {
+            if (seed == opts->seed_last) {
+                break;
+            }
+            ++seed;
+        }
+    }
+    Queue_close(batch->to_solve);
+
+    return NULL;
+}
+
+/**
+ * Solver stage: solves games and passes them on to the writer. Each solver
+ * thread reuses one SolverContext for all its games, and all of them share one
+ * DeadTable.
+ *
+ * @param[in] arg pointer to Batch
+ *
+ * @return NULL
+ */
+static void *
+_solver(void *arg)
+{
+    Batch *const batch = arg;
+    const SolverLimits limits = {.max_nodes = batch->opts->max_nodes};
+    SolverContext *ctx = SolverContext_create();
+    SolverStats stats = {0};
+    ctx->progress = batch->opts->progress;
+    ctx->dead = batch->dead;
+    FILE *trace_out = NULL;
+    if (batch->opts->trace_name != NULL) {
+        pthread_mutex_lock(&batch->mutex);
+        const int i_trace = batch->num_traces++;
+        pthread_mutex_unlock(&batch->mutex);
+        char name[BATCH_LINE_BUFFER_SIZE];
+        snprintf(name, sizeof name, "%s.%i", batch->opts->trace_name, i_trace);
+        trace_out = fopen(name, "wb");
+    }
+    if (trace_out != NULL) {
+        const long last = batch->opts->trace_last;
+        ctx->trace = SearchTrace_create(
+          trace_out, (last > 0) ? last : TRACE_DEFAULT_CAPACITY, last > 0
+        );
+    }
+
+    BatchJob *job;
+    while ((job = Queue_pop(batch->to_solve)) != NULL) {
+        if (job->corpusname != NULL) {
+            const double start = _now_ms();
+            job->info
+              = GameInfo_create_from_corpus(batch->corpus, job->id, NULL);
+            job->parse_ms = _now_ms() - start;
+        }
+        if (job->info != NULL) {
+            const double start = _now_ms();
+            GameInfo_find_solution(
+              job->info, ctx, NULL, &limits, &job->result
+            );
+            job->solve_ms = _now_ms() - start;
+            ctx->stats.seconds = job->solve_ms * 1e-3;
+            SolverStats_add(&stats, &ctx->stats);
+        }
+        Queue_push(batch->to_write, job);
+    }
+
+    if (batch->opts->stats != NULL) {
+        pthread_mutex_lock(&batch->mutex);
+        SolverStats_add(batch->opts->stats, &stats);
+        pthread_mutex_unlock(&batch->mutex);
+    }
+    SearchTrace_destroy(ctx->trace);
+    if (trace_out != NULL) {
+        fclose(trace_out);
+    }
+    SolverContext_destroy(ctx);
+
+    return NULL;
+}
+
+/**
+ * Returns name of status of `job`.
+ *
+ * @param[in] job BatchJob to get status of
+ *
+ * @return Name of status
+ */
+static const char *
+_status_name(const BatchJob *job)
+{
+    if (job->info == NULL) {
+        return "error";
+    }
+    switch (job->result.status) {
+    case SOLVER_SOLVED:
+        return "solved";
+    case SOLVER_UNSOLVED:
+        return "unsolved";
+    default:
+        return "aborted";
+    }
+}
+
+/**
+ * Prints `str` as quoted CSV field to `out`.
+ *
+ * @param[in] out output FILE stream
+ * @param[in] str string to print
+ */
+static void
+_fprint_csv_string(FILE *out, const char *str)
+{
+    fputc('"', out);
+    for (const char *p = str; *p != '\0'; ++p) {
+        if (*p == '"') {
+            fputc('"', out);
+        }
+        fputc(*p, out);
+    }
+    fputc('"', out);
+}
+
+/**
+ * Prints record of `job` to `out` in format `format`.
+ *
+ * @param[in] out output FILE stream
+ * @param[in] job BatchJob to print
+ * @param[in] format output format enumerator
+ */
+static void
+BatchJob_fprint(FILE *out, const BatchJob *job, int format)
+{
+    const char *const status = _status_name(job);
+    const SolverResult *const res = &job->result;
+    if (format == BATCH_FORMAT_CSV) {
+        fprintf(out, "%li,", job->id);
+        if (job->filename != NULL) {
+            _fprint_csv_string(out, job->filename);
+        } else if (job->corpusname != NULL) {
+            _fprint_csv_string(out, job->corpusname);
+        } else {
+            fprintf(out, "%u", job->seed);
+        }
+        fprintf(
+          out, ",%s,%i,%li,%.3f,%.3f\n", status, res->num_moves,
+          res->num_nodes, job->parse_ms, job->solve_ms
+        );
+        return;
+    }
+    fprintf(out, "{\"id\":%li,", job->id);
+    if (job->filename != NULL) {
+        fprintf(out, "\"file\":");
+        Json_fprint_string(out, job->filename);
+    } else if (job->corpusname != NULL) {
+        fprintf(out, "\"corpus\":");
+        Json_fprint_string(out, job->corpusname);
+    } else {
+        fprintf(out, "\"seed\":%u", job->seed);
+    }
+    fprintf(
+      out,
+      ",\"status\":\"%s\",\"moves\":%i,\"nodes\":%li,"
+      "\"parse_ms\":%.3f,\"solve_ms\":%.3f}\n",
+      status, res->num_moves, res->num_nodes, job->parse_ms, job->solve_ms
+    );
+}
+
+/**
+ * Writer stage: writes records of solved games.
+ *
+ * @param[in] arg pointer to Batch
+ *
+ * @return NULL
+ */
+static void *
+_writer(void *arg)
+{
+    Batch *const batch = arg;
+
+    if (batch->segment != NULL) {
+        long ctr = 0;
+        BatchJob *job;
+        while ((job = Queue_pop(batch->to_write)) != NULL) {
+            char *record = NULL;
+            size_t len = 0;
+            FILE *mem = open_memstream(&record, &len);
+            BatchJob_fprint(mem, job, BATCH_FORMAT_JSONL);
+            fclose(mem);
+            Segment_write_record(batch->segment, record, len - 1);
+            free(record);
+            BatchJob_destroy(job);
+            if (++ctr % BATCH_SEGMENT_FLUSH_INTERVAL == 0) {
+                fflush(batch->segment);
+            }
+        }
+        fflush(batch->segment);
+        return NULL;
+    }
+
+    if (batch->opts->format == BATCH_FORMAT_CSV) {
+        fprintf(batch->out, "id,source,status,moves,nodes,parse_ms,solve_ms\n");
+    }
+    BatchJob *job;
+    while ((job = Queue_pop(batch->to_write)) != NULL) {
+        BatchJob_fprint(batch->out, job, batch->opts->format);
+        BatchJob_destroy(job);
+    }
+    fflush(batch->out);
+
+    return NULL;
+}
+
+int
+Batch_parse_format(const char *str)
+{
+    if (strcmp(str, "jsonl") == 0) {
+        return BATCH_FORMAT_JSONL;
+    }
+    if (strcmp(str, "csv") == 0) {
+        return BATCH_FORMAT_CSV;
+    }
+    return TUBE_FAILURE;
+}
+
+/**
+ * Opens segment of `batch` (if requested) and resumes it.
+ *
+ * @param[in,out] batch Batch to open segment of
+ *
+ * @return Error code
+ */
+static int
+Batch_open_segment(Batch *batch)
+{
+    const BatchOptions *const opts = batch->opts;
+    if (opts->segment_dir == NULL) {
+        return TUBE_SUCCESS;
+    }
+
+    /* Self-description: everything that determines the records */
+    char desc[BATCH_LINE_BUFFER_SIZE];
+    if (opts->corpusname != NULL) {
+        snprintf(
+          desc, sizeof desc, "source=corpus:%s nodes=%li", opts->corpusname,
+          opts->max_nodes
+        );
+    } else if (opts->listname != NULL) {
+        snprintf(
+          desc, sizeof desc, "source=list:%s nodes=%li", opts->listname,
+          opts->max_nodes
+        );
+    } else {
+        snprintf(
+          desc, sizeof desc,
+          "source=seeds:%u:%u colors=%i extra=%i slots=%i nodes=%li",
+          opts->seed_first, opts->seed_last, opts->num_colors, opts->num_extra,
+          opts->num_slots, opts->max_nodes
+        );
+    }
+
+    const int shard_index = (opts->num_shards > 0) ? opts->shard_index : 0;
+    const int num_shards = (opts->num_shards > 0) ? opts->num_shards : 1;
+    char *filename
+      = Segment_filename(opts->segment_dir, shard_index, num_shards);
+    batch->done = IdSet_create();
+    batch->segment
+      = Segment_open(filename, shard_index, num_shards, desc, batch->done);
+    free(filename);
+
+    return (batch->segment == NULL) ? TUBE_FAILURE : TUBE_SUCCESS;
+}
+
+int
+Batch_run(const BatchOptions *opts, FILE *out)
+{
+    Batch batch = {.opts = opts, .out = out};
+    if (Batch_open_segment(&batch) == TUBE_FAILURE) {
+        IdSet_destroy(batch.done);
+        return TUBE_FAILURE;
+    }
+    if (opts->corpusname != NULL) {
+        batch.corpus = Corpus_open(opts->corpusname);
+        if (batch.corpus == NULL) {
+            if (batch.segment != NULL) {
+                fclose(batch.segment);
+            }
+            IdSet_destroy(batch.done);
+            return TUBE_FAILURE;
+        }
+    } else if (opts->listname != NULL) {
+        batch.list = fopen(opts->listname, "r");
+        if (batch.list == NULL) {
+            if (batch.segment != NULL) {
+                fclose(batch.segment);
+            }
+            IdSet_destroy(batch.done);
+            return TUBE_FAILURE;
+        }
+    }
+    batch.to_solve = Queue_create(BATCH_QUEUE_CAPACITY);
+    batch.to_write = Queue_create(BATCH_QUEUE_CAPACITY);
+    batch.dead = DeadTable_create();
+    pthread_mutex_init(&batch.mutex, NULL);
+
+    int num_threads = opts->num_threads;
+    if (num_threads <= 0) {
+        num_threads = Bulk_num_cores();
+    }
+    pthread_t *solvers = malloc(num_threads * sizeof *solvers);
+    pthread_t parser, writer;
+    if (pthread_create(&parser, NULL, &_parser, &batch) != 0
+        || pthread_create(&writer, NULL, &_writer, &batch) != 0) {
+        ERROR("Could not create pipeline threads!");
+    }
+    for (int i = 0; i < num_threads; ++i) {
+        if (pthread_create(&solvers[i], NULL, &_solver, &batch) != 0) {
+            ERROR("Could not create solver thread!");
+        }
+    }
+
+    pthread_join(parser, NULL);
+    for (int i = 0; i < num_threads; ++i) {
+        pthread_join(solvers[i], NULL);
+    }
+    Queue_close(batch.to_write);
+    pthread_join(writer, NULL);
+
+    free(solvers);
+    pthread_mutex_destroy(&batch.mutex);
+    DeadTable_destroy(batch.dead);
+    Queue_destroy(batch.to_write);
+    Queue_destroy(batch.to_solve);
+    if (batch.list != NULL) {
+        fclose(batch.list);
+    }
+    Corpus_close(batch.corpus);
+    if (batch.segment != NULL) {
+        fclose(batch.segment);
+    }
+    IdSet_destroy(batch.done);
+
+    return TUBE_SUCCESS;
+}
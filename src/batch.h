@@ -0,0 +1,81 @@
+/** batch.h
+ *
+ * Header for multi-threaded batch solving of 'tubes'. Solves games of a range
+ * of seeds, of a list of input files or of a corpus in a parse -> solve ->
+ * write pipeline (connected by bounded queues) and writes one aggregated stream
+ * of results.
+ */
+
+#ifndef BATCH_H_INCLUDED
+#define BATCH_H_INCLUDED
+
+#include <stdio.h>
+
+#include "solver.h"
+
+/**
+ * Output format enumerator.
+ */
+enum {
+    BATCH_FORMAT_JSONL,
+    BATCH_FORMAT_CSV,
+};
+
+/**
+ * Struct for options of batch solving.
+ */
+typedef struct {
+    int num_colors;
+    int num_extra;
+    int num_slots;
+    unsigned int seed_first;
+    unsigned int seed_last; /* inclusive */
+    const char *listname;   /* file with one input file per line (or NULL) */
+    const char *corpusname; /* corpus file (or NULL) */
+    long max_nodes;         /* non-positive for unlimited */
+    int num_threads;        /* non-positive for number of online cores */
+    int format;             /* output format enumerator */
+    int shard_index;        /* only solve games with id % num_shards == index */
+    int num_shards;         /* non-positive for no sharding */
+    const char *segment_dir; /* write (resumable) segment there (or NULL) */
+    SolverStats *stats;      /* accumulate statistics of solves (or NULL) */
+    const char *trace_name;  /* write search trace per thread (or NULL) */
+    long trace_last;         /* only keep last events per flush if positive */
+    SolverProgress *progress; /* publish progress of solves (or NULL) */
+} BatchOptions;
+
+/**
+ * Solves all games of `opts` (games of the corpus if `opts->corpusname` is not
+ * NULL, games of the list of input files if `opts->listname` is not NULL, games
+ * of the range of seeds otherwise) and writes one record per game (id, source,
+ * status, moves, nodes and timing) to `out` in order of completion.
+ *
+ * Games are numbered consecutively (by seed, by line of the list or by index in
+ * the corpus). Games of a corpus are read by the solver threads themselves
+ * (straight from the memory-mapped corpus). With sharding, only games whose id
+ * modulo `opts->num_shards` equals `opts->shard_index` are solved. If
+ * `opts->segment_dir` is not NULL, records are written (as JSONL) to the
+ * segment of the shard in that directory instead of `out`; an existing segment
+ * of the same run is resumed, i.e., games that already have a valid record are
+ * skipped. If `opts->trace_name` is not NULL, solver thread `i` writes a search
+ * trace (see trace.h) to file "${opts->trace_name}.${i}".
+ *
+ * @param[in] opts BatchOptions for solving
+ * @param[in] out output FILE stream
+ *
+ * @return Error code (e.g., if list, corpus or segment could not be opened)
+ */
+int
+Batch_run(const BatchOptions *opts, FILE *out);
+
+/**
+ * Parses output format `str` ("jsonl" or "csv").
+ *
+ * @param[in] str string to parse
+ *
+ * @return Output format enumerator or TUBE_FAILURE if invalid
+ */
+int
+Batch_parse_format(const char *str);
+
+#endif /* BATCH_H_INCLUDED */
@@ -0,0 +1,461 @@
+/** bench.c
+ *
+ * 'tubes-bench': benchmarks the generators and the solver of 'tubes' on a fixed
+ * set of cases (seeded games of several sizes and the games of a corpus) and
+ * compares the results against a stored baseline. Each case is run a number of
+ * warmup repetitions (not measured) and then a number of measured repetitions.
+ *
+ * Results are written as JSON with one case per line:
+ *
+ *   {"version":1,"cases":[
+ *   {"name":"solve/seed/c8e2l4","reps":5,"median_ms":...,"p95_ms":...,
+ *    "nodes":...,"nodes_per_s":...,"peak_kb":...,"search_allocs":...},
+ *   ...
+ *   ]}
+ *
+ * (each case on a single line), which is also the format of the baseline. A
+ * case regresses if its median time exceeds the baseline by more than the
+ * tolerance or if it needs more nodes than in the baseline (node counts are
+ * deterministic, so they also flag changes in search behaviour). The number of
+ * allocations during searches (counted with TUBES_ALLOC_STATS only) shows if
+ * the hot path allocates: with a reused SolverContext, it should be (close to)
+ * zero. The peak memory of a case (maximum number of bytes allocated at once,
+ * also counted with TUBES_ALLOC_STATS only) is measured in an extra repetition
+ * with a fresh SolverContext, which is not timed as counting costs time.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alloc.h"
+#include "corpus.h"
+#include "gameinfo.h"
+#include "util.h"
+
+#define BENCH_VERSION 2
+#define BENCH_NAME_SIZE 64
+#define BENCH_LINE_BUFFER_SIZE 1024
+#define BENCH_NODE_LIMIT 100000
+#define DEFAULT_NUMBER_OF_WARMUPS 1
+#define DEFAULT_NUMBER_OF_REPETITIONS 5
+#define DEFAULT_TOLERANCE 0.15
+
+/**
+ * Kind of case enumerator.
+ */
+enum {
+    BENCH_GENERATE_SEED,
+    BENCH_GENERATE_SCRAMBLE,
+    BENCH_SOLVE_SEED,
+    BENCH_SOLVE_CORPUS,
+};
+
+/**
+ * Auxiliary struct for a single case (games of seeds 1 to `num_games` or, for
+ * BENCH_SOLVE_CORPUS, `num_games` passes over all games of the corpus).
+ */
+typedef struct {
+    int kind;
+    int num_colors;
+    int num_extra;
+    int num_slots;
+    int num_games;
+    int num_scramble;
+} BenchCase;
+
+/**
+ * Auxiliary struct for result of a single case.
+ */
+typedef struct {
+    char name[BENCH_NAME_SIZE];
+    int num_reps;
+    double median_ms;
+    double p95_ms;
+    long num_nodes; /* per repetition */
+    long peak_kb;           /* peak of allocated memory of a repetition */
+    long num_search_allocs; /* per repetition */
+} BenchResult;
+
+/**
+ * Cases of the benchmark (the corpus case is only run if a corpus is given).
+ * Changing them invalidates the baseline, so bump BENCH_VERSION if you do.
+ */
+static const BenchCase CASES[] = {
+  {BENCH_GENERATE_SEED, 5, 2, 4, 100000, 0},
+  {BENCH_GENERATE_SEED, 12, 2, 6, 25000, 0},
+  {BENCH_GENERATE_SCRAMBLE, 8, 2, 4, 2000, 100},
+  {BENCH_GENERATE_SCRAMBLE, 12, 2, 6, 1000, 400},
+  {BENCH_SOLVE_SEED, 5, 2, 4, 5000, 0},
+  {BENCH_SOLVE_SEED, 8, 2, 4, 1000, 0},
+  {BENCH_SOLVE_SEED, 10, 2, 6, 200, 0},
+  {BENCH_SOLVE_CORPUS, 0, 0, 0, 25, 0},
+};
+
+/**
+ * Usage string.
+ */
+static const char *const usage
+  = "Usage: tubes-bench [-w WARMUPS] [-r REPS] [-b BASELINE] [-t TOLERANCE]\n"
+    "                   [-o OUTPUT] [CORPUS]\n"
+    "Benchmarks generators and solver of 'tubes' on seeded games (and the\n"
+    "games of CORPUS) and compares the results against BASELINE (written\n"
+    "with '-o'). Fails if a case got slower by more than TOLERANCE (default\n"
+    "0.15) or needs more nodes than in BASELINE.\n";
+
+/**
+ * Returns monotonic wall time in milliseconds.
+ *
+ * @return Current time in milliseconds
+ */
+static double
+_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+/**
+ * Comparison function for doubles in the style of the C standard library.
+ *
+ * @param[in] lhs pointer to left hand side
+ * @param[in] rhs pointer to right hand side
+ *
+ * @return <0 if `lhs` is less than `rhs, >0 if greater than, 0 if equal
+ */
+static int
+_cmp_fnc_double(const void *lhs, const void *rhs)
+{
+    const double a = *(const double *) lhs;
+    const double b = *(const double *) rhs;
+    return (a > b) - (a < b);
+}
+
+/**
+ * Writes name of `bench` to `name` (of size BENCH_NAME_SIZE).
+ *
+ * @param[out] name buffer to write name to
+ * @param[in] bench BenchCase to name
+ */
+static void
+_name_case(char *name, const BenchCase *bench)
+{
+    static const char *const KINDS[] = {
+      [BENCH_GENERATE_SEED] = "generate/seed",
+      [BENCH_GENERATE_SCRAMBLE] = "generate/scramble",
+      [BENCH_SOLVE_SEED] = "solve/seed",
+      [BENCH_SOLVE_CORPUS] = "solve/corpus",
+    };
+    if (bench->kind == BENCH_SOLVE_CORPUS) {
+        snprintf(name, BENCH_NAME_SIZE, "%s", KINDS[bench->kind]);
+        return;
+    }
+    snprintf(
+      name, BENCH_NAME_SIZE, "%s/c%ie%il%i", KINDS[bench->kind],
+      bench->num_colors, bench->num_extra, bench->num_slots
+    );
+}
+
+/**
+ * Runs one repetition of `bench` and writes number of allocations during
+ * searches to `p_num_allocs`. Allocations are counted during searches only,
+ * unless `is_tracked` is true (then tracking is left enabled throughout).
+ *
+ * @param[in] bench BenchCase to run
+ * @param[in] corpus Corpus for BENCH_SOLVE_CORPUS
+ * @param[in,out] ctx SolverContext to solve with
+ * @param[in] is_tracked is tracking of allocations enabled by caller?
+ * @param[out] p_num_allocs pointer to number of allocations
+ *
+ * @return Number of nodes searched
+ */
+static long
+_run_case(
+  const BenchCase *bench, const Corpus *corpus, SolverContext *ctx,
+  bool is_tracked, long *p_num_allocs
+)
+{
+    const SolverLimits limits = {.max_nodes = BENCH_NODE_LIMIT};
+    const long num_games
+      = (bench->kind == BENCH_SOLVE_CORPUS)
+          ? bench->num_games * corpus->num_games
+          : bench->num_games;
+    long num_nodes = 0;
+    *p_num_allocs = 0;
+    for (long i = 0; i < num_games; ++i) {
+        GameInfo *info = NULL;
+        switch (bench->kind) {
+        case BENCH_GENERATE_SEED:
+        case BENCH_SOLVE_SEED:
+            info = GameInfo_create_from_seed(
+              bench->num_colors, bench->num_extra, bench->num_slots,
+              (int) i + 1
+            );
+            break;
+        case BENCH_GENERATE_SCRAMBLE:
+            info = GameInfo_create_from_scramble(
+              bench->num_colors, bench->num_extra, bench->num_slots,
+              (int) i + 1, bench->num_scramble, NULL
+            );
+            break;
+        case BENCH_SOLVE_CORPUS:
+            info = GameInfo_create_from_corpus(
+              corpus, i % corpus->num_games, NULL
+            );
+            break;
+        }
+        if (info == NULL) {
+            ERROR("Could not create game %li of case!", i);
+        }
+        if (bench->kind == BENCH_SOLVE_SEED
+            || bench->kind == BENCH_SOLVE_CORPUS) {
+            AllocStats before;
+            AllocStats after;
+            SolverResult result;
+            Alloc_get_stats(ALLOC_NUM_SUBSYSTEMS, &before);
+            Alloc_set_tracking(true);
+            GameInfo_find_solution(info, ctx, NULL, &limits, &result);
+            Alloc_set_tracking(is_tracked);
+            Alloc_get_stats(ALLOC_NUM_SUBSYSTEMS, &after);
+            num_nodes += result.num_nodes;
+            *p_num_allocs += after.allocs - before.allocs;
+        }
+        GameInfo_destroy(info);
+    }
+    return num_nodes;
+}
+
+/**
+ * Runs one repetition of `bench` (with a fresh SolverContext) while counting
+ * allocations and returns its peak of allocated memory.
+ *
+ * @param[in] bench BenchCase to run
+ * @param[in] corpus Corpus for BENCH_SOLVE_CORPUS
+ *
+ * @return Peak of allocated memory in KiB (0 without TUBES_ALLOC_STATS)
+ */
+static long
+_measure_peak(const BenchCase *bench, const Corpus *corpus)
+{
+    AllocStats before;
+    AllocStats after;
+    long num_allocs;
+    Alloc_reset_peak();
+    Alloc_get_stats(ALLOC_NUM_SUBSYSTEMS, &before);
+    Alloc_set_tracking(true);
+    SolverContext *ctx = SolverContext_create();
+    _run_case(bench, corpus, ctx, true, &num_allocs);
+    SolverContext_destroy(ctx);
+    Alloc_set_tracking(false);
+    Alloc_get_stats(ALLOC_NUM_SUBSYSTEMS, &after);
+    return (after.peak - before.current) / 1024;
+}
+
+/**
+ * Runs `bench` with `num_warmups` warmup and `num_reps` measured repetitions
+ * and writes its result to `result`.
+ *
+ * @param[in] bench BenchCase to run
+ * @param[in] corpus Corpus for BENCH_SOLVE_CORPUS
+ * @param[in] num_warmups number of warmup repetitions
+ * @param[in] num_reps number of measured repetitions
+ * @param[out] result BenchResult to write result to
+ */
+static void
+_bench_case(
+  const BenchCase *bench, const Corpus *corpus, int num_warmups, int num_reps,
+  BenchResult *result
+)
+{
+    SolverContext *ctx = SolverContext_create();
+    double *times = malloc(num_reps * sizeof *times);
+
+    for (int i = 0; i < num_warmups; ++i) {
+        _run_case(bench, corpus, ctx, false, &result->num_search_allocs);
+    }
+    for (int i = 0; i < num_reps; ++i) {
+        const double start = _now_ms();
+        result->num_nodes
+          = _run_case(bench, corpus, ctx, false, &result->num_search_allocs);
+        times[i] = _now_ms() - start;
+    }
+    qsort(times, num_reps, sizeof *times, _cmp_fnc_double);
+
+    _name_case(result->name, bench);
+    result->num_reps = num_reps;
+    const int mid = num_reps / 2;
+    result->median_ms = (num_reps % 2 == 1)
+                          ? times[mid]
+                          : 0.5 * (times[mid - 1] + times[mid]);
+    result->p95_ms = times[(int) (0.95 * (num_reps - 1) + 0.5)];
+
+    free(times);
+    SolverContext_destroy(ctx);
+    result->peak_kb = _measure_peak(bench, corpus);
+}
+
+/**
+ * Prints `result` as single-line JSON object to `out`.
+ *
+ * @param[in] out output FILE stream
+ * @param[in] result BenchResult to print
+ */
+static void
+_fprint_result(FILE *out, const BenchResult *result)
+{
+    const double nodes_per_s
+      = (result->median_ms > 0.0) ? result->num_nodes / result->median_ms * 1e3
+                                  : 0.0;
+    fprintf(
+      out,
+      "{\"name\":\"%s\",\"reps\":%i,\"median_ms\":%.3f,\"p95_ms\":%.3f,"
+      "\"nodes\":%li,\"nodes_per_s\":%.0f,\"peak_kb\":%li,"
+      "\"search_allocs\":%li}",
+      result->name, result->num_reps, result->median_ms, result->p95_ms,
+      result->num_nodes, nodes_per_s, result->peak_kb,
+      result->num_search_allocs
+    );
+}
+
+/**
+ * Looks up case `name` in baseline `in` and writes its median time and number
+ * of nodes to `p_median_ms` and `p_num_nodes`.
+ *
+ * @param[in] in baseline FILE stream
+ * @param[in] name name of case
+ * @param[out] p_median_ms pointer to median time
+ * @param[out] p_num_nodes pointer to number of nodes
+ *
+ * @return Error code (TUBE_FAILURE if case is not in baseline)
+ */
+static int
+_lookup_baseline(
+  FILE *in, const char *name, double *p_median_ms, long *p_num_nodes
+)
+{
+    char key[BENCH_NAME_SIZE + 16];
+    snprintf(key, sizeof key, "{\"name\":\"%s\",", name);
+    char line[BENCH_LINE_BUFFER_SIZE];
+    rewind(in);
+    while (fgets(line, sizeof line, in) != NULL) {
+        if (strncmp(line, key, strlen(key)) != 0) {
+            continue;
+        }
+        const char *median = strstr(line, "\"median_ms\":");
+        const char *nodes = strstr(line, "\"nodes\":");
+        if (median == NULL || nodes == NULL) {
+            return TUBE_FAILURE;
+        }
+        *p_median_ms = strtod(median + strlen("\"median_ms\":"), NULL);
+        *p_num_nodes = strtol(nodes + strlen("\"nodes\":"), NULL, 10);
+        return TUBE_SUCCESS;
+    }
+    return TUBE_FAILURE;
+}
+
+int
+main(int argc, char **argv)
+{
+    int num_warmups = DEFAULT_NUMBER_OF_WARMUPS;
+    int num_reps = DEFAULT_NUMBER_OF_REPETITIONS;
+    double tolerance = DEFAULT_TOLERANCE;
+    const char *baselinename = NULL;
+    const char *outname = NULL;
+    const char *corpusname = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            num_warmups = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            num_reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            tolerance = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            baselinename = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outname = argv[++i];
+        } else if (argv[i][0] != '-' && corpusname == NULL) {
+            corpusname = argv[i];
+        } else {
+            ERROR("%s", usage);
+        }
+    }
+    if (num_warmups < 0 || num_reps < 1 || tolerance < 0.0) {
+        ERROR("%s", usage);
+    }
+
+    Corpus *corpus = NULL;
+    if (corpusname != NULL) {
+        corpus = Corpus_open(corpusname);
+        if (corpus == NULL) {
+            ERROR("Could not open corpus '%s'!", corpusname);
+        }
+    }
+    FILE *baseline = NULL;
+    if (baselinename != NULL) {
+        baseline = fopen(baselinename, "r");
+        if (baseline == NULL) {
+            ERROR("Could not open baseline '%s'!", baselinename);
+        }
+    }
+    FILE *out = stdout;
+    if (outname != NULL) {
+        out = fopen(outname, "w");
+        if (out == NULL) {
+            ERROR("Could not open output file '%s'!", outname);
+        }
+    }
+
+    const int num_cases = sizeof CASES / sizeof *CASES;
+    int num_regressions = 0;
+    fprintf(out, "{\"version\":%i,\"cases\":[\n", BENCH_VERSION);
+    for (int i = 0, num_printed = 0; i < num_cases; ++i) {
+        if (CASES[i].kind == BENCH_SOLVE_CORPUS && corpus == NULL) {
+            continue;
+        }
+        BenchResult result;
+        _bench_case(&CASES[i], corpus, num_warmups, num_reps, &result);
+        fprintf(out, (num_printed++ == 0) ? "" : ",\n");
+        _fprint_result(out, &result);
+        fflush(out);
+
+        if (baseline == NULL) {
+            continue;
+        }
+        double median_ms;
+        long num_nodes;
+        if (_lookup_baseline(baseline, result.name, &median_ms, &num_nodes)
+            == TUBE_FAILURE) {
+            fprintf(stderr, "%-28s not in baseline\n", result.name);
+            continue;
+        }
+        const double ratio
+          = (median_ms > 0.0) ? result.median_ms / median_ms : 1.0;
+        const bool is_slower = (ratio > 1.0 + tolerance);
+        const bool has_more_nodes = (result.num_nodes > num_nodes);
+        fprintf(
+          stderr, "%-28s %10.3f ms (x%.3f)  %10li nodes (%+li)%s\n",
+          result.name, result.median_ms, ratio, result.num_nodes,
+          result.num_nodes - num_nodes,
+          (is_slower || has_more_nodes) ? "  REGRESSION" : ""
+        );
+        num_regressions += (is_slower || has_more_nodes);
+    }
+    fprintf(out, "\n]}\n");
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    if (baseline != NULL) {
+        fclose(baseline);
+    }
+    Corpus_close(corpus);
+
+    if (num_regressions > 0) {
+        ERROR("%i case(s) regressed against baseline!", num_regressions);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,231 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "bulk.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "gameinfo.h"
+#include "util.h"
+
+/* Seeds are processed in blocks so that memory does not grow with the range */
+#define BULK_BLOCK_SIZE 65536
+/* Number of seeds a worker takes from a block at once */
+#define BULK_CHUNK_SIZE 64
+
+/**
+ * Auxiliary struct for shared state of workers within one block.
+ */
+typedef struct {
+    const BulkOptions *opts;
+    unsigned int seed_first;
+    int size;
+    int next;
+    SolverResult *results;
+    pthread_mutex_t mutex;
+} BulkBlock;
+
+/**
+ * Scrambles game of seed `seed` according to `opts` and writes the known upper
+ * bound of moves to `result`.
+ *
+ * @param[in] opts BulkOptions for generation
+ * @param[in] seed seed of game
+ * @param[in,out] log auxiliary ActionLog
+ * @param[out] result SolverResult to write bound to
+ */
+static void
+_scramble(
+  const BulkOptions *opts, unsigned int seed, ActionLog *log,
+  SolverResult *result
+)
+{
+    log->counter = 0;
+    GameInfo *info = GameInfo_create_from_scramble(
+      opts->num_colors, opts->num_extra, opts->num_slots, seed,
+      opts->num_scramble, log
+    );
+    GameInfo_destroy(info);
+    result->status = SOLVER_SOLVED;
+    result->num_moves = log->counter;
+    result->num_nodes = 0;
+    result->num_pours = 0;
+}
+
+/**
+ * Worker function: takes chunks of seeds from BulkBlock pointed to by `arg`
+ * until all are done.
+ *
+ * @param[in] arg pointer to BulkBlock
+ *
+ * @return NULL
+ */
+static void *
+_worker(void *arg)
+{
+    BulkBlock *const block = arg;
+    const BulkOptions *const opts = block->opts;
+    const SolverLimits limits = {.max_nodes = opts->max_nodes};
+    ActionLog *log = ActionLog_create();
+    SolverContext *ctx = SolverContext_create();
+
+    for (;;) {
+        pthread_mutex_lock(&block->mutex);
+        const int first = block->next;
+        block->next += BULK_CHUNK_SIZE;
+        pthread_mutex_unlock(&block->mutex);
+        if (first >= block->size) {
+            break;
+        }
+        int last = first + BULK_CHUNK_SIZE;
+        if (last > block->size) {
+            last = block->size;
+        }
+        for (int i = first; i < last; ++i) {
+            const unsigned int seed = block->seed_first + i;
+            if (opts->num_scramble > 0) {
+                _scramble(opts, seed, log, &block->results[i]);
+                continue;
+            }
+            GameInfo *info = GameInfo_create_from_seed(
+              opts->num_colors, opts->num_extra, opts->num_slots, seed
+            );
+            GameInfo_find_solution(
+              info, ctx, NULL, &limits, &block->results[i]
+            );
+            GameInfo_destroy(info);
+        }
+    }
+
+    SolverContext_destroy(ctx);
+    ActionLog_destroy(log);
+
+    return NULL;
+}
+
+/**
+ * Returns if `result` is within the band of moves of `opts`.
+ *
+ * @param[in] opts BulkOptions with band of moves
+ * @param[in] result SolverResult to check
+ *
+ * @return Is `result` accepted?
+ */
+static bool
+_is_accepted(const BulkOptions *opts, const SolverResult *result)
+{
+    if (result->status != SOLVER_SOLVED) {
+        return false;
+    }
+    if (result->num_moves < opts->min_moves) {
+        return false;
+    }
+    if (opts->max_moves > 0 && result->num_moves > opts->max_moves) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Writes game of seed `seed` with scores of `result` to `out`.
+ *
+ * @param[in] out output FILE stream
+ * @param[in] opts BulkOptions used for generation
+ * @param[in] seed seed of game
+ * @param[in] result SolverResult of game
+ */
+static void
+_fprint_puzzle(
+  FILE *out, const BulkOptions *opts, unsigned int seed,
+  const SolverResult *result
+)
+{
+    GameInfo *info = NULL;
+    if (opts->num_scramble > 0) {
+        fprintf(
+          out, "# seed %u: moves <= %i (scrambled)\n", seed, result->num_moves
+        );
+        info = GameInfo_create_from_scramble(
+          opts->num_colors, opts->num_extra, opts->num_slots, seed,
+          opts->num_scramble, NULL
+        );
+    } else {
+        /* Already solved games have no moves (and no branching) */
+        const double branching
+          = (result->num_moves > 0)
+              ? pow((double) result->num_nodes, 1.0 / result->num_moves)
+              : 0;
+        fprintf(
+          out, "# seed %u: moves %i, nodes %li, branching %.3f\n", seed,
+          result->num_moves, result->num_nodes, branching
+        );
+        info = GameInfo_create_from_seed(
+          opts->num_colors, opts->num_extra, opts->num_slots, seed
+        );
+    }
+    GameInfo_fprint_raw(out, info);
+    GameInfo_destroy(info);
+    fprintf(out, "\n");
+}
+
+int
+Bulk_num_cores(void)
+{
+    const long num = sysconf(_SC_NPROCESSORS_ONLN);
+    return (num < 1) ? 1 : (int) num;
+}
+
+long
+Bulk_generate(const BulkOptions *opts, FILE *out)
+{
+    int num_threads = opts->num_threads;
+    if (num_threads <= 0) {
+        num_threads = Bulk_num_cores();
+    }
+    pthread_t *threads = malloc(num_threads * sizeof *threads);
+    SolverResult *results = malloc(BULK_BLOCK_SIZE * sizeof *results);
+
+    long num_accepted = 0;
+    unsigned int seed = opts->seed_first;
+    for (;;) {
+        const unsigned int remaining = opts->seed_last - seed;
+        BulkBlock block = {
+          .opts = opts,
+          .seed_first = seed,
+          .size = (remaining < BULK_BLOCK_SIZE) ? (int) remaining + 1
+                                                : BULK_BLOCK_SIZE,
+          .next = 0,
+          .results = results,
+        };
+        pthread_mutex_init(&block.mutex, NULL);
+        for (int i = 0; i < num_threads; ++i) {
+            if (pthread_create(&threads[i], NULL, &_worker, &block) != 0) {
+                ERROR("Could not create worker thread!");
+            }
+        }
+        for (int i = 0; i < num_threads; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+        pthread_mutex_destroy(&block.mutex);
+
+        for (int i = 0; i < block.size; ++i) {
+            if (_is_accepted(opts, &results[i]) == true) {
+                _fprint_puzzle(out, opts, seed + i, &results[i]);
+                ++num_accepted;
+            }
+        }
+
+        if (remaining < BULK_BLOCK_SIZE) {
+            break;
+        }
+        seed += BULK_BLOCK_SIZE;
+    }
+
+    free(results);
+    free(threads);
+
+    return num_accepted;
+}
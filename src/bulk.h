@@ -0,0 +1,56 @@
+/** bulk.h
+ *
+ * Header for bulk generation of puzzle packs of 'tubes'. Generates games over a
+ * range of seeds on all cores, solves them under a node limit and only keeps
+ * those within a given band of difficulty.
+ */
+
+#ifndef BULK_H_INCLUDED
+#define BULK_H_INCLUDED
+
+#include <stdio.h>
+
+/**
+ * Struct for options of bulk generation.
+ */
+typedef struct {
+    int num_colors;
+    int num_extra;
+    int num_slots;
+    unsigned int seed_first;
+    unsigned int seed_last; /* inclusive */
+    long max_nodes;         /* non-positive for unlimited */
+    int min_moves;
+    int max_moves;   /* non-positive for unlimited */
+    int num_threads; /* non-positive for number of online cores */
+    int num_scramble; /* positive to scramble solved boards instead */
+} BulkOptions;
+
+/**
+ * Generates and solves games for all seeds of `opts` in parallel and writes
+ * those that are solvable within the limits and the requested band of moves to
+ * `out` in seed order. Every puzzle is preceded by a comment line with its
+ * scores (moves, nodes expanded and effective branching factor) and followed by
+ * a blank line.
+ *
+ * If `opts->num_scramble` is positive, games are generated by scrambling solved
+ * boards instead (see GameInfo_create_from_scramble()). They need no solver
+ * call, and the band of moves applies to the known upper bound.
+ *
+ * @param[in] opts BulkOptions for generation
+ * @param[in] out output FILE stream
+ *
+ * @return Number of accepted puzzles
+ */
+long
+Bulk_generate(const BulkOptions *opts, FILE *out);
+
+/**
+ * Returns number of online processor cores (at least 1).
+ *
+ * @return Number of cores
+ */
+int
+Bulk_num_cores(void);
+
+#endif /* BULK_H_INCLUDED */
@@ -0,0 +1,338 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "solver.h"
+#include "util.h"
+
+#define CACHE_VERSION 1
+#define CACHE_RECORD_HEADER_SIZE 48
+#define CACHE_ACTION_WIDTH 4 /* size of ActionCode of a move */
+#define CACHE_INITIAL_CAPACITY 1024
+
+/**
+ * Reads little-endian 32-bit integer from `p`.
+ *
+ * @param[in] p pointer to bytes
+ *
+ * @return Integer
+ */
+static uint32_t
+_get_u32(const unsigned char *p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16)
+           | ((uint32_t) p[3] << 24);
+}
+
+/**
+ * Reads little-endian 64-bit integer from `p`.
+ *
+ * @param[in] p pointer to bytes
+ *
+ * @return Integer
+ */
+static uint64_t
+_get_u64(const unsigned char *p)
+{
+    return (uint64_t) _get_u32(p) | ((uint64_t) _get_u32(p + 4) << 32);
+}
+
+/**
+ * Writes `value` as little-endian integer of `num_bytes` bytes to `p`.
+ *
+ * @param[out] p pointer to bytes
+ * @param[in] value value to write
+ * @param[in] num_bytes number of bytes
+ */
+static void
+_put_uint(unsigned char *p, uint64_t value, int num_bytes)
+{
+    for (int i = 0; i < num_bytes; ++i) {
+        p[i] = (unsigned char) (value & 0xff);
+        value >>= 8;
+    }
+}
+
+/**
+ * Computes 64-bit FNV-1a hash of `len` bytes of `data`.
+ *
+ * @param[in] data bytes to hash
+ * @param[in] len number of bytes
+ *
+ * @return Hash
+ */
+static uint64_t
+_hash(const unsigned char *data, size_t len)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < len; ++i) {
+        hash = (hash ^ data[i]) * 0x100000001b3;
+    }
+    return hash;
+}
+
+/**
+ * Takes (or releases) lock of type `type` on whole file `fd` (blocking).
+ *
+ * @param[in] fd file descriptor
+ * @param[in] type F_RDLCK, F_WRLCK or F_UNLCK
+ *
+ * @return Error code
+ */
+static int
+_lock(int fd, short type)
+{
+    struct flock fl;
+    memset(&fl, 0, sizeof fl);
+    fl.l_type = type;
+    fl.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &fl) != 0) {
+        if (errno != EINTR) {
+            return TUBE_FAILURE;
+        }
+    }
+    return TUBE_SUCCESS;
+}
+
+/**
+ * Inserts record at `offset` with key hash `hash` into index of `cache`.
+ *
+ * @param[in,out] cache SolutionCache to insert into
+ * @param[in] hash hash of key of record
+ * @param[in] offset offset of record
+ */
+static void
+SolutionCache_insert(SolutionCache *cache, uint64_t hash, size_t offset)
+{
+    if (2 * (cache->num_records + 1) > cache->capacity) {
+        CacheSlot *old = cache->slots;
+        const long old_capacity = cache->capacity;
+        cache->capacity *= 2;
+        cache->slots
+          = Alloc_calloc(ALLOC_CACHE, cache->capacity, sizeof *cache->slots);
+        cache->num_records = 0;
+        for (long i = 0; i < old_capacity; ++i) {
+            if (old[i].offset != 0) {
+                SolutionCache_insert(cache, old[i].hash, old[i].offset);
+            }
+        }
+        Alloc_free(old);
+    }
+    const long mask = cache->capacity - 1;
+    long i = (long) (hash & mask);
+    while (cache->slots[i].offset != 0) {
+        i = (i + 1) & mask;
+    }
+    cache->slots[i].hash = hash;
+    cache->slots[i].offset = offset;
+    ++cache->num_records;
+}
+
+/**
+ * Maps new part of cache file and indexes all new valid records. Caller must
+ * hold a lock.
+ *
+ * @param[in,out] cache SolutionCache to refresh
+ *
+ * @return Size of file
+ */
+static size_t
+SolutionCache_scan(SolutionCache *cache)
+{
+    struct stat st;
+    if (fstat(cache->fd, &st) != 0) {
+        return cache->end;
+    }
+    const size_t size = (size_t) st.st_size;
+    if (size > cache->size) {
+        void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, cache->fd, 0);
+        if (map == MAP_FAILED) {
+            return size;
+        }
+        if (cache->data != NULL) {
+            munmap(cache->data, cache->size);
+        }
+        cache->data = map;
+        cache->size = size;
+    }
+
+    /* Mapping may exceed file after a torn tail was dropped */
+    const size_t limit = (size < cache->size) ? size : cache->size;
+    while (cache->end + CACHE_RECORD_HEADER_SIZE <= limit) {
+        const unsigned char *const record = cache->data + cache->end;
+        const size_t len = _get_u32(record);
+        if (len < CACHE_RECORD_HEADER_SIZE || len % 8 != 0
+            || len > limit - cache->end) {
+            break;
+        }
+        if (_get_u32(record + 4) != (uint32_t) _hash(record + 8, len - 8)) {
+            break;
+        }
+        SolutionCache_insert(cache, _get_u64(record + 8), cache->end);
+        cache->end += len;
+    }
+    return size;
+}
+
+SolutionCache *
+SolutionCache_open(const char *filename)
+{
+    const int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (_lock(fd, F_WRLCK) == TUBE_FAILURE) {
+        close(fd);
+        return NULL;
+    }
+    struct stat st;
+    unsigned char header[CACHE_HEADER_SIZE] = {0};
+    bool is_valid = (fstat(fd, &st) == 0);
+    if (is_valid == true && st.st_size == 0) {
+        memcpy(header, CACHE_MAGIC, sizeof CACHE_MAGIC - 1);
+        _put_uint(header + 8, CACHE_VERSION, 4);
+        is_valid = (pwrite(fd, header, sizeof header, 0) == sizeof header);
+    } else if (is_valid == true) {
+        is_valid = (pread(fd, header, sizeof header, 0) == sizeof header)
+                   && memcmp(header, CACHE_MAGIC, sizeof CACHE_MAGIC - 1) == 0
+                   && _get_u32(header + 8) == CACHE_VERSION;
+    }
+    _lock(fd, F_UNLCK);
+    if (is_valid == false) {
+        close(fd);
+        return NULL;
+    }
+
+    SolutionCache *cache = Alloc_malloc(ALLOC_CACHE, sizeof *cache);
+
+    cache->fd = fd;
+    cache->data = NULL;
+    cache->size = 0;
+    cache->end = CACHE_HEADER_SIZE;
+    cache->capacity = CACHE_INITIAL_CAPACITY;
+    cache->slots
+      = Alloc_calloc(ALLOC_CACHE, cache->capacity, sizeof *cache->slots);
+    cache->num_records = 0;
+
+    return cache;
+}
+
+void
+SolutionCache_close(SolutionCache *cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+
+    if (cache->data != NULL) {
+        munmap(cache->data, cache->size);
+    }
+    close(cache->fd);
+    Alloc_free(cache->slots);
+
+    Alloc_free(cache);
+}
+
+int
+SolutionCache_lookup(
+  SolutionCache *cache, const unsigned char *key, size_t len,
+  CacheEntry *entry, ActionLog *log
+)
+{
+    if (_lock(cache->fd, F_RDLCK) == TUBE_FAILURE) {
+        return TUBE_FAILURE;
+    }
+    SolutionCache_scan(cache);
+    _lock(cache->fd, F_UNLCK);
+
+    const uint64_t hash = _hash(key, len);
+    const long mask = cache->capacity - 1;
+    for (long i = (long) (hash & mask); cache->slots[i].offset != 0;
+         i = (i + 1) & mask) {
+        if (cache->slots[i].hash != hash) {
+            continue;
+        }
+        const unsigned char *const record
+          = cache->data + cache->slots[i].offset;
+        if (_get_u32(record + 16) != SOLVER_REVISION
+            || _get_u32(record + 24) != len
+            || memcmp(record + CACHE_RECORD_HEADER_SIZE, key, len) != 0) {
+            continue;
+        }
+        entry->status = (int) _get_u32(record + 20);
+        entry->num_moves = (int) _get_u32(record + 28);
+        entry->num_nodes = (long) _get_u64(record + 32);
+        entry->num_pours = (long) _get_u64(record + 40);
+        log->counter = 0;
+        const unsigned char *move = record + CACHE_RECORD_HEADER_SIZE + len;
+        for (int j = 0; j < entry->num_moves;
+             ++j, move += CACHE_ACTION_WIDTH) {
+            Action action;
+            ActionCode_decode(move, CACHE_ACTION_WIDTH, &action);
+            ActionLog_push_back(log, &action);
+        }
+        return TUBE_SUCCESS;
+    }
+    return TUBE_FAILURE;
+}
+
+int
+SolutionCache_store(
+  SolutionCache *cache, const unsigned char *key, size_t len,
+  const CacheEntry *entry, const ActionLog *log
+)
+{
+    const int num_moves = (log != NULL) ? log->counter : 0;
+    size_t size = CACHE_RECORD_HEADER_SIZE + len
+                  + CACHE_ACTION_WIDTH * (size_t) num_moves;
+    size = (size + 7) / 8 * 8;
+    if (size > UINT32_MAX) {
+        return TUBE_FAILURE;
+    }
+
+    unsigned char *record = Alloc_calloc(ALLOC_CACHE, size, 1);
+    _put_uint(record, size, 4);
+    _put_uint(record + 8, _hash(key, len), 8);
+    _put_uint(record + 16, SOLVER_REVISION, 4);
+    _put_uint(record + 20, (uint64_t) entry->status, 4);
+    _put_uint(record + 24, len, 4);
+    _put_uint(record + 28, (uint64_t) num_moves, 4);
+    _put_uint(record + 32, (uint64_t) entry->num_nodes, 8);
+    _put_uint(record + 40, (uint64_t) entry->num_pours, 8);
+    memcpy(record + CACHE_RECORD_HEADER_SIZE, key, len);
+    unsigned char *move = record + CACHE_RECORD_HEADER_SIZE + len;
+    for (int j = 0; j < num_moves; ++j, move += CACHE_ACTION_WIDTH) {
+        ActionCode_encode(move, CACHE_ACTION_WIDTH, &log->actions[j]);
+    }
+    _put_uint(record + 4, (uint32_t) _hash(record + 8, size - 8), 4);
+
+    int status = TUBE_FAILURE;
+    if (_lock(cache->fd, F_WRLCK) == TUBE_SUCCESS) {
+        /* Append at end of valid records (dropping a torn tail) */
+        if (SolutionCache_scan(cache) > cache->end) {
+            if (ftruncate(cache->fd, (off_t) cache->end) != 0) {
+                _lock(cache->fd, F_UNLCK);
+                Alloc_free(record);
+                return TUBE_FAILURE;
+            }
+        }
+        if (pwrite(cache->fd, record, size, (off_t) cache->end)
+            == (ssize_t) size) {
+            status = TUBE_SUCCESS;
+        }
+        _lock(cache->fd, F_UNLCK);
+    }
+
+    Alloc_free(record);
+    return status;
+}
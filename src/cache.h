@@ -0,0 +1,126 @@
+/** cache.h
+ *
+ * Header for the persistent solution cache of 'tubes'. The cache is a single
+ * append-only file of records, each holding the key of a game (its encoded
+ * initial board in canonical form, with tubes sorted and colors renamed, see
+ * GameInfo_lookup_solution()), the solver verdict, metadata and the moves of
+ * the solution (with the tube indices of the key).
+ * All integers are little-endian and records are 8-byte aligned, so the file
+ * can be memory-mapped as is.
+ *
+ *   offset  size  field
+ *        0     4  size of record (bytes)
+ *        4     4  checksum of bytes [8, size)
+ *        8     8  hash of key
+ *       16     4  solver revision (SOLVER_REVISION)
+ *       20     4  solver status enumerator
+ *       24     4  length of key (bytes)
+ *       28     4  number of moves
+ *       32     8  number of nodes
+ *       40     8  number of pours
+ *       48        key, then moves as ActionCode of 4 bytes (pairs of 16-bit
+ *                 tube indices, see log.h), then zero padding
+ *
+ * Several processes may share a cache: readers take a shared lock and writers
+ * an exclusive one (POSIX record locks), and a torn record (e.g., after a crash)
+ * ends the valid part of the file and is overwritten by the next append. A
+ * SolutionCache object must only be used by one thread at a time.
+ */
+
+#ifndef CACHE_H_INCLUDED
+#define CACHE_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log.h"
+
+#define CACHE_MAGIC "TUBECACH"
+#define CACHE_HEADER_SIZE 16
+
+/**
+ * Struct for verdict and metadata of a cached solve.
+ */
+typedef struct {
+    int status;
+    int num_moves;
+    long num_nodes;
+    long num_pours;
+} CacheEntry;
+
+/**
+ * Auxiliary struct for index slot (hash of key and offset of record).
+ */
+typedef struct {
+    uint64_t hash;
+    size_t offset; /* 0 for empty slot */
+} CacheSlot;
+
+/**
+ * Struct for (memory-mapped) solution cache.
+ */
+typedef struct {
+    int fd;
+    unsigned char *data;
+    size_t size; /* of mapping */
+    size_t end;  /* end of valid records */
+    CacheSlot *slots;
+    long capacity; /* power of two */
+    long num_records;
+} SolutionCache;
+
+/**
+ * Opens (or creates) solution cache `filename`.
+ *
+ * @param[in] filename name of cache file
+ *
+ * @return Pointer to newly allocated SolutionCache object or NULL on error
+ */
+SolutionCache *
+SolutionCache_open(const char *filename);
+
+/**
+ * Closes `cache` and frees memory.
+ *
+ * @param[in] cache SolutionCache to be closed
+ */
+void
+SolutionCache_close(SolutionCache *cache);
+
+/**
+ * Looks up game with key `key` of length `len` in `cache` (also picking up
+ * records appended by other processes). On a hit, writes the verdict to
+ * `entry` and the moves to `log` (only tube indices, no chunks).
+ *
+ * @param[in,out] cache SolutionCache to look up
+ * @param[in] key key of game
+ * @param[in] len length of key
+ * @param[out] entry CacheEntry to write verdict to
+ * @param[out] log ActionLog to write moves to
+ *
+ * @return Error code (TUBE_FAILURE on a miss)
+ */
+int
+SolutionCache_lookup(
+  SolutionCache *cache, const unsigned char *key, size_t len,
+  CacheEntry *entry, ActionLog *log
+);
+
+/**
+ * Appends record of game with key `key` of length `len` to `cache`.
+ *
+ * @param[in,out] cache SolutionCache to append to
+ * @param[in] key key of game
+ * @param[in] len length of key
+ * @param[in] entry CacheEntry with verdict
+ * @param[in] log ActionLog with moves of solution (or NULL)
+ *
+ * @return Error code
+ */
+int
+SolutionCache_store(
+  SolutionCache *cache, const unsigned char *key, size_t len,
+  const CacheEntry *entry, const ActionLog *log
+);
+
+#endif /* CACHE_H_INCLUDED */
@@ -0,0 +1,210 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "checkpoint.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "util.h"
+
+#define CHECKPOINT_NAME_BUFFER_SIZE 4096
+
+/**
+ * Auxiliary struct for checksummed stream of checkpoint.
+ */
+typedef struct {
+    FILE *stream;
+    uint64_t hash; /* FNV-1a of bytes so far */
+    bool is_ok;
+} CheckpointStream;
+
+/**
+ * Writes `len` bytes of `data` to `s`.
+ *
+ * @param[in,out] s CheckpointStream to write to
+ * @param[in] data bytes to write
+ * @param[in] len number of bytes
+ */
+static void
+_write(CheckpointStream *s, const unsigned char *data, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        s->hash = (s->hash ^ data[i]) * 0x100000001b3;
+    }
+    s->is_ok = s->is_ok && fwrite(data, 1, len, s->stream) == len;
+}
+
+/**
+ * Writes `value` as little-endian integer of `num_bytes` bytes to `s`.
+ *
+ * @param[in,out] s CheckpointStream to write to
+ * @param[in] value value to write
+ * @param[in] num_bytes number of bytes
+ */
+static void
+_write_uint(CheckpointStream *s, uint64_t value, int num_bytes)
+{
+    unsigned char buffer[8];
+    for (int i = 0; i < num_bytes; ++i) {
+        buffer[i] = (unsigned char) (value & 0xff);
+        value >>= 8;
+    }
+    _write(s, buffer, num_bytes);
+}
+
+/**
+ * Reads `len` bytes from `s` to `data`.
+ *
+ * @param[in,out] s CheckpointStream to read from
+ * @param[out] data buffer to read to
+ * @param[in] len number of bytes
+ */
+static void
+_read(CheckpointStream *s, unsigned char *data, size_t len)
+{
+    s->is_ok = s->is_ok && fread(data, 1, len, s->stream) == len;
+    if (s->is_ok == false) {
+        memset(data, 0, len);
+        return;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        s->hash = (s->hash ^ data[i]) * 0x100000001b3;
+    }
+}
+
+/**
+ * Reads little-endian integer of `num_bytes` bytes from `s`.
+ *
+ * @param[in,out] s CheckpointStream to read from
+ * @param[in] num_bytes number of bytes
+ *
+ * @return Integer (0 on error)
+ */
+static uint64_t
+_read_uint(CheckpointStream *s, int num_bytes)
+{
+    unsigned char buffer[8];
+    _read(s, buffer, num_bytes);
+    uint64_t value = 0;
+    for (int i = num_bytes - 1; i >= 0; --i) {
+        value = (value << 8) | buffer[i];
+    }
+    return value;
+}
+
+int
+Checkpoint_write(
+  const SolverCheckpoint *ckpt, const SolverContext *ctx, int depth,
+  long num_nodes, long num_pours
+)
+{
+    char name[CHECKPOINT_NAME_BUFFER_SIZE];
+    snprintf(name, sizeof name, "%s.tmp", ckpt->filename);
+    CheckpointStream s = {fopen(name, "wb"), 0xcbf29ce484222325, true};
+    if (s.stream == NULL) {
+        return TUBE_FAILURE;
+    }
+
+    _write(&s, (const unsigned char *) CHECKPOINT_MAGIC, 8);
+    _write_uint(&s, SOLVER_REVISION, 4);
+    _write_uint(&s, ckpt->len, 4);
+    _write_uint(&s, (uint64_t) depth, 4);
+    _write_uint(&s, 0, 4);
+    _write_uint(&s, (uint64_t) num_nodes, 8);
+    _write_uint(&s, (uint64_t) num_pours, 8);
+    _write_uint(&s, (uint64_t) ctx->visited.size, 8);
+    _write(&s, ckpt->key, ckpt->len);
+    for (int i = 0; i <= depth; ++i) {
+        _write_uint(&s, (uint64_t) ctx->frames[i], 4);
+    }
+    for (int i = 0; i < depth; ++i) {
+        unsigned char code[CHECKPOINT_ACTION_WIDTH];
+        ActionCode_encode(code, CHECKPOINT_ACTION_WIDTH, &ctx->log->actions[i]);
+        _write(&s, code, sizeof code);
+    }
+    const VisitedTable *const visited = &ctx->visited;
+    for (long i = 0; i < visited->capacity; ++i) {
+        if (visited->stamps[i] == visited->stamp) {
+            _write_uint(&s, visited->keys[i], 8);
+        }
+    }
+    _write_uint(&s, s.hash, 8);
+
+    s.is_ok = s.is_ok && fflush(s.stream) == 0
+              && fsync(fileno(s.stream)) == 0;
+    s.is_ok = (fclose(s.stream) == 0) && s.is_ok;
+    if (s.is_ok == false || rename(name, ckpt->filename) != 0) {
+        remove(name);
+        return TUBE_FAILURE;
+    }
+    return TUBE_SUCCESS;
+}
+
+int
+Checkpoint_read(
+  const SolverCheckpoint *ckpt, SolverContext *ctx, ActionLog *moves,
+  int *p_depth, long *p_num_nodes, long *p_num_pours
+)
+{
+    CheckpointStream s = {
+      fopen(ckpt->filename, "rb"), 0xcbf29ce484222325, true
+    };
+    if (s.stream == NULL) {
+        return TUBE_FAILURE;
+    }
+
+    unsigned char magic[8];
+    _read(&s, magic, sizeof magic);
+    const uint64_t revision = _read_uint(&s, 4);
+    const size_t len = (size_t) _read_uint(&s, 4);
+    const int depth = (int) _read_uint(&s, 4);
+    _read_uint(&s, 4);
+    const long num_nodes = (long) _read_uint(&s, 8);
+    const long num_pours = (long) _read_uint(&s, 8);
+    const long num_visited = (long) _read_uint(&s, 8);
+    if (s.is_ok == false || memcmp(magic, CHECKPOINT_MAGIC, 8) != 0
+        || revision != SOLVER_REVISION || len != ckpt->len || depth < 0
+        || depth > num_visited) {
+        fclose(s.stream);
+        return TUBE_FAILURE;
+    }
+    unsigned char *key = Alloc_malloc(ALLOC_SOLVER, len);
+    _read(&s, key, len);
+    const bool is_same = s.is_ok == true && memcmp(key, ckpt->key, len) == 0;
+    Alloc_free(key);
+    if (is_same == false) {
+        fclose(s.stream);
+        return TUBE_FAILURE;
+    }
+
+    SolverContext_reserve(ctx, depth);
+    for (int i = 0; i <= depth; ++i) {
+        ctx->frames[i] = (int) _read_uint(&s, 4);
+    }
+    moves->counter = 0;
+    for (int i = 0; i < depth && s.is_ok == true; ++i) {
+        unsigned char code[CHECKPOINT_ACTION_WIDTH];
+        Action action;
+        _read(&s, code, sizeof code);
+        ActionCode_decode(code, CHECKPOINT_ACTION_WIDTH, &action);
+        ActionLog_push_back(moves, &action);
+    }
+    for (long i = 0; i < num_visited && s.is_ok == true; ++i) {
+        VisitedTable_insert(&ctx->visited, _read_uint(&s, 8));
+    }
+    const uint64_t hash = s.hash;
+    const bool is_valid = _read_uint(&s, 8) == hash && s.is_ok == true;
+    fclose(s.stream);
+    if (is_valid == false) {
+        return TUBE_FAILURE;
+    }
+
+    *p_depth = depth;
+    *p_num_nodes = num_nodes;
+    *p_num_pours = num_pours;
+    return TUBE_SUCCESS;
+}
@@ -0,0 +1,77 @@
+/** checkpoint.h
+ *
+ * Header for checkpoints of the solver of 'tubes'. A checkpoint holds the full
+ * state of a search (explicit DFS stack, moves of the current path, visited
+ * table and counters), so a long search can be continued after a restart. It
+ * is written to a temporary file that is synced and then renamed over the
+ * checkpoint, so the checkpoint file is always complete. All integers are
+ * little-endian:
+ *
+ *   offset  size  field
+ *        0     8  CHECKPOINT_MAGIC
+ *        8     4  solver revision (SOLVER_REVISION)
+ *       12     4  length of key (encoded initial board, see cache.h)
+ *       16     4  depth
+ *       20     4  zero
+ *       24     8  number of nodes
+ *       32     8  number of pours
+ *       40     8  number of visited boards
+ *       48        key, then next source tube per depth (depth + 1 32-bit
+ *                 integers), then moves of path (depth ActionCode of 4 bytes,
+ *                 see log.h), then hashes of visited boards (64-bit), then
+ *                 64-bit FNV-1a checksum of all preceding bytes
+ */
+
+#ifndef CHECKPOINT_H_INCLUDED
+#define CHECKPOINT_H_INCLUDED
+
+#include <stddef.h>
+
+#include "log.h"
+#include "solver.h"
+
+#define CHECKPOINT_MAGIC "TUBECKP1"
+#define CHECKPOINT_HEADER_SIZE 48
+#define CHECKPOINT_ACTION_WIDTH 4 /* size of ActionCode of a move */
+
+/**
+ * Writes state of search in `ctx` at depth `depth` (with `num_nodes` nodes and
+ * `num_pours` pours so far) to checkpoint file of `ckpt` (atomically).
+ *
+ * @param[in] ckpt SolverCheckpoint with file name and key of search
+ * @param[in] ctx SolverContext of search
+ * @param[in] depth current depth of DFS
+ * @param[in] num_nodes number of nodes expanded
+ * @param[in] num_pours number of pours done
+ *
+ * @return Error code
+ */
+int
+Checkpoint_write(
+  const SolverCheckpoint *ckpt, const SolverContext *ctx, int depth,
+  long num_nodes, long num_pours
+);
+
+/**
+ * Reads checkpoint file of `ckpt` into `ctx` (which must be freshly reset): DFS
+ * stack and visited table are restored, the moves of the path are written to
+ * `moves` (only tube indices, no chunks) for the caller to replay. Fails if the
+ * file is missing, corrupt or of another board or solver revision (`ctx` then
+ * needs to be reset again).
+ *
+ * @param[in] ckpt SolverCheckpoint with file name and key of search
+ * @param[in,out] ctx SolverContext to restore
+ * @param[out] moves ActionLog to write moves of path to
+ * @param[out] p_depth pointer to depth of DFS
+ * @param[out] p_num_nodes pointer to number of nodes expanded
+ * @param[out] p_num_pours pointer to number of pours done
+ *
+ * @return Error code
+ */
+int
+Checkpoint_read(
+  const SolverCheckpoint *ckpt, SolverContext *ctx, ActionLog *moves,
+  int *p_depth, long *p_num_nodes, long *p_num_pours
+);
+
+#endif /* CHECKPOINT_H_INCLUDED */
@@ -0,0 +1,339 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "corpus.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "util.h"
+
+#define CORPUS_INITIAL_CAPACITY 1024
+#define CORPUS_EMPTY_BYTE 0xff
+#define CORPUS_MAX_DIM 0xffff
+
+/**
+ * Reads little-endian 16-bit integer from `p`.
+ *
+ * @param[in] p pointer to bytes
+ *
+ * @return Integer
+ */
+static uint16_t
+_get_u16(const unsigned char *p)
+{
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+/**
+ * Reads little-endian 64-bit integer from `p`.
+ *
+ * @param[in] p pointer to bytes
+ *
+ * @return Integer
+ */
+static uint64_t
+_get_u64(const unsigned char *p)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+/**
+ * Writes `value` as little-endian integer of `num_bytes` bytes to `out`.
+ *
+ * @param[in] out output FILE stream
+ * @param[in] value value to write
+ * @param[in] num_bytes number of bytes
+ */
+static void
+_put_uint(FILE *out, uint64_t value, int num_bytes)
+{
+    for (int i = 0; i < num_bytes; ++i) {
+        fputc((int) (value & 0xff), out);
+        value >>= 8;
+    }
+}
+
+/**
+ * Indexes games of text corpus `corpus` (games are separated by blank lines or
+ * header lines).
+ *
+ * @param[in,out] corpus Corpus to index
+ */
+static void
+Corpus_index_text(Corpus *corpus)
+{
+    long capacity = CORPUS_INITIAL_CAPACITY;
+    corpus->entries
+      = Alloc_malloc(ALLOC_CORPUS, capacity * sizeof *corpus->entries);
+    corpus->num_games = 0;
+
+    const char *const data = (const char *) corpus->data;
+    bool is_in_game = false;
+    int line = 1;
+    for (size_t pos = 0; pos < corpus->size; ++line) {
+        const char *eol = memchr(data + pos, '\n', corpus->size - pos);
+        const size_t end = (eol == NULL) ? corpus->size : (size_t) (eol - data);
+
+        size_t first = pos;
+        while (first < end
+               && (data[first] == ' ' || data[first] == '\t'
+                   || data[first] == '\r')) {
+            ++first;
+        }
+        if (first == end || data[first] == '#') {
+            is_in_game = false;
+        } else if (is_in_game == false) {
+            if (corpus->num_games == capacity) {
+                capacity *= 2;
+                corpus->entries = Alloc_realloc(
+                  ALLOC_CORPUS, corpus->entries,
+                  capacity * sizeof *corpus->entries
+                );
+            }
+            CorpusEntry *const entry = &corpus->entries[corpus->num_games++];
+            entry->offset = pos;
+            entry->len = end - pos;
+            entry->line = line;
+            is_in_game = true;
+        } else {
+            CorpusEntry *const entry = &corpus->entries[corpus->num_games - 1];
+            entry->len = end - entry->offset;
+        }
+        pos = end + 1;
+    }
+}
+
+/**
+ * Checks header of binary corpus `corpus` and sets number of games and their
+ * dimensions.
+ *
+ * @param[in,out] corpus Corpus to check
+ *
+ * @return Error code
+ */
+static int
+Corpus_check_binary(Corpus *corpus)
+{
+    if (corpus->size < CORPUS_HEADER_SIZE) {
+        return TUBE_FAILURE;
+    }
+    const uint64_t num_games = _get_u64(corpus->data + 8);
+    const size_t record_size
+      = (size_t) _get_u16(corpus->data + 16) * _get_u16(corpus->data + 18);
+    if (num_games > 0
+        && (record_size == 0
+            || num_games > (corpus->size - CORPUS_HEADER_SIZE) / record_size)) {
+        return TUBE_FAILURE;
+    }
+    corpus->num_games = (long) num_games;
+    corpus->num_tubes = _get_u16(corpus->data + 16);
+    corpus->num_slots = _get_u16(corpus->data + 18);
+    return TUBE_SUCCESS;
+}
+
+Corpus *
+Corpus_open(const char *filename)
+{
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || S_ISREG(st.st_mode) == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    Corpus *corpus = Alloc_calloc(ALLOC_CORPUS, 1, sizeof *corpus);
+    corpus->size = (size_t) st.st_size;
+    if (corpus->size > 0) {
+        void *map = mmap(NULL, corpus->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            Alloc_free(corpus);
+            return NULL;
+        }
+        corpus->data = map;
+    }
+    close(fd);
+
+    const size_t len_magic = sizeof CORPUS_MAGIC - 1;
+    if (corpus->size >= len_magic
+        && memcmp(corpus->data, CORPUS_MAGIC, len_magic) == 0) {
+        corpus->is_binary = true;
+        if (Corpus_check_binary(corpus) == TUBE_FAILURE) {
+            Corpus_close(corpus);
+            return NULL;
+        }
+    } else {
+        Corpus_index_text(corpus);
+    }
+
+    return corpus;
+}
+
+void
+Corpus_close(Corpus *corpus)
+{
+    if (corpus == NULL) {
+        return;
+    }
+
+    if (corpus->data != NULL) {
+        munmap((void *) corpus->data, corpus->size);
+    }
+    Alloc_free(corpus->entries);
+
+    Alloc_free(corpus);
+}
+
+/**
+ * Decodes record with index `index` of binary `corpus`.
+ *
+ * @param[in] corpus Corpus to read from
+ * @param[in] index index of game
+ *
+ * @return newly malloc'd Input object
+ */
+static Input *
+Corpus_decode(const Corpus *corpus, long index)
+{
+    const size_t num_tot = (size_t) corpus->num_tubes * corpus->num_slots;
+    const unsigned char *const record
+      = corpus->data + CORPUS_HEADER_SIZE + num_tot * (size_t) index;
+
+    Input *input = Alloc_malloc(ALLOC_CORPUS, sizeof *input);
+
+    input->num_tubes = corpus->num_tubes;
+    input->num_slots = corpus->num_slots;
+    input->num_colors = 0;
+    input->data = Alloc_malloc(ALLOC_CORPUS, num_tot * sizeof *input->data);
+    for (size_t i = 0; i < num_tot; ++i) {
+        input->data[i]
+          = (record[i] == CORPUS_EMPTY_BYTE) ? EMPTY_COLOR_INDEX : record[i];
+    }
+
+    return input;
+}
+
+Input *
+Corpus_read(const Corpus *corpus, long index, InputError *p_error)
+{
+    InputError aux;
+    if (p_error == NULL) {
+        p_error = &aux;
+    }
+    if (index < 0 || index >= corpus->num_games) {
+        p_error->code = INPUT_ERROR_OPEN;
+        p_error->line = 0;
+        p_error->expected = 0;
+        p_error->got = 0;
+        return NULL;
+    }
+
+    if (corpus->is_binary == false) {
+        const CorpusEntry *const entry = &corpus->entries[index];
+        Input *input = Input_parse(
+          (const char *) corpus->data + entry->offset, entry->len, p_error
+        );
+        if (input == NULL && p_error->line > 0) {
+            p_error->line += entry->line - 1;
+        }
+        return input;
+    }
+
+    p_error->code = INPUT_OK;
+    p_error->line = 0;
+    p_error->expected = 0;
+    p_error->got = 0;
+    Input *input = Corpus_decode(corpus, index);
+    if (Input_sanity_check(input) == TUBE_FAILURE) {
+        p_error->code = INPUT_ERROR_SANITY;
+        Input_destroy(input);
+        return NULL;
+    }
+    return input;
+}
+
+CorpusWriter *
+CorpusWriter_create(FILE *out)
+{
+    CorpusWriter *writer = Alloc_malloc(ALLOC_CORPUS, sizeof *writer);
+
+    writer->out = out;
+    writer->num_games = 0;
+    writer->num_tubes = 0;
+    writer->num_slots = 0;
+
+    /* Placeholder, written by CorpusWriter_finish() */
+    for (int i = 0; i < CORPUS_HEADER_SIZE; ++i) {
+        fputc(0, out);
+    }
+
+    return writer;
+}
+
+int
+CorpusWriter_add(CorpusWriter *writer, const Input *input)
+{
+    if (input->num_tubes > CORPUS_MAX_DIM
+        || input->num_slots > CORPUS_MAX_DIM) {
+        return TUBE_FAILURE;
+    }
+    if (writer->num_games > 0
+        && (input->num_tubes != writer->num_tubes
+            || input->num_slots != writer->num_slots)) {
+        return TUBE_FAILURE;
+    }
+    const int num_tot = input->num_tubes * input->num_slots;
+    for (int i = 0; i < num_tot; ++i) {
+        if (input->data[i] >= CORPUS_EMPTY_BYTE) {
+            return TUBE_FAILURE;
+        }
+    }
+
+    writer->num_tubes = input->num_tubes;
+    writer->num_slots = input->num_slots;
+    ++writer->num_games;
+    for (int i = 0; i < num_tot; ++i) {
+        const int color = input->data[i];
+        fputc(
+          (color == EMPTY_COLOR_INDEX) ? CORPUS_EMPTY_BYTE : color, writer->out
+        );
+    }
+
+    return TUBE_SUCCESS;
+}
+
+int
+CorpusWriter_finish(CorpusWriter *writer)
+{
+    FILE *const out = writer->out;
+    int status = TUBE_SUCCESS;
+    if (fseek(out, 0, SEEK_SET) != 0) {
+        status = TUBE_FAILURE;
+    } else {
+        fwrite(CORPUS_MAGIC, 1, sizeof CORPUS_MAGIC - 1, out);
+        _put_uint(out, (uint64_t) writer->num_games, 8);
+        _put_uint(out, (uint64_t) writer->num_tubes, 2);
+        _put_uint(out, (uint64_t) writer->num_slots, 2);
+        _put_uint(out, 0, 4);
+        _put_uint(out, 0, 8);
+    }
+    if (fflush(out) != 0 || ferror(out) != 0) {
+        status = TUBE_FAILURE;
+    }
+
+    Alloc_free(writer);
+
+    return status;
+}
@@ -0,0 +1,135 @@
+/** corpus.h
+ *
+ * Header for corpora (files holding many games) of 'tubes'. Two formats are
+ * supported:
+ *
+ * - Text: games in the input file format, separated by blank lines or header
+ *   lines starting with '#' (e.g., the output of bulk generation).
+ * - Binary: a header with the dimensions shared by all games, then packed
+ *   fixed-width records (one byte per slot, 0xff for empty slots). Game `i`
+ *   starts at offset 32 + i * (number of tubes) * (number of slots), so no
+ *   index is needed for random access and threads can read disjoint ranges
+ *   of games directly. All integers are little-endian.
+ *
+ *   offset  size  field
+ *        0     8  magic "TUBECRP2"
+ *        8     8  number of games
+ *       16     2  number of tubes
+ *       18     2  number of slots
+ *       20    12  reserved (0)
+ *
+ * Corpora are memory-mapped and read-only once opened, so several threads may
+ * read games from the same Corpus concurrently.
+ */
+
+#ifndef CORPUS_H_INCLUDED
+#define CORPUS_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "input.h"
+
+#define CORPUS_MAGIC "TUBECRP2"
+#define CORPUS_HEADER_SIZE 32
+
+/**
+ * Auxiliary struct for location of a game in a text corpus.
+ */
+typedef struct {
+    size_t offset;
+    size_t len;
+    int line; /* line of first row (1-based) */
+} CorpusEntry;
+
+/**
+ * Struct for (memory-mapped) corpus.
+ */
+typedef struct {
+    bool is_binary;
+    const unsigned char *data;
+    size_t size;
+    long num_games;
+    int num_tubes;        /* binary corpora only */
+    int num_slots;        /* binary corpora only */
+    CorpusEntry *entries; /* text corpora only */
+} Corpus;
+
+/**
+ * Opens corpus `filename` (binary if it starts with CORPUS_MAGIC, text
+ * otherwise) and indexes it.
+ *
+ * @param[in] filename name of corpus file
+ *
+ * @return Pointer to newly allocated Corpus object or NULL on error
+ */
+Corpus *
+Corpus_open(const char *filename);
+
+/**
+ * Closes `corpus` and frees memory.
+ *
+ * @param[in] corpus Corpus to be closed
+ */
+void
+Corpus_close(Corpus *corpus);
+
+/**
+ * Reads game with index `index` (0-based) of `corpus`. Records of binary
+ * corpora are decoded without any parsing.
+ *
+ * @param[in] corpus Corpus to read from
+ * @param[in] index index of game
+ * @param[out] p_error pointer to InputError to write error to (or NULL)
+ *
+ * @return newly malloc'd and initialized Input object or NULL on error
+ */
+Input *
+Corpus_read(const Corpus *corpus, long index, InputError *p_error);
+
+/**
+ * Struct for writer of binary corpus.
+ */
+typedef struct {
+    FILE *out;
+    long num_games;
+    int num_tubes; /* of all games (set by the first one) */
+    int num_slots; /* of all games (set by the first one) */
+} CorpusWriter;
+
+/**
+ * Creates CorpusWriter object writing to `out` (which must be seekable).
+ *
+ * @param[in] out output FILE stream
+ *
+ * @return Pointer to newly allocated CorpusWriter object
+ */
+CorpusWriter *
+CorpusWriter_create(FILE *out);
+
+/**
+ * Appends `input` to corpus of `writer`. All games of a binary corpus must
+ * have the dimensions of the first one.
+ *
+ * @param[in,out] writer CorpusWriter to write to
+ * @param[in] input Input of game
+ *
+ * @return Error code (e.g., if there are 255 colors or more or the dimensions
+ *         differ from the first game)
+ */
+int
+CorpusWriter_add(CorpusWriter *writer, const Input *input);
+
+/**
+ * Writes header of corpus of `writer` and destroys `writer`.
+ *
+ * @param[in] writer CorpusWriter to finish
+ *
+ * @return Error code
+ */
+int
+CorpusWriter_finish(CorpusWriter *writer);
+
+#endif /* CORPUS_H_INCLUDED */
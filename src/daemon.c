@@ -0,0 +1,478 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "daemon.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "bulk.h"
+#include "gameinfo.h"
+#include "json.h"
+#include "metrics.h"
+#include "queue.h"
+#include "ticker.h"
+#include "util.h"
+
+#define DAEMON_QUEUE_CAPACITY 1024
+#define DAEMON_LISTEN_BACKLOG 64
+
+/**
+ * Auxiliary struct for client connection (reference counted: reader plus all
+ * pending requests).
+ */
+typedef struct {
+    FILE *in;
+    FILE *out;
+    bool is_socket;
+    int refcount;
+    pthread_mutex_t mutex;
+} DaemonConn;
+
+/**
+ * Allocates and initializes DaemonConn object reading from `in` and writing to
+ * `out`.
+ *
+ * @param[in] in input FILE stream
+ * @param[in] out output FILE stream
+ * @param[in] is_socket close streams on release?
+ *
+ * @return Pointer to newly allocated DaemonConn object
+ */
+static DaemonConn *
+DaemonConn_create(FILE *in, FILE *out, bool is_socket)
+{
+    DaemonConn *conn = malloc(sizeof *conn);
+
+    conn->in = in;
+    conn->out = out;
+    conn->is_socket = is_socket;
+    conn->refcount = 1;
+    pthread_mutex_init(&conn->mutex, NULL);
+
+    return conn;
+}
+
+/**
+ * Adds reference to `conn`.
+ *
+ * @param[in] conn DaemonConn to reference
+ */
+static void
+DaemonConn_retain(DaemonConn *conn)
+{
+    pthread_mutex_lock(&conn->mutex);
+    ++conn->refcount;
+    pthread_mutex_unlock(&conn->mutex);
+}
+
+/**
+ * Removes reference to `conn` and destroys it if it was the last one.
+ *
+ * @param[in] conn DaemonConn to release
+ */
+static void
+DaemonConn_release(DaemonConn *conn)
+{
+    pthread_mutex_lock(&conn->mutex);
+    const int refcount = --conn->refcount;
+    pthread_mutex_unlock(&conn->mutex);
+    if (refcount > 0) {
+        return;
+    }
+
+    if (conn->is_socket == true) {
+        fclose(conn->in);
+        fclose(conn->out);
+    }
+    pthread_mutex_destroy(&conn->mutex);
+
+    free(conn);
+}
+
+/**
+ * Auxiliary struct for a single request.
+ */
+typedef struct {
+    DaemonConn *conn;
+    char *id;  /* NULL for untagged requests */
+    long seq;  /* number of request within connection */
+    char *line;
+    size_t len;
+} DaemonRequest;
+
+/**
+ * Auxiliary struct for shared state of daemon.
+ */
+typedef struct {
+    const DaemonOptions *opts;
+    Queue *requests;
+    SolutionCache *cache;        /* shared by workers (or NULL) */
+    pthread_mutex_t cache_mutex; /* record locks do not exclude threads */
+    DeadTable *dead;             /* boards proven unsolvable (all sizes) */
+    Metrics metrics;
+    bool is_stopped;             /* for metrics writer */
+    pthread_mutex_t mutex;
+    pthread_cond_t stop;
+} Daemon;
+
+/**
+ * Writes response to `req` to `out`.
+ *
+ * @param[in] out output FILE stream
+ * @param[in] req DaemonRequest to respond to
+ * @param[in] info solved GameInfo object (NULL if request was invalid)
+ * @param[in] result SolverResult of request
+ * @param[in] log ActionLog with solution
+ * @param[in] ms time for solving in milliseconds
+ */
+static void
+_fprint_response(
+  FILE *out, const DaemonRequest *req, const GameInfo *info,
+  const SolverResult *result, const ActionLog *log, double ms
+)
+{
+    fprintf(out, "{\"id\":");
+    if (req->id != NULL) {
+        Json_fprint_string(out, req->id);
+    } else {
+        fprintf(out, "%li", req->seq);
+    }
+    if (info == NULL) {
+        fprintf(out, ",\"status\":\"error\"}\n");
+        return;
+    }
+    static const char *const names[] = {
+      [SOLVER_SOLVED] = "solved",
+      [SOLVER_UNSOLVED] = "unsolved",
+      [SOLVER_ABORTED] = "aborted",
+    };
+    fprintf(
+      out, ",\"status\":\"%s\",\"moves\":%i,\"nodes\":%li,\"ms\":%.3f",
+      names[result->status], result->num_moves, result->num_nodes, ms
+    );
+    if (result->status == SOLVER_SOLVED) {
+        fprintf(out, ",\"solution\":[");
+        for (int i = 0; i < log->counter; ++i) {
+            const Action *const action = &log->actions[i];
+            fprintf(
+              out, "%s[%i,%i]", (i > 0) ? "," : "", action->i_src + 1,
+              action->i_dst + 1
+            );
+        }
+        fprintf(out, "]");
+    }
+    fprintf(out, "}\n");
+}
+
+/**
+ * Worker function: solves requests until the queue is closed. The ActionLog for
+ * solutions and the SolverContext are kept warm across requests, and the
+ * DeadTable is shared by all workers.
+ *
+ * @param[in] arg pointer to Daemon
+ *
+ * @return NULL
+ */
+static void *
+_worker(void *arg)
+{
+    Daemon *const daemon = arg;
+    const SolverLimits limits = {.max_nodes = daemon->opts->max_nodes};
+    ActionLog *log = ActionLog_create();
+    SolverContext *ctx = SolverContext_create();
+    ctx->dead = daemon->dead;
+
+    DaemonRequest *req;
+    while ((req = Queue_pop(daemon->requests)) != NULL) {
+        Metrics_begin_request(&daemon->metrics);
+        const double start = Ticker_now();
+        GameInfo *info = GameInfo_create_from_line(req->line, req->len);
+        SolverResult result = {0};
+        log->counter = 0;
+        int cache = METRICS_CACHE_NONE;
+        if (info != NULL && daemon->cache != NULL) {
+            pthread_mutex_lock(&daemon->cache_mutex);
+            cache = GameInfo_lookup_solution(info, daemon->cache, log, &result)
+                      ? METRICS_CACHE_HIT
+                      : METRICS_CACHE_MISS;
+            pthread_mutex_unlock(&daemon->cache_mutex);
+        }
+        if (info != NULL && cache != METRICS_CACHE_HIT) {
+            GameInfo_find_solution(info, ctx, log, &limits, &result);
+        }
+        if (cache == METRICS_CACHE_MISS && result.status == SOLVER_SOLVED) {
+            GameInfo_revert_all(info, ctx->log);
+        }
+        if (cache == METRICS_CACHE_MISS && result.status != SOLVER_ABORTED) {
+            pthread_mutex_lock(&daemon->cache_mutex);
+            GameInfo_store_solution(info, daemon->cache, log, &result);
+            pthread_mutex_unlock(&daemon->cache_mutex);
+        }
+        const double ms = (Ticker_now() - start) * 1e3;
+        Metrics_end_request(
+          &daemon->metrics, (info != NULL) ? result.status : METRICS_ERROR,
+          ms * 1e-3, (cache == METRICS_CACHE_HIT) ? 0 : result.num_nodes, cache
+        );
+
+        char *response = NULL;
+        size_t len = 0;
+        FILE *mem = open_memstream(&response, &len);
+        _fprint_response(mem, req, info, &result, log, ms);
+        fclose(mem);
+
+        DaemonConn *const conn = req->conn;
+        pthread_mutex_lock(&conn->mutex);
+        fwrite(response, 1, len, conn->out);
+        fflush(conn->out);
+        pthread_mutex_unlock(&conn->mutex);
+
+        free(response);
+        GameInfo_destroy(info);
+        free(req->line);
+        free(req->id);
+        free(req);
+        DaemonConn_release(conn);
+    }
+
+    SolverContext_destroy(ctx);
+    ActionLog_destroy(log);
+
+    return NULL;
+}
+
+/**
+ * Metrics writer thread function: replaces metrics file every
+ * DAEMON_METRICS_INTERVAL seconds until stopped (and once more at the end).
+ *
+ * @param[in] arg pointer to Daemon
+ *
+ * @return NULL
+ */
+static void *
+_metrics_writer(void *arg)
+{
+    Daemon *const daemon = arg;
+
+    pthread_mutex_lock(&daemon->mutex);
+    Ticker ticker;
+    Ticker_init(&ticker, DAEMON_METRICS_INTERVAL);
+    while (daemon->is_stopped == false) {
+        Ticker_wait(
+          &ticker, &daemon->stop, &daemon->mutex, &daemon->is_stopped
+        );
+        Metrics_write(
+          daemon->opts->metrics_path, &daemon->metrics,
+          Queue_size(daemon->requests)
+        );
+    }
+    pthread_mutex_unlock(&daemon->mutex);
+
+    return NULL;
+}
+
+/**
+ * Reads requests from `conn` and queues them until end of input. Releases
+ * `conn` afterwards.
+ *
+ * @param[in] daemon Daemon to queue requests for
+ * @param[in] conn DaemonConn to read from
+ */
+static void
+Daemon_read(Daemon *daemon, DaemonConn *conn)
+{
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t len;
+    long seq = 0;
+    while ((len = getline(&line, &capacity, conn->in)) > 0) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        if (len == 0) {
+            continue;
+        }
+        DaemonRequest *req = malloc(sizeof *req);
+        req->conn = conn;
+        req->id = NULL;
+        req->seq = seq++;
+        const char *rows = line;
+        const char *const colon = strchr(line, ':');
+        if (colon != NULL) {
+            const size_t idlen = colon - line;
+            req->id = malloc(idlen + 1);
+            memcpy(req->id, line, idlen);
+            req->id[idlen] = '\0';
+            rows = colon + 1;
+        }
+        req->len = len - (rows - line);
+        req->line = malloc(req->len + 1);
+        memcpy(req->line, rows, req->len + 1);
+        DaemonConn_retain(conn);
+        Queue_push(daemon->requests, req);
+    }
+    free(line);
+    DaemonConn_release(conn);
+}
+
+/**
+ * Auxiliary struct to hand over Daemon and connection to reader thread.
+ */
+typedef struct {
+    Daemon *daemon;
+    DaemonConn *conn;
+} DaemonReader;
+
+/**
+ * Reader thread function for socket connections.
+ *
+ * @param[in] arg pointer to (malloc'd) DaemonReader
+ *
+ * @return NULL
+ */
+static void *
+_reader(void *arg)
+{
+    DaemonReader *const reader = arg;
+    Daemon_read(reader->daemon, reader->conn);
+    free(reader);
+    return NULL;
+}
+
+/**
+ * Listens on Unix domain socket `path` and spawns a reader per connection.
+ *
+ * @param[in] daemon Daemon to serve
+ * @param[in] path path of socket
+ *
+ * @return Error code (only returns on error)
+ */
+static int
+Daemon_serve_socket(Daemon *daemon, const char *path)
+{
+    struct sockaddr_un addr = {0};
+    if (strlen(path) >= sizeof addr.sun_path) {
+        return TUBE_FAILURE;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    const int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return TUBE_FAILURE;
+    }
+    unlink(path);
+    if (bind(sock, (struct sockaddr *) &addr, sizeof addr) != 0
+        || listen(sock, DAEMON_LISTEN_BACKLOG) != 0) {
+        close(sock);
+        return TUBE_FAILURE;
+    }
+
+    for (;;) {
+        const int fd = accept(sock, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        const int fd_out = dup(fd);
+        FILE *in = fdopen(fd, "r");
+        FILE *out = (fd_out < 0) ? NULL : fdopen(fd_out, "w");
+        if (in == NULL || out == NULL) {
+            if (in != NULL) {
+                fclose(in);
+            } else {
+                close(fd);
+            }
+            if (fd_out >= 0 && out == NULL) {
+                close(fd_out);
+            }
+            continue;
+        }
+        DaemonReader *reader = malloc(sizeof *reader);
+        reader->daemon = daemon;
+        reader->conn = DaemonConn_create(in, out, true);
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, &_reader, reader) != 0) {
+            DaemonConn_release(reader->conn);
+            free(reader);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+
+    return TUBE_FAILURE;
+}
+
+int
+Daemon_run(const DaemonOptions *opts)
+{
+    Daemon daemon = {
+      .opts = opts,
+      .is_stopped = false,
+    };
+    if (opts->cache_path != NULL) {
+        daemon.cache = SolutionCache_open(opts->cache_path);
+        if (daemon.cache == NULL) {
+            return TUBE_FAILURE;
+        }
+    }
+    daemon.requests = Queue_create(DAEMON_QUEUE_CAPACITY);
+    daemon.dead = DeadTable_create();
+    pthread_mutex_init(&daemon.cache_mutex, NULL);
+    pthread_mutex_init(&daemon.mutex, NULL);
+    pthread_cond_init(&daemon.stop, NULL);
+
+    /* Clients may hang up before their responses are written */
+    signal(SIGPIPE, SIG_IGN);
+
+    int num_threads = opts->num_threads;
+    if (num_threads <= 0) {
+        num_threads = Bulk_num_cores();
+    }
+    Metrics_init(&daemon.metrics, num_threads);
+    pthread_t *workers = malloc(num_threads * sizeof *workers);
+    for (int i = 0; i < num_threads; ++i) {
+        if (pthread_create(&workers[i], NULL, &_worker, &daemon) != 0) {
+            ERROR("Could not create worker thread!");
+        }
+    }
+    pthread_t metrics_writer;
+    if (opts->metrics_path != NULL
+        && pthread_create(&metrics_writer, NULL, &_metrics_writer, &daemon)
+             != 0) {
+        ERROR("Could not create metrics thread!");
+    }
+
+    int res = TUBE_SUCCESS;
+    if (opts->socket_path != NULL) {
+        res = Daemon_serve_socket(&daemon, opts->socket_path);
+    } else {
+        Daemon_read(&daemon, DaemonConn_create(stdin, stdout, false));
+    }
+
+    Queue_close(daemon.requests);
+    for (int i = 0; i < num_threads; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    if (opts->metrics_path != NULL) {
+        pthread_mutex_lock(&daemon.mutex);
+        daemon.is_stopped = true;
+        pthread_cond_signal(&daemon.stop);
+        pthread_mutex_unlock(&daemon.mutex);
+        pthread_join(metrics_writer, NULL);
+    }
+    pthread_cond_destroy(&daemon.stop);
+    pthread_mutex_destroy(&daemon.mutex);
+    pthread_mutex_destroy(&daemon.cache_mutex);
+    Metrics_free(&daemon.metrics);
+    SolutionCache_close(daemon.cache);
+    DeadTable_destroy(daemon.dead);
+    Queue_destroy(daemon.requests);
+
+    return res;
+}
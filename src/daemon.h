@@ -0,0 +1,43 @@
+/** daemon.h
+ *
+ * Header for long-running solver daemon of 'tubes'. Reads newline-delimited
+ * requests from 'stdin' or a Unix domain socket, solves them concurrently and
+ * streams back one JSON response per request (tagged by request id).
+ *
+ * A request is a single line "[ID:] ROWS" with the tubes in the row format,
+ * separated by '|' or ';' (e.g., "42: 1 0 1 | 0 1 0 | -1 -1 -1"). Without ID,
+ * requests are numbered consecutively per connection.
+ *
+ * Optionally, verdicts are looked up in (and added to) a solution cache shared
+ * by all workers, and a snapshot of service metrics (see metrics.h) replaces a
+ * metrics file every DAEMON_METRICS_INTERVAL seconds and at the end.
+ */
+
+#ifndef DAEMON_H_INCLUDED
+#define DAEMON_H_INCLUDED
+
+#define DAEMON_METRICS_INTERVAL 1.0
+
+/**
+ * Struct for options of daemon.
+ */
+typedef struct {
+    const char *socket_path;  /* NULL to serve 'stdin'/'stdout' */
+    long max_nodes;           /* non-positive for unlimited */
+    int num_threads;          /* non-positive for number of online cores */
+    const char *cache_path;   /* solution cache file (or NULL) */
+    const char *metrics_path; /* Prometheus metrics file (or NULL) */
+} DaemonOptions;
+
+/**
+ * Runs daemon according to `opts`. Serving 'stdin' returns at its end, serving
+ * a socket never returns (unless on error).
+ *
+ * @param[in] opts DaemonOptions for daemon
+ *
+ * @return Error code (also if cache cannot be opened)
+ */
+int
+Daemon_run(const DaemonOptions *opts);
+
+#endif /* DAEMON_H_INCLUDED */
@@ -4,39 +4,44 @@
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#include "alloc.h"
+#include "cache.h"
+#include "checkpoint.h"
 #include "input.h"
 #include "log.h"
+#include "rng.h"
+#include "solver.h"
 #include "tube.h"
 #include "util.h"
 
 #define USER_INPUT_BUFFER_SIZE 16
+#define DETERMINIZE_MAX_TRIES 64
 
 /**
- * Auxiliary struct for color pool.
+ * Auxiliary struct for color pool (multiset of all colors of a game).
  */
 typedef struct {
-    int num_colors;
+    int size;
     int *data;
-    int num_slots;
 } ColorPool;
 
 /**
  * Allocates and initializes full ColorPool object of `num_colors` colors and
- * `num_slots` slots.
+ * `num_slots` slots, i.e., every color appears `num_slots` times.
  *
  * @return Pointer to newly allocated ColorPool object
  */
 static ColorPool *
 ColorPool_create_full(int num_colors, int num_slots)
 {
-    ColorPool *pool = malloc(sizeof *pool);
+    ColorPool *pool = Alloc_malloc(ALLOC_GAME, sizeof *pool);
 
-    pool->num_colors = num_colors;
-    pool->data = malloc(num_colors * sizeof *pool->data);
-    pool->num_slots = num_slots;
-    for (int i = 0; i < num_colors; ++i) {
-        pool->data[i] = num_slots;
+    pool->size = num_colors * num_slots;
+    pool->data = Alloc_malloc(ALLOC_GAME, pool->size * sizeof *pool->data);
+    for (int i = 0; i < pool->size; ++i) {
+        pool->data[i] = i / num_slots;
     }
 
     return pool;
@@ -54,45 +59,26 @@ ColorPool_destroy(ColorPool *pool)
         return;
     }
 
-    free(pool->data);
+    Alloc_free(pool->data);
 
-    free(pool);
+    Alloc_free(pool);
 }
 
 /**
- * Returns if `pool` is empty.
+ * Shuffles `pool` in place (Fisher-Yates) with random numbers from `rng`.
  *
- * @param[in] pool ColorPool to be checked
- *
- * @return Is `pool` empty?
+ * @param[in,out] pool ColorPool to shuffle
+ * @param[in,out] rng Rng to draw from
  */
-static bool
-ColorPool_is_empty(const ColorPool *pool)
+static void
+ColorPool_shuffle(ColorPool *pool, Rng *rng)
 {
-    for (int i = 0; i < pool->num_colors; ++i) {
-        if (pool->data[i] != 0) {
-            return false;
-        }
+    for (int i = pool->size - 1; i > 0; --i) {
+        const int j = (int) Rng_below(rng, (uint32_t) i + 1);
+        const int tmp = pool->data[i];
+        pool->data[i] = pool->data[j];
+        pool->data[j] = tmp;
     }
-    return true;
-}
-
-/**
- * Randomly picks and removes color from `pool` and returns it.
- *
- * @param[in] pool ColorPool to pick color from
- *
- * @return Randomly picked color
- */
-static int
-ColorPool_pick_color(ColorPool *pool)
-{
-    int color = EMPTY_COLOR_INDEX;
-    do {
-        color = rand() % pool->num_colors;
-    } while (pool->data[color] == 0);
-    --pool->data[color];
-    return color;
 }
 
 /**
@@ -108,13 +94,21 @@ ColorPool_pick_color(ColorPool *pool)
 static GameInfo *
 GameInfo_create(int num_colors, int num_extra, int num_slots)
 {
-    GameInfo *info = malloc(sizeof *info);
+    GameInfo *info = Alloc_malloc(ALLOC_GAME, sizeof *info);
 
     info->num_tubes = num_colors + num_extra;
     info->num_extra = num_extra;
-    info->tubes = malloc(info->num_tubes * sizeof *info->tubes);
+    info->tubes
+      = Alloc_malloc(ALLOC_GAME, info->num_tubes * sizeof *info->tubes);
+    info->ops = TubeOps_get(num_slots);
     info->seed = 0;
     info->filename = NULL;
+    info->solution_format = SOLUTION_TEXT;
+    info->profiler = NULL;
+    info->trace = NULL;
+    info->progress = NULL;
+    info->checkpoint = NULL;
+    info->hints = NULL;
 
     for (int i = 0; i < info->num_tubes; ++i) {
         info->tubes[i] = Tube_create(num_slots);
@@ -131,30 +125,176 @@ GameInfo_create_from_seed(
     GameInfo *info = GameInfo_create(num_colors, num_extra, num_slots);
 
     info->seed = seed;
-    srand(info->seed);
 
+    Rng rng;
+    Rng_seed(&rng, info->seed);
+
+    /* Shuffled multiset of colors is dealt to the first `num_colors` tubes */
     ColorPool *pool = ColorPool_create_full(num_colors, num_slots);
-    while (ColorPool_is_empty(pool) == false) {
-        const int color = ColorPool_pick_color(pool);
-        Tube *tube = NULL;
-        do {
-            const int i_tube = rand() % num_colors;
-            tube = info->tubes[i_tube];
-        } while (Tube_add_color(tube, color) != TUBE_SUCCESS);
+    ColorPool_shuffle(pool, &rng);
+    for (int i = 0; i < pool->size; ++i) {
+        Tube_add_color(info->tubes[i / num_slots], pool->data[i]);
     }
     ColorPool_destroy(pool);
 
     return info;
 }
 
+/**
+ * Auxiliary struct for scrambling: topmost chunk and number of free slots of
+ * each tube.
+ */
+typedef struct {
+    ColorChunk *tops;
+    int *num_free;
+} ScrambleState;
+
+/**
+ * Updates entries of `state` for tube with index `i_tube` of `info`.
+ *
+ * @param[in,out] state ScrambleState to update
+ * @param[in] info GameInfo object to read tube from
+ * @param[in] i_tube index of tube
+ */
+static void
+ScrambleState_update(ScrambleState *state, const GameInfo *info, int i_tube)
+{
+    Tube_get_top_chunk(info->tubes[i_tube], &state->tops[i_tube]);
+    state->num_free[i_tube] = Tube_count_free(info->tubes[i_tube]);
+}
+
+/**
+ * Enumerates legal reverse moves of `info` and writes the one with index `n` to
+ * `p_action` (as the forward action it reverts). A reverse move takes `count`
+ * slots from the top of tube `i_dst` to tube `i_src`, such that pouring back
+ * from `i_src` to `i_dst` is legal and moves exactly these slots: the color
+ * must differ from the top of `i_src` (so that the chunk is complete) and
+ * `i_dst` must either keep the color on top or become empty. The immediate
+ * inverse of `prev` (if not NULL) is skipped.
+ *
+ * @param[in] info GameInfo object to find reverse moves of
+ * @param[in] state ScrambleState of `info`
+ * @param[in] prev previous (forward) action
+ * @param[in] n index of reverse move to write (negative to only count)
+ * @param[out] p_action pointer to Action to write reverse move to
+ *
+ * @return Number of legal reverse moves (up to index `n` if found)
+ */
+static int
+GameInfo_nth_reverse_move(
+  const GameInfo *info, const ScrambleState *state, const Action *prev, int n,
+  Action *p_action
+)
+{
+    const int num_slots = info->tubes[0]->num_slots;
+    int ctr = 0;
+    for (int i_dst = 0; i_dst < info->num_tubes; ++i_dst) {
+        const ColorChunk *const top = &state->tops[i_dst];
+        if (top->color == EMPTY_COLOR_INDEX) {
+            continue;
+        }
+        const int num_filled = num_slots - state->num_free[i_dst];
+        for (int i_src = 0; i_src < info->num_tubes; ++i_src) {
+            if (i_src == i_dst || state->tops[i_src].color == top->color) {
+                continue;
+            }
+            int max_count = state->num_free[i_src];
+            if (max_count > top->count) {
+                max_count = top->count;
+            }
+            for (int count = 1; count <= max_count; ++count) {
+                if (count == top->count && count != num_filled) {
+                    continue;
+                }
+                if (prev != NULL && prev->i_src == i_dst
+                    && prev->i_dst == i_src && prev->chunk.count == count) {
+                    continue;
+                }
+                if (ctr == n) {
+                    p_action->i_src = i_src;
+                    p_action->i_dst = i_dst;
+                    p_action->chunk.color = top->color;
+                    p_action->chunk.count = count;
+                    return ctr + 1;
+                }
+                ++ctr;
+            }
+        }
+    }
+    return ctr;
+}
+
 GameInfo *
-GameInfo_create_from_file(const char *filename)
+GameInfo_create_from_scramble(
+  int num_colors, int num_extra, int num_slots, int seed, int num_moves,
+  ActionLog *log
+)
 {
-    Input *input = Input_read(filename);
-    if (input == NULL) {
-        return NULL;
+    GameInfo *info = GameInfo_create(num_colors, num_extra, num_slots);
+
+    info->seed = seed;
+
+    Rng rng;
+    Rng_seed(&rng, info->seed);
+
+    /* Start from solved board */
+    for (int i_tube = 0; i_tube < num_colors; ++i_tube) {
+        for (int i_slot = 0; i_slot < num_slots; ++i_slot) {
+            Tube_add_color(info->tubes[i_tube], i_tube);
+        }
+    }
+
+    ScrambleState state;
+    state.tops = Alloc_malloc(ALLOC_GAME, info->num_tubes * sizeof *state.tops);
+    state.num_free
+      = Alloc_malloc(ALLOC_GAME, info->num_tubes * sizeof *state.num_free);
+    for (int i_tube = 0; i_tube < info->num_tubes; ++i_tube) {
+        ScrambleState_update(&state, info, i_tube);
+    }
+
+    ActionLog *reverse = ActionLog_create();
+    const Action *prev = NULL;
+    for (int i = 0; i < num_moves; ++i) {
+        const int num = GameInfo_nth_reverse_move(info, &state, prev, -1, NULL);
+        if (num == 0) {
+            break;
+        }
+        Action action;
+        const int n = (int) Rng_below(&rng, (uint32_t) num);
+        GameInfo_nth_reverse_move(info, &state, prev, n, &action);
+        Tube *const tube_src = info->tubes[action.i_src];
+        Tube *const tube_dst = info->tubes[action.i_dst];
+        info->ops->revert(tube_src, tube_dst, &action.chunk);
+        ScrambleState_update(&state, info, action.i_src);
+        ScrambleState_update(&state, info, action.i_dst);
+        ActionLog_push_back(reverse, &action);
+        prev = &reverse->actions[reverse->counter - 1];
+    }
+
+    /* Replaying the reverted actions backwards solves the board */
+    if (log != NULL) {
+        for (int i = reverse->counter - 1; i >= 0; --i) {
+            ActionLog_push_back(log, &reverse->actions[i]);
+        }
     }
 
+    ActionLog_destroy(reverse);
+    Alloc_free(state.num_free);
+    Alloc_free(state.tops);
+
+    return info;
+}
+
+/**
+ * Creates GameInfo object from data of `input`.
+ *
+ * @param[in] input Input object to read data from
+ *
+ * @return Pointer to newly allocated and initialized GameInfo object
+ */
+static GameInfo *
+GameInfo_create_from_input(const Input *input)
+{
     const int num_tubes = input->num_tubes;
     const int num_colors = input->num_colors;
     const int num_slots = input->num_slots;
@@ -162,8 +302,6 @@ GameInfo_create_from_file(const char *filename)
 
     GameInfo *info = GameInfo_create(num_colors, num_extra, num_slots);
 
-    info->filename = filename;
-
     for (int i_tube = 0; i_tube < num_tubes; ++i_tube) {
         Tube *const tube = info->tubes[i_tube];
         for (int i_slot = 0; i_slot < num_slots; ++i_slot) {
@@ -172,11 +310,227 @@ GameInfo_create_from_file(const char *filename)
         }
     }
 
+    return info;
+}
+
+GameInfo *
+GameInfo_create_from_file(const char *filename, InputError *p_error)
+{
+    Input *input = Input_read(filename, p_error);
+    if (input == NULL) {
+        return NULL;
+    }
+
+    GameInfo *info = GameInfo_create_from_input(input);
+
+    info->filename = filename;
+
+    Input_destroy(input);
+
+    return info;
+}
+
+GameInfo *
+GameInfo_create_from_corpus(
+  const Corpus *corpus, long index, InputError *p_error
+)
+{
+    Input *input = Corpus_read(corpus, index, p_error);
+    if (input == NULL) {
+        return NULL;
+    }
+
+    GameInfo *info = GameInfo_create_from_input(input);
+
+    Input_destroy(input);
+
+    return info;
+}
+
+GameInfo *
+GameInfo_create_from_buffer(const char *buffer, size_t len, InputError *p_error)
+{
+    Input *input = Input_parse(buffer, len, p_error);
+    if (input == NULL) {
+        return NULL;
+    }
+
+    GameInfo *info = GameInfo_create_from_input(input);
+
+    Input_destroy(input);
+
+    return info;
+}
+
+GameInfo *
+GameInfo_create_from_line(const char *line, size_t len)
+{
+    Input *input = Input_parse_line(line, len);
+    if (input == NULL) {
+        return NULL;
+    }
+
+    GameInfo *info = GameInfo_create_from_input(input);
+
     Input_destroy(input);
 
     return info;
 }
 
+GameInfo *
+GameInfo_copy(const GameInfo *info)
+{
+    GameInfo *copy = GameInfo_create(
+      info->num_tubes - info->num_extra, info->num_extra,
+      info->tubes[0]->num_slots
+    );
+    copy->seed = info->seed;
+    copy->filename = info->filename;
+    copy->solution_format = info->solution_format;
+    GameInfo_assign(copy, info);
+    return copy;
+}
+
+void
+GameInfo_assign(GameInfo *dst, const GameInfo *src)
+{
+    for (int i = 0; i < src->num_tubes; ++i) {
+        const Tube *const tube = src->tubes[i];
+        memcpy(
+          dst->tubes[i]->slots, tube->slots,
+          tube->num_slots * sizeof *tube->slots
+        );
+    }
+}
+
+void
+GameInfo_hide(GameInfo *info, int num_hidden)
+{
+    for (int i = 0; i < info->num_tubes; ++i) {
+        Tube *const tube = info->tubes[i];
+        for (int j = 0; j < num_hidden && j < tube->num_slots; ++j) {
+            tube->slots[j].is_hidden
+              = tube->slots[j].color != EMPTY_COLOR_INDEX;
+        }
+        Tube_reveal(tube);
+    }
+}
+
+int
+GameInfo_count_hidden(const GameInfo *info)
+{
+    int count = 0;
+    for (int i = 0; i < info->num_tubes; ++i) {
+        const Tube *const tube = info->tubes[i];
+        for (int j = 0; j < tube->num_slots; ++j) {
+            count += tube->slots[j].is_hidden == true;
+        }
+    }
+    return count;
+}
+
+/**
+ * Returns if determinization `sample` of `info` is consistent with the
+ * visible slots of `info`, i.e., no hidden slot belongs to a topmost chunk of
+ * `sample` (it would be visible otherwise).
+ *
+ * @param[in] info GameInfo object with hidden slots
+ * @param[in] sample determinization of `info`
+ *
+ * @return Is `sample` consistent?
+ */
+static bool
+GameInfo_is_consistent(const GameInfo *info, const GameInfo *sample)
+{
+    for (int i = 0; i < info->num_tubes; ++i) {
+        const Tube *const tube = info->tubes[i];
+        ColorChunk chunk;
+        Tube_get_top_chunk(sample->tubes[i], &chunk);
+        const int i_top = tube->num_slots - Tube_count_free(tube) - 1;
+        for (int j = i_top; j > i_top - chunk.count; --j) {
+            if (tube->slots[j].is_hidden == true) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int
+GameInfo_determinize(const GameInfo *info, GameInfo *sample, Rng *rng)
+{
+    const int num_colors = info->num_tubes - info->num_extra;
+    const int num_slots = info->tubes[0]->num_slots;
+    ColorPool *pool = ColorPool_create_full(num_colors, num_slots);
+    int *counts = Alloc_calloc(ALLOC_GAME, num_colors, sizeof *counts);
+    int num_hidden = 0;
+    bool is_valid = true;
+    for (int i = 0; i < info->num_tubes; ++i) {
+        const Tube *const tube = info->tubes[i];
+        for (int j = 0; j < tube->num_slots; ++j) {
+            const TubeSlot *const slot = &tube->slots[j];
+            if (slot->is_hidden == true) {
+                ++num_hidden;
+            } else if (slot->color >= num_colors) {
+                is_valid = false;
+            } else if (slot->color != EMPTY_COLOR_INDEX) {
+                ++counts[slot->color];
+            }
+        }
+    }
+    /* Pool keeps only colors not visible */
+    pool->size = 0;
+    for (int color = 0; color < num_colors && is_valid == true; ++color) {
+        is_valid = counts[color] <= num_slots;
+        for (int j = counts[color]; j < num_slots; ++j) {
+            pool->data[pool->size++] = color;
+        }
+    }
+    Alloc_free(counts);
+    if (is_valid == false || pool->size != num_hidden) {
+        ColorPool_destroy(pool);
+        return TUBE_FAILURE;
+    }
+
+    bool is_consistent = false;
+    for (int i_try = 0; i_try < DETERMINIZE_MAX_TRIES; ++i_try) {
+        ColorPool_shuffle(pool, rng);
+        GameInfo_assign(sample, info);
+        int i_pool = 0;
+        for (int i = 0; i < sample->num_tubes; ++i) {
+            const Tube *const tube = sample->tubes[i];
+            for (int j = 0; j < tube->num_slots; ++j) {
+                if (tube->slots[j].is_hidden == true) {
+                    tube->slots[j].color = pool->data[i_pool++];
+                    tube->slots[j].is_hidden = false;
+                }
+            }
+        }
+        is_consistent = GameInfo_is_consistent(info, sample);
+        if (is_consistent == true) {
+            break;
+        }
+    }
+    ColorPool_destroy(pool);
+    return (is_consistent == true) ? TUBE_SUCCESS : TUBE_FAILURE;
+}
+
+uint64_t
+GameInfo_hash(const GameInfo *info)
+{
+    uint64_t hash = 0;
+    for (int i = 0; i < info->num_tubes; ++i) {
+        const Tube *const tube = info->tubes[i];
+        uint64_t hidden = 0;
+        for (int j = 0; j < tube->num_slots; ++j) {
+            hidden = (hidden << 1) | (tube->slots[j].is_hidden == true);
+        }
+        hash = hash * 0x9e3779b97f4a7c15 + Solver_hash_tube(tube)
+               + Rng_mix64(hidden);
+    }
+    return hash;
+}
+
 void
 GameInfo_destroy(GameInfo *info)
 {
@@ -187,9 +541,9 @@ GameInfo_destroy(GameInfo *info)
     for (int i = 0; i < info->num_tubes; ++i) {
         Tube_destroy(info->tubes[i]);
     }
-    free(info->tubes);
+    Alloc_free(info->tubes);
 
-    free(info);
+    Alloc_free(info);
 }
 
 /**
@@ -210,7 +564,7 @@ GameInfo_fprint(FILE *out, const GameInfo *info)
         for (int i_slot = 0; i_slot < tube->num_slots; ++i_slot) {
             const TubeSlot *const slot = &tube->slots[i_slot];
             if (slot->is_hidden) {
-                fprintf(out, " %*c", color_width, '?');
+                fprintf(out, "%*c", color_width, '?');
             } else {
                 fprintf(out, "% *i", color_width, slot->color);
             }
@@ -222,18 +576,23 @@ GameInfo_fprint(FILE *out, const GameInfo *info)
     }
 }
 
-/**
- * Returns if `info` is solved (all tubes are uniformly filled).
- *
- * @param[in] info GameInfo object to be checked
- *
- * @return Is `info` solved?
- */
-static bool
+void
+GameInfo_fprint_raw(FILE *out, const GameInfo *info)
+{
+    for (int i_tube = 0; i_tube < info->num_tubes; ++i_tube) {
+        const Tube *const tube = info->tubes[i_tube];
+        for (int i_slot = 0; i_slot < tube->num_slots; ++i_slot) {
+            const char *const sep = (i_slot < tube->num_slots - 1) ? " " : "\n";
+            fprintf(out, "%i%s", tube->slots[i_slot].color, sep);
+        }
+    }
+}
+
+bool
 GameInfo_is_solved(const GameInfo *info)
 {
     for (int i = 0; i < info->num_tubes; ++i) {
-        if (Tube_is_pure(info->tubes[i]) == false) {
+        if (info->ops->is_pure(info->tubes[i]) == false) {
             return false;
         }
     }
@@ -260,7 +619,7 @@ GameInfo_pour(GameInfo *info, int i_src, int i_dst, ActionLog *log)
     Tube *const tube_src = info->tubes[i_src];
     Tube *const tube_dst = info->tubes[i_dst];
     Action action = {.i_src = i_src, i_dst = i_dst};
-    if (Tube_pour(tube_src, tube_dst, &action.chunk) != TUBE_SUCCESS) {
+    if (info->ops->pour(tube_src, tube_dst, &action.chunk) != TUBE_SUCCESS) {
         return TUBE_FAILURE;
     }
     ActionLog_push_back(log, &action);
@@ -286,7 +645,7 @@ GameInfo_revert_one(GameInfo *info, ActionLog *log)
     Tube *const tube_src = info->tubes[action.i_src];
     Tube *const tube_dst = info->tubes[action.i_dst];
     const ColorChunk *const p_chunk = &action.chunk;
-    Tube_revert(tube_src, tube_dst, p_chunk);
+    info->ops->revert(tube_src, tube_dst, p_chunk);
     return TUBE_SUCCESS;
 }
 
@@ -341,6 +700,7 @@ enum {
     INPUT_VALID,
     INPUT_INVALID,
     INPUT_REVERT,
+    INPUT_HINT,
     INPUT_QUIT,
 };
 
@@ -373,6 +733,8 @@ _parse_input(int *p_i_src, int *p_i_dst)
             return INPUT_QUIT;
         case 'r':
             return INPUT_REVERT;
+        case 'h':
+            return INPUT_HINT;
         default:
             return INPUT_INVALID;
         }
@@ -391,6 +753,35 @@ _parse_input(int *p_i_src, int *p_i_dst)
     return INPUT_VALID;
 }
 
+/**
+ * Prints hint for current board of `info` (see GameInfo_play()).
+ *
+ * @param[in] info GameInfo object to print hint for
+ */
+static void
+GameInfo_print_hint(const GameInfo *info)
+{
+    if (info->hints == NULL) {
+        printf("No hints available.\n");
+        return;
+    }
+    int i_src, i_dst;
+    switch (info->hints->get(info->hints->data, info, &i_src, &i_dst)) {
+    case HINT_MOVE:
+        printf("Hint: %i %i\n", i_src + 1, i_dst + 1);
+        break;
+    case HINT_PENDING:
+        printf("Hint: still thinking, try again.\n");
+        break;
+    case HINT_UNSOLVED:
+        printf("Hint: no solution from here, revert with 'r'.\n");
+        break;
+    case HINT_ABORTED:
+        printf("Hint: no solution found within node limit.\n");
+        break;
+    }
+}
+
 void
 GameInfo_play(GameInfo *info)
 {
@@ -398,8 +789,13 @@ GameInfo_play(GameInfo *info)
         return;
     }
 
+    ProfileSpan span = Profiler_begin(info->profiler, "render");
     GameInfo_fprint(stdout, info);
     printf("\n");
+    Profiler_end(info->profiler, &span);
+    if (info->hints != NULL) {
+        info->hints->update(info->hints->data, info);
+    }
 
     ActionLog *log = ActionLog_create();
     int i_src, i_dst;
@@ -409,18 +805,30 @@ GameInfo_play(GameInfo *info)
         if (input == INPUT_QUIT) {
             break;
         }
+        int error = TUBE_FAILURE;
         switch (input) {
         case INPUT_VALID:
-            GameInfo_pour(info, i_src, i_dst, log);
+            error = GameInfo_pour(info, i_src, i_dst, log);
+            if (error == TUBE_SUCCESS) {
+                Tube_reveal(info->tubes[i_src]);
+            }
             break;
         case INPUT_REVERT:
-            GameInfo_revert_one(info, log);
+            error = GameInfo_revert_one(info, log);
             break;
+        case INPUT_HINT:
+            GameInfo_print_hint(info);
+            continue;
         case INPUT_INVALID:
             continue;
         }
+        if (error == TUBE_SUCCESS && info->hints != NULL) {
+            info->hints->update(info->hints->data, info);
+        }
+        span = Profiler_begin(info->profiler, "render");
         GameInfo_fprint(stdout, info);
         printf("\n");
+        Profiler_end(info->profiler, &span);
         if (GameInfo_is_solved(info) == true) {
             printf("Conglaturation!\n");
             break;
@@ -430,104 +838,671 @@ GameInfo_play(GameInfo *info)
 }
 
 /**
- * Checks if pouring content of tube with index `i_src` to tube with index
- * `i_dst` (both in `info`) is pointless (uniform tube to empty tube, i.e., does
- * not change situation).
+ * Encodes board of `info` as key (number of tubes and slots as 16-bit
+ * little-endian integers, then one byte per slot, 0xff for empty), taking the
+ * tubes in order `order` and renaming the colors by `names` (both NULL to
+ * encode the board as is).
  *
- * @param[in] info GameInfo object to perform action on
+ * @param[in] info GameInfo object to encode
+ * @param[in] order indices of tubes in order of key (or NULL)
+ * @param[in] names new name of every color (or NULL)
+ * @param[out] p_key pointer to newly malloc'd key
+ *
+ * @return Length of key or 0 if board cannot be encoded
+ */
+static size_t
+GameInfo_encode_board(
+  const GameInfo *info, const int *order, const int *names,
+  unsigned char **p_key
+)
+{
+    const int num_slots = info->tubes[0]->num_slots;
+    if (info->num_tubes > 0xffff || num_slots > 0xffff) {
+        return 0;
+    }
+    const size_t len = 4 + (size_t) info->num_tubes * num_slots;
+    unsigned char *key = Alloc_malloc(ALLOC_GAME, len);
+    key[0] = (unsigned char) (info->num_tubes & 0xff);
+    key[1] = (unsigned char) (info->num_tubes >> 8);
+    key[2] = (unsigned char) (num_slots & 0xff);
+    key[3] = (unsigned char) (num_slots >> 8);
+    unsigned char *p = key + 4;
+    for (int k = 0; k < info->num_tubes; ++k) {
+        const Tube *const tube = info->tubes[(order != NULL) ? order[k] : k];
+        for (int i_slot = 0; i_slot < num_slots; ++i_slot, ++p) {
+            const int color = tube->slots[i_slot].color;
+            if (color >= 0xff) {
+                Alloc_free(key);
+                return 0;
+            }
+            if (color == EMPTY_COLOR_INDEX) {
+                *p = 0xff;
+            } else {
+                *p = (unsigned char) ((names != NULL) ? names[color] : color);
+            }
+        }
+    }
+    *p_key = key;
+    return len;
+}
+
+/**
+ * Compares tubes `a` and `b` slot by slot (bottom first, empty slots last) by
+ * the depth profiles `profiles` of their colors (for every color, the number
+ * of its slots at every depth), which do not depend on names of colors or on
+ * order of tubes.
+ *
+ * @param[in] a first tube
+ * @param[in] b second tube
+ * @param[in] profiles `num_slots` counts per color
+ *
+ * @return Negative, zero or positive like strcmp()
+ */
+static int
+GameInfo_compare_profiles(const Tube *a, const Tube *b, const int *profiles)
+{
+    const int num_slots = a->num_slots;
+    for (int i_slot = 0; i_slot < num_slots; ++i_slot) {
+        const int color_a = a->slots[i_slot].color;
+        const int color_b = b->slots[i_slot].color;
+        if (color_a == EMPTY_COLOR_INDEX || color_b == EMPTY_COLOR_INDEX) {
+            return (color_a == EMPTY_COLOR_INDEX)
+                   - (color_b == EMPTY_COLOR_INDEX);
+        }
+        const int *const profile_a = &profiles[color_a * num_slots];
+        const int *const profile_b = &profiles[color_b * num_slots];
+        for (int depth = 0; depth < num_slots; ++depth) {
+            if (profile_a[depth] != profile_b[depth]) {
+                return profile_a[depth] - profile_b[depth];
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Compares tubes `a` and `b` slot by slot (bottom first, empty slots last) by
+ * the new names `names` of their colors.
+ *
+ * @param[in] a first tube
+ * @param[in] b second tube
+ * @param[in] names new name of every color
+ *
+ * @return Negative, zero or positive like strcmp()
+ */
+static int
+GameInfo_compare_names(const Tube *a, const Tube *b, const int *names)
+{
+    for (int i_slot = 0; i_slot < a->num_slots; ++i_slot) {
+        const int color_a = a->slots[i_slot].color;
+        const int color_b = b->slots[i_slot].color;
+        const int name_a
+          = (color_a == EMPTY_COLOR_INDEX) ? 0xff : names[color_a];
+        const int name_b
+          = (color_b == EMPTY_COLOR_INDEX) ? 0xff : names[color_b];
+        if (name_a != name_b) {
+            return name_a - name_b;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Sorts tube indices `order` of `info` by `compare` with auxiliary data `aux`
+ * (insertion sort, so tubes comparing equal keep their order).
+ *
+ * @param[in] info GameInfo object with tubes
+ * @param[in,out] order indices of tubes to sort
+ * @param[in] compare comparison function of tubes
+ * @param[in] aux auxiliary data of `compare`
+ */
+static void
+GameInfo_sort_tubes(
+  const GameInfo *info, int *order,
+  int (*compare)(const Tube *, const Tube *, const int *), const int *aux
+)
+{
+    for (int k = 1; k < info->num_tubes; ++k) {
+        const int i_tube = order[k];
+        int j = k;
+        for (; j > 0
+               && compare(info->tubes[order[j - 1]], info->tubes[i_tube], aux)
+                    > 0;
+             --j) {
+            order[j] = order[j - 1];
+        }
+        order[j] = i_tube;
+    }
+}
+
+/**
+ * Encodes board of `info` as canonical key for SolutionCache, which is the
+ * same for boards that only differ by names of colors or order of tubes. The
+ * tubes are sorted by the depth profiles of their colors, the colors renamed
+ * in order of first appearance (bottom up) and the tubes sorted again by the
+ * new names. Tubes that no profile tells apart keep their relative order, so
+ * such boards may still get different keys (but never a wrong one). Writes the
+ * index of the tube of `info` at every position of the key to `order`.
+ *
+ * @param[in] info GameInfo object to encode
+ * @param[out] order `info->num_tubes` indices of tubes in order of key
+ * @param[out] p_key pointer to newly malloc'd key
+ *
+ * @return Length of key or 0 if board cannot be encoded
+ */
+static size_t
+GameInfo_cache_key(const GameInfo *info, int *order, unsigned char **p_key)
+{
+    const int num_slots = info->tubes[0]->num_slots;
+    int num_colors = 0;
+    for (int i_tube = 0; i_tube < info->num_tubes; ++i_tube) {
+        const Tube *const tube = info->tubes[i_tube];
+        for (int i_slot = 0; i_slot < num_slots; ++i_slot) {
+            const int color = tube->slots[i_slot].color;
+            if (color >= 0xff) {
+                return 0;
+            }
+            if (color != EMPTY_COLOR_INDEX && color >= num_colors) {
+                num_colors = color + 1;
+            }
+        }
+    }
+
+    int *profiles = Alloc_calloc(
+      ALLOC_GAME, (size_t) num_colors * num_slots, sizeof *profiles
+    );
+    for (int i_tube = 0; i_tube < info->num_tubes; ++i_tube) {
+        const Tube *const tube = info->tubes[i_tube];
+        for (int i_slot = 0; i_slot < num_slots; ++i_slot) {
+            const int color = tube->slots[i_slot].color;
+            if (color != EMPTY_COLOR_INDEX) {
+                ++profiles[color * num_slots + i_slot];
+            }
+        }
+        order[i_tube] = i_tube;
+    }
+    GameInfo_sort_tubes(info, order, &GameInfo_compare_profiles, profiles);
+
+    int names[0xff];
+    int num_names = 0;
+    for (int color = 0; color < num_colors; ++color) {
+        names[color] = -1;
+    }
+    for (int k = 0; k < info->num_tubes; ++k) {
+        const Tube *const tube = info->tubes[order[k]];
+        for (int i_slot = 0; i_slot < num_slots; ++i_slot) {
+            const int color = tube->slots[i_slot].color;
+            if (color != EMPTY_COLOR_INDEX && names[color] < 0) {
+                names[color] = num_names++;
+            }
+        }
+    }
+    GameInfo_sort_tubes(info, order, &GameInfo_compare_names, names);
+    Alloc_free(profiles);
+
+    return GameInfo_encode_board(info, order, names, p_key);
+}
+
+/**
+ * Recomputes hash, topmost chunk and number of free slots of tube with index
+ * `i` of `info` in `ctx` and updates hash of board accordingly.
+ *
+ * @param[in] info GameInfo object to hash
+ * @param[in,out] ctx SolverContext to update
+ * @param[in] i index of tube
+ */
+static void
+GameInfo_solver_update_tube(const GameInfo *info, SolverContext *ctx, int i)
+{
+    const Tube *const tube = info->tubes[i];
+    const uint64_t hash = Solver_hash_tube(tube);
+    ctx->hash += hash - ctx->tube_hashes[i];
+    ctx->tube_hashes[i] = hash;
+    Tube_get_top_chunk(tube, &ctx->tops[i]);
+    ctx->num_free[i] = Tube_count_free(tube);
+}
+
+/**
+ * Updates state of tubes with indices `i_src` and `i_dst` of `info` in `ctx`
+ * after a pour between them.
+ *
+ * @param[in] info GameInfo object to hash
+ * @param[in,out] ctx SolverContext to update
  * @param[in] i_src index of source tube
  * @param[in] i_dst index of destination tube
+ */
+static void
+GameInfo_solver_update(
+  const GameInfo *info, SolverContext *ctx, int i_src, int i_dst
+)
+{
+    GameInfo_solver_update_tube(info, ctx, i_src);
+    GameInfo_solver_update_tube(info, ctx, i_dst);
+}
+
+/**
+ * Returns if tube with index `i` of board of search in `ctx` is pure (empty or
+ * full with one color).
  *
- * @return Error code
+ * @param[in] ctx SolverContext of search
+ * @param[in] i index of tube
+ * @param[in] num_slots number of slots per tube
+ *
+ * @return Is tube pure?
  */
 static bool
-GameInfo_pour_is_pointless(const GameInfo *info, int i_src, int i_dst)
+GameInfo_solver_is_pure(const SolverContext *ctx, int i, int num_slots)
 {
-    const Tube *const tube_src = info->tubes[i_src];
-    const Tube *const tube_dst = info->tubes[i_dst];
-    if (Tube_is_one_color(tube_src) == true && Tube_is_pure(tube_dst) == true) {
-        return true;
+    return ctx->num_free[i] == num_slots || ctx->tops[i].count == num_slots;
+}
+
+/**
+ * Returns lower bound on number of moves needed to solve `info`: the number of
+ * color changes between adjacent slots (a pour removes at most one of them).
+ *
+ * @param[in] info GameInfo object to estimate
+ *
+ * @return Lower bound on number of moves left
+ */
+static int
+GameInfo_lower_bound(const GameInfo *info)
+{
+    int bound = 0;
+    for (int i_tube = 0; i_tube < info->num_tubes; ++i_tube) {
+        const Tube *const tube = info->tubes[i_tube];
+        for (int i_slot = 1; i_slot < tube->num_slots; ++i_slot) {
+            const int color = tube->slots[i_slot].color;
+            bound += color != EMPTY_COLOR_INDEX
+                     && color != tube->slots[i_slot - 1].color;
+        }
     }
-    return false;
+    return bound;
+}
+
+/**
+ * Reverts last action of search in `ctx` on `info` and updates hashes.
+ *
+ * @param[in] info GameInfo object to perform action on
+ * @param[in,out] ctx SolverContext of search
+ */
+static void
+GameInfo_solver_revert(GameInfo *info, SolverContext *ctx)
+{
+    const Action *const action = &ctx->log->actions[ctx->log->counter - 1];
+    const int i_src = action->i_src;
+    const int i_dst = action->i_dst;
+    GameInfo_revert_one(info, ctx->log);
+    GameInfo_solver_update(info, ctx, i_src, i_dst);
+    SOLVER_TRACE(ctx, TRACE_REVERT, i_src, i_dst);
 }
 
 /**
- * Loops over destination tubes for naive backtracking solver of `info` with
- * ActionLog `log`.
+ * Returns if board of search in `ctx` on `info` is solved (all tubes pure).
+ *
+ * @param[in] info GameInfo object of search
+ * @param[in] ctx SolverContext of search
+ *
+ * @return Is board solved?
+ */
+static bool
+GameInfo_solver_is_solved(const GameInfo *info, const SolverContext *ctx)
+{
+    const int num_slots = info->tubes[0]->num_slots;
+    for (int i = 0; i < info->num_tubes; ++i) {
+        if (GameInfo_solver_is_pure(ctx, i, num_slots) == false) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Loops over destination tubes for backtracking solver of `info` with
+ * SolverContext `ctx`. Pours that cannot succeed are skipped by the topmost
+ * chunks and free slots in `ctx` alone, as are pointless pours and pours into
+ * a second empty tube (same board as into the first one). Pours leading to an
+ * already visited board or one known to be unsolvable are undone and skipped.
  *
  * @param[in] info GameInfo object to check for solution
- * @param[out] log ActionLog to write to work with
+ * @param[in,out] ctx SolverContext of search
  * @param[in] i_src index of source tube
+ * @param[in,out] result SolverResult to count pours in
  *
  * @return Error code of pouring try
  */
 static int
-GameInfo_solver_loop_dst(GameInfo *info, ActionLog *log, int i_src)
+GameInfo_solver_loop_dst(
+  GameInfo *info, SolverContext *ctx, int i_src, SolverResult *result
+)
 {
+    const int num_slots = info->tubes[i_src]->num_slots;
+    const ColorChunk top = ctx->tops[i_src];
+    const bool is_one_color = top.count + ctx->num_free[i_src] == num_slots;
+    bool is_empty_tried = false;
     for (int i_dst = 0; i_dst < info->num_tubes; ++i_dst) {
-        if (i_dst == i_src) {
+        const int num_free = ctx->num_free[i_dst];
+        if (i_dst == i_src || num_free < top.count) {
             continue;
         }
-        if (GameInfo_pour_is_pointless(info, i_src, i_dst) == true) {
+        const bool is_empty = num_free == num_slots;
+        if (is_empty == false && ctx->tops[i_dst].color != top.color) {
             continue;
         }
-        if (GameInfo_pour(info, i_src, i_dst, log) == TUBE_SUCCESS) {
-            return TUBE_SUCCESS;
+        if (is_empty == true
+            && (is_one_color == true || is_empty_tried == true)) {
+            SOLVER_STATS_INC(ctx, pruned);
+            SOLVER_TRACE(ctx, TRACE_PRUNE, i_src, i_dst);
+            continue;
+        }
+        is_empty_tried = is_empty_tried || is_empty;
+        SOLVER_STATS_INC(ctx, pours_tried);
+        if (GameInfo_pour(info, i_src, i_dst, ctx->log) == TUBE_SUCCESS) {
+            SOLVER_STATS_INC(ctx, pours_done);
+            ++result->num_pours;
+            GameInfo_solver_update(info, ctx, i_src, i_dst);
+            if (ctx->dead != NULL
+                && DeadTable_contains(ctx->dead, ctx->hash) == true) {
+                SOLVER_STATS_INC(ctx, dead_hits);
+                SOLVER_TRACE(ctx, TRACE_VISITED, i_src, i_dst);
+                GameInfo_solver_revert(info, ctx);
+                continue;
+            }
+            if (VisitedTable_insert(&ctx->visited, ctx->hash) == true) {
+                SOLVER_TRACE(ctx, TRACE_POUR, i_src, i_dst);
+                return TUBE_SUCCESS;
+            }
+            SOLVER_STATS_INC(ctx, visited_hits);
+            SOLVER_TRACE(ctx, TRACE_VISITED, i_src, i_dst);
+            GameInfo_solver_revert(info, ctx);
         }
     }
     return TUBE_FAILURE;
 }
 
 /**
- * Loops over source tubes for naive backtracking solver of `info` with
- * ActionLog `log`.
+ * Resets `ctx` for a new search of `info` and initializes the hashes, topmost
+ * chunks and free slots of its tubes and the hash of its board.
  *
- * @param[in] info GameInfo object to check for solution
- * @param[out] log ActionLog to write to work with
+ * @param[in] info GameInfo object to search
+ * @param[out] ctx SolverContext to initialize
+ */
+static void
+GameInfo_solver_init(const GameInfo *info, SolverContext *ctx)
+{
+    SolverContext_reset(ctx, info->num_tubes);
+    for (int i = 0; i < info->num_tubes; ++i) {
+        ctx->tube_hashes[i] = 0;
+        GameInfo_solver_update_tube(info, ctx, i);
+    }
+}
+
+/**
+ * Returns if board of search in `ctx` on `info` is unsolvable for a reason
+ * found without search: it is known to be dead or no pour is possible at all.
  *
- * @return Found solution?
+ * @param[in] info GameInfo object of search (in its initial, unsolved state)
+ * @param[in] ctx SolverContext of search (freshly initialized)
+ *
+ * @return Is board hopeless?
  */
 static bool
-GameInfo_solver_loop_src(GameInfo *info, ActionLog *log)
+GameInfo_solver_is_hopeless(const GameInfo *info, const SolverContext *ctx)
 {
+    if (ctx->dead != NULL && DeadTable_contains(ctx->dead, ctx->hash) == true) {
+        return true;
+    }
+    const int num_slots = info->tubes[0]->num_slots;
     for (int i_src = 0; i_src < info->num_tubes; ++i_src) {
-        if (Tube_is_pure(info->tubes[i_src]) == true) {
+        const ColorChunk *const top = &ctx->tops[i_src];
+        if (top->count == 0) {
             continue;
         }
-        if (GameInfo_solver_loop_dst(info, log, i_src) == TUBE_SUCCESS) {
-            if (GameInfo_is_solved(info) == true) {
-                return true;
+        for (int i_dst = 0; i_dst < info->num_tubes; ++i_dst) {
+            if (i_dst != i_src && ctx->num_free[i_dst] >= top->count
+                && (ctx->num_free[i_dst] == num_slots
+                    || ctx->tops[i_dst].color == top->color)) {
+                return false;
             }
-            if (GameInfo_solver_loop_src(info, log) == true) {
-                return true;
-            }
-            GameInfo_revert_one(info, log);
         }
     }
-    return false;
+    return true;
 }
 
 /**
- * Returns if GameInfo object `info` is solvable and writes first found solution
- * to `log` (if not NULL).
+ * Writes checkpoint of search in `ctx` at depth `depth` (if the interval of
+ * its SolverCheckpoint has passed).
+ *
+ * @param[in] ctx SolverContext of search
+ * @param[in] depth current depth of DFS
+ * @param[in] result SolverResult with counters of search
+ */
+static void
+GameInfo_solver_checkpoint(
+  SolverContext *ctx, int depth, const SolverResult *result
+)
+{
+    SolverCheckpoint *const ckpt = ctx->checkpoint;
+    const time_t now = time(NULL);
+    if (ckpt->len == 0 || difftime(now, ckpt->last) < ckpt->interval) {
+        return;
+    }
+    if (Checkpoint_write(
+          ckpt, ctx, depth, result->num_nodes, result->num_pours
+        )
+        == TUBE_SUCCESS) {
+        ++ckpt->num_written;
+    }
+    ckpt->last = now;
+}
+
+/**
+ * Continues search of `info` in `ctx` from its checkpoint: restores DFS stack,
+ * visited table and counters and replays the moves of the path.
+ *
+ * @param[in] info GameInfo object of search (in its initial state)
+ * @param[in,out] ctx SolverContext of search (freshly reset)
+ * @param[out] p_depth pointer to depth of DFS
+ * @param[in,out] result SolverResult to write counters to
+ *
+ * @return Error code (`info` and `ctx` need to be reset on failure)
+ */
+static int
+GameInfo_solver_resume(
+  GameInfo *info, SolverContext *ctx, int *p_depth, SolverResult *result
+)
+{
+    ActionLog *moves = ActionLog_create();
+    int res = Checkpoint_read(
+      ctx->checkpoint, ctx, moves, p_depth, &result->num_nodes,
+      &result->num_pours
+    );
+    for (int i = 0; i < moves->counter && res == TUBE_SUCCESS; ++i) {
+        const int i_src = moves->actions[i].i_src;
+        const int i_dst = moves->actions[i].i_dst;
+        res = (i_src < info->num_tubes && i_dst < info->num_tubes)
+                ? GameInfo_pour(info, i_src, i_dst, ctx->log)
+                : TUBE_FAILURE;
+        if (res == TUBE_SUCCESS) {
+            GameInfo_solver_update(info, ctx, i_src, i_dst);
+        }
+    }
+    ActionLog_destroy(moves);
+    if (res == TUBE_FAILURE) {
+        GameInfo_revert_all(info, ctx->log);
+    }
+    return res;
+}
+
+/**
+ * Loops over source tubes for backtracking solver of `info` with SolverContext
+ * `ctx` (depth-first search with explicit stack in `ctx->frames`, holding the
+ * next source tube to try per depth), starting at depth `depth` (whose board
+ * has been expanded already). Gives up (and sets the status of `result`
+ * accordingly) once more nodes than allowed by `limits` have been expanded;
+ * the board is then left as is. A board without any pour is added to the
+ * DeadTable of `ctx` (if any) right away, whatever the outcome of the search.
  *
  * @param[in] info GameInfo object to check for solution
- * @param[out] log ActionLog to write solution to (if found)
+ * @param[in,out] ctx SolverContext of search
+ * @param[in] limits SolverLimits to obey
+ * @param[in,out] result SolverResult to count nodes and pours in
+ * @param[in] depth depth to start at
  *
  * @return Found solution?
  */
 static bool
-GameInfo_find_solution(GameInfo *info, ActionLog *log)
+GameInfo_solver_loop_src(
+  GameInfo *info, SolverContext *ctx, const SolverLimits *limits,
+  SolverResult *result, int depth
+)
 {
-    ActionLog *auxlog = ActionLog_create();
-    const bool res = GameInfo_solver_loop_src(info, auxlog);
-    if (log != NULL && res == true) {
-        ActionLog tmp = *log;
-        *log = *auxlog;
-        *auxlog = tmp;
+    const int num_slots = info->tubes[0]->num_slots;
+    while (depth >= 0) {
+        int i_src = ctx->frames[depth];
+        const bool is_fresh = i_src == 0;
+        const long num_pours = result->num_pours;
+        for (; i_src < info->num_tubes; ++i_src) {
+            if (GameInfo_solver_is_pure(ctx, i_src, num_slots) == true) {
+                continue;
+            }
+            if (GameInfo_solver_loop_dst(info, ctx, i_src, result)
+                == TUBE_SUCCESS) {
+                break;
+            }
+        }
+        ctx->frames[depth] = i_src + 1;
+        if (i_src == info->num_tubes) {
+            SOLVER_STATS_INC(ctx, backtracks);
+            /* Not a single pour from the board: a dead end in every game */
+            if (ctx->dead != NULL && is_fresh == true
+                && result->num_pours == num_pours) {
+                DeadTable_insert(ctx->dead, ctx->hash);
+            }
+            if (--depth >= 0) {
+                GameInfo_solver_revert(info, ctx);
+            }
+            continue;
+        }
+        if (GameInfo_solver_is_solved(info, ctx) == true) {
+            return true;
+        }
+        ++result->num_nodes;
+        SOLVER_TRACE(ctx, TRACE_EXPAND, 0, 0);
+        if (ctx->progress != NULL
+            && (result->num_nodes & (SOLVER_PROGRESS_INTERVAL - 1)) == 0) {
+            SolverProgress_publish(
+              ctx, SOLVER_PROGRESS_INTERVAL, GameInfo_lower_bound(info), false
+            );
+        }
+        if (limits->max_nodes > 0 && result->num_nodes > limits->max_nodes) {
+            result->status = SOLVER_ABORTED;
+            return false;
+        }
+        SolverContext_reserve(ctx, ++depth);
+        SOLVER_STATS_MAX(ctx, max_depth, depth);
+        ctx->frames[depth] = 0;
+        if (ctx->checkpoint != NULL
+            && (result->num_nodes & (SOLVER_PROGRESS_INTERVAL - 1)) == 0) {
+            GameInfo_solver_checkpoint(ctx, depth, result);
+        }
     }
-    ActionLog_destroy(auxlog);
-    return res;
+    return false;
+}
+
+int
+GameInfo_find_solution(
+  GameInfo *info, SolverContext *ctx, ActionLog *log,
+  const SolverLimits *limits, SolverResult *result
+)
+{
+    static const SolverLimits no_limits = {0};
+    if (limits == NULL) {
+        limits = &no_limits;
+    }
+    SolverResult aux = {0};
+    if (result == NULL) {
+        result = &aux;
+    }
+    result->status = SOLVER_UNSOLVED;
+    result->num_moves = 0;
+    result->num_nodes = 0;
+    result->num_pours = 0;
+
+    SolverContext *const own_ctx = ctx == NULL ? SolverContext_create() : NULL;
+    if (ctx == NULL) {
+        ctx = own_ctx;
+    }
+    GameInfo_solver_init(info, ctx);
+    SolverCheckpoint *const ckpt = ctx->checkpoint;
+    int depth = 0;
+    if (ckpt != NULL) {
+        ckpt->len = GameInfo_encode_board(info, NULL, NULL, &ckpt->key);
+        ckpt->last = time(NULL);
+        ckpt->is_resumed
+          = ckpt->do_resume == true && ckpt->len > 0
+            && GameInfo_solver_resume(info, ctx, &depth, result)
+                 == TUBE_SUCCESS;
+        if (ckpt->do_resume == true && ckpt->is_resumed == false) {
+            GameInfo_solver_init(info, ctx);
+            depth = 0;
+            result->num_nodes = 0;
+            result->num_pours = 0;
+        }
+    }
+
+    bool is_solved = false;
+    if (ckpt == NULL || ckpt->is_resumed == false) {
+        VisitedTable_insert(&ctx->visited, ctx->hash);
+        SOLVER_TRACE(ctx, TRACE_BEGIN, 0, 0);
+        ctx->frames[depth] = 0;
+        ++result->num_nodes;
+        SOLVER_TRACE(ctx, TRACE_EXPAND, 0, 0);
+        /* The DFS only checks boards after a pour, so check the root here */
+        if (GameInfo_solver_is_solved(info, ctx) == true) {
+            is_solved = true;
+            depth = -1;
+        } else if (limits->max_nodes > 0
+                   && result->num_nodes > limits->max_nodes) {
+            result->status = SOLVER_ABORTED;
+            depth = -1;
+        } else if (GameInfo_solver_is_hopeless(info, ctx) == true) {
+            depth = -1;
+        }
+    }
+    if (depth >= 0) {
+        is_solved
+          = GameInfo_solver_loop_src(info, ctx, limits, result, depth);
+    }
+    if (ckpt != NULL) {
+        if (result->status != SOLVER_ABORTED) {
+            remove(ckpt->filename);
+        }
+        Alloc_free(ckpt->key);
+        ckpt->key = NULL;
+        ckpt->len = 0;
+    }
+    ctx->stats.nodes = result->num_nodes;
+    if (ctx->progress != NULL) {
+        SolverProgress_publish(
+          ctx, result->num_nodes & (SOLVER_PROGRESS_INTERVAL - 1),
+          GameInfo_lower_bound(info), true
+        );
+    }
+    if (is_solved == true) {
+        result->status = SOLVER_SOLVED;
+        result->num_moves = ctx->log->counter;
+        if (log != NULL) {
+            ActionLog_copy(log, ctx->log);
+        }
+    } else if (result->status == SOLVER_ABORTED) {
+        GameInfo_revert_all(info, ctx->log);
+    } else {
+        /* Exhaustive failure (or hopeless root): all visited boards are dead */
+        SolverContext_learn_dead(ctx);
+    }
+    SOLVER_TRACE(ctx, TRACE_END, result->status, 0);
+    SolverContext_destroy(own_ctx);
+    return result->status;
 }
 
 /**
@@ -536,7 +1511,8 @@ GameInfo_find_solution(GameInfo *info, ActionLog *log)
  *
  * @param[in] info GameInfo object to generate output FILE from
  *
- * @return FILE stream for solution output file
+ * @return FILE stream for solution output file (or NULL if it could not be
+ *         opened, which is reported to stderr)
  */
 static FILE *
 GameInfo_solution_file(const GameInfo *info)
@@ -545,37 +1521,172 @@ GameInfo_solution_file(const GameInfo *info)
     if (info->filename == NULL) {
         const size_t len = (size_t) log10(info->seed) + 1;
         const size_t maxlen = len + sizeof "seed.solution";
-        filename = malloc(maxlen * sizeof *filename);
+        filename = Alloc_malloc(ALLOC_GAME, maxlen * sizeof *filename);
         snprintf(filename, maxlen, "seed%u.solution", info->seed);
     } else {
         const size_t len = strlen(info->filename);
         const size_t maxlen = len + sizeof ".solution";
-        filename = malloc(maxlen * sizeof *filename);
+        filename = Alloc_malloc(ALLOC_GAME, maxlen * sizeof *filename);
         snprintf(filename, maxlen, "%s.solution", info->filename);
     }
-    FILE *out = fopen(filename, "w");
-    free(filename);
+    const bool is_binary = info->solution_format == SOLUTION_BINARY;
+    FILE *out = fopen(filename, (is_binary == true) ? "wb" : "w");
+    if (out == NULL) {
+        fprintf(stderr, "Could not open solution file '%s'!\n", filename);
+    }
+    Alloc_free(filename);
     return out;
 }
 
+bool
+GameInfo_lookup_solution(
+  GameInfo *info, SolutionCache *cache, ActionLog *log, SolverResult *result
+)
+{
+    int *order = Alloc_malloc(ALLOC_GAME, info->num_tubes * sizeof *order);
+    unsigned char *key = NULL;
+    const size_t len = GameInfo_cache_key(info, order, &key);
+    CacheEntry entry;
+    bool is_valid
+      = len > 0
+        && SolutionCache_lookup(cache, key, len, &entry, log) == TUBE_SUCCESS
+        && (entry.status == SOLVER_SOLVED || entry.status == SOLVER_UNSOLVED);
+    Alloc_free(key);
+
+    /* A cached solution is only accepted if it actually solves `info` */
+    if (is_valid == true && entry.status == SOLVER_SOLVED) {
+        ActionLog *replay = ActionLog_create();
+        for (int i = 0; i < log->counter && is_valid == true; ++i) {
+            Action *const action = &log->actions[i];
+            is_valid = (action->i_src < info->num_tubes)
+                       && (action->i_dst < info->num_tubes);
+            if (is_valid == true) {
+                /* Moves are stored with tube indices of the key */
+                action->i_src = order[action->i_src];
+                action->i_dst = order[action->i_dst];
+                is_valid = GameInfo_pour(
+                             info, action->i_src, action->i_dst, replay
+                           )
+                           == TUBE_SUCCESS;
+            }
+        }
+        is_valid = is_valid && GameInfo_is_solved(info);
+        GameInfo_revert_all(info, replay);
+        ActionLog_destroy(replay);
+    }
+    Alloc_free(order);
+    if (is_valid == false) {
+        return false;
+    }
+
+    result->status = entry.status;
+    result->num_moves = entry.num_moves;
+    result->num_nodes = entry.num_nodes;
+    result->num_pours = entry.num_pours;
+    return true;
+}
+
+int
+GameInfo_store_solution(
+  const GameInfo *info, SolutionCache *cache, const ActionLog *log,
+  const SolverResult *result
+)
+{
+    if (result->status != SOLVER_SOLVED && result->status != SOLVER_UNSOLVED) {
+        return TUBE_FAILURE;
+    }
+    int *order = Alloc_malloc(ALLOC_GAME, info->num_tubes * sizeof *order);
+    unsigned char *key = NULL;
+    const size_t len = GameInfo_cache_key(info, order, &key);
+    if (len == 0) {
+        Alloc_free(order);
+        return TUBE_FAILURE;
+    }
+
+    /* Moves are stored with tube indices of the key */
+    ActionLog *moves = NULL;
+    if (log != NULL) {
+        int *positions
+          = Alloc_malloc(ALLOC_GAME, info->num_tubes * sizeof *positions);
+        for (int k = 0; k < info->num_tubes; ++k) {
+            positions[order[k]] = k;
+        }
+        moves = ActionLog_create();
+        for (int i = 0; i < log->counter; ++i) {
+            const Action action = {
+              .i_src = positions[log->actions[i].i_src],
+              .i_dst = positions[log->actions[i].i_dst],
+            };
+            ActionLog_push_back(moves, &action);
+        }
+        Alloc_free(positions);
+    }
+    const CacheEntry entry = {
+      .status = result->status,
+      .num_moves = result->num_moves,
+      .num_nodes = result->num_nodes,
+      .num_pours = result->num_pours,
+    };
+    const int res = SolutionCache_store(cache, key, len, &entry, moves);
+    ActionLog_destroy(moves);
+    Alloc_free(key);
+    Alloc_free(order);
+    return res;
+}
+
 void
-GameInfo_solve(GameInfo *info)
+GameInfo_solve(GameInfo *info, SolutionCache *cache, SolverStats *stats)
 {
     if (info == NULL) {
         return;
     }
 
+    if (stats != NULL) {
+        *stats = (SolverStats) {0};
+    }
+    ProfileSpan span = Profiler_begin(info->profiler, "solve");
     ActionLog *log = ActionLog_create();
-    if (GameInfo_find_solution(info, log) == true) {
-        ActionLog *duplog = ActionLog_duplicate(log);
-        GameInfo_revert_all(info, duplog);
-        ActionLog_destroy(duplog);
+    SolverResult result = {0};
+    if (cache == NULL
+        || GameInfo_lookup_solution(info, cache, log, &result) == false) {
+        SolverContext *ctx = SolverContext_create();
+        ctx->trace = info->trace;
+        ctx->progress = info->progress;
+        ctx->checkpoint = info->checkpoint;
+        const clock_t start = clock();
+        if (GameInfo_find_solution(info, ctx, log, NULL, &result)
+            == SOLVER_SOLVED) {
+            GameInfo_revert_all(info, ctx->log);
+        }
+        ctx->stats.seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+        if (stats != NULL) {
+            *stats = ctx->stats;
+        }
+        SolverContext_destroy(ctx);
+        if (cache != NULL) {
+            GameInfo_store_solution(info, cache, log, &result);
+        }
+    }
+    Profiler_end(info->profiler, &span);
 
+    if (result.status == SOLVER_SOLVED) {
+        span = Profiler_begin(info->profiler, "write_solution");
         FILE *out = GameInfo_solution_file(info);
-        GameInfo_fprint(out, info);
-        fprintf(out, "\n");
-        ActionLog_fprint(out, log);
-        fclose(out);
+        if (out != NULL) {
+            if (info->solution_format == SOLUTION_TEXT) {
+                GameInfo_fprint(out, info);
+                fprintf(out, "\n");
+            }
+            SolutionWriter *writer = SolutionWriter_create(
+              out, info->solution_format, info->num_tubes, log->counter
+            );
+            for (int i = 0; i < log->counter; ++i) {
+                SolutionWriter_write(writer, &log->actions[i]);
+            }
+            SolutionWriter_destroy(writer);
+            fclose(out);
+        }
+        Profiler_end(info->profiler, &span);
     }
     ActionLog_destroy(log);
 }
@@ -9,19 +9,83 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "cache.h"
+#include "corpus.h"
+#include "input.h"
 #include "log.h"
+#include "profile.h"
+#include "rng.h"
+#include "solver.h"
+
+typedef struct GameHints GameHints;
 
 /**
- * Struct for general game information and state.
+ * Struct for general game information and state. The hooks from `profiler` on
+ * are optional (NULL by default).
  */
 typedef struct {
     int num_tubes;
     int num_extra;
     Tube **tubes;
+    const TubeOps *ops;
     unsigned int seed;
     const char *filename;
+    int solution_format;          /* solution format of GameInfo_solve() */
+    Profiler *profiler;           /* times solving, writing, rendering */
+    SearchTrace *trace;           /* records search of GameInfo_solve() */
+    SolverProgress *progress;     /* progress of GameInfo_solve() */
+    SolverCheckpoint *checkpoint; /* checkpoints of GameInfo_solve() */
+    const GameHints *hints;       /* hints for GameInfo_play() */
 } GameInfo;
 
+/**
+ * Hint status enumerator.
+ */
+enum {
+    HINT_MOVE,     /* next move of a solution */
+    HINT_PENDING,  /* board not solved yet */
+    HINT_UNSOLVED, /* no solution from board */
+    HINT_ABORTED,  /* node limit hit on board */
+};
+
+/**
+ * Struct for provider of hints in GameInfo_play() (e.g., a background solver,
+ * see hint.h). `update` is called with the initial board and after every move
+ * of the player, `get` must not block: it writes the next move for the board
+ * (if known) and returns a hint status enumerator.
+ */
+struct GameHints {
+    void (*update)(void *data, const GameInfo *info);
+    int (*get)(void *data, const GameInfo *info, int *p_i_src, int *p_i_dst);
+    void *data;
+};
+
+/**
+ * Solver status enumerator.
+ */
+enum {
+    SOLVER_SOLVED,
+    SOLVER_UNSOLVED,
+    SOLVER_ABORTED,
+};
+
+/**
+ * Struct for limits of solver (non-positive values mean unlimited).
+ */
+typedef struct {
+    long max_nodes;
+} SolverLimits;
+
+/**
+ * Struct for outcome and statistics of a solver run.
+ */
+typedef struct {
+    int status;
+    int num_moves;
+    long num_nodes;
+    long num_pours;
+} SolverResult;
+
 /**
  * Generates GameInfo object with `num_colors` colors, `num_extra` extra
  * tubes and `num_slots` slots per tube from seed `seed`.
@@ -38,15 +102,150 @@ GameInfo_create_from_seed(
   int num_colors, int num_extra, int num_slots, int seed
 );
 
+/**
+ * Generates GameInfo object with `num_colors` colors, `num_extra` extra
+ * tubes and `num_slots` slots per tube by applying up to `num_moves` random
+ * legal reverse moves (see Tube_revert()) to a solved board, starting from seed
+ * `seed`. Thus, the game is solvable by construction. Scrambling stops early if
+ * no reverse move is left (every top chunk is a single slot). The solution (of
+ * at most `num_moves` moves) is appended to `log` (if not NULL).
+ *
+ * @param[in] num_colors number of colors for game
+ * @param[in] num_extra number of extra tubes for game
+ * @param[in] num_slots number of slots for game
+ * @param[in] seed seed for game
+ * @param[in] num_moves number of reverse moves to apply
+ * @param[out] log ActionLog to append solution to
+ *
+ * @return Pointer to newly allocated and initialized GameInfo object
+ */
+GameInfo *
+GameInfo_create_from_scramble(
+  int num_colors, int num_extra, int num_slots, int seed, int num_moves,
+  ActionLog *log
+);
+
 /**
  * Reads GameInfo object from `filename`.
  *
  * @param[in] filename input filename to read data from
+ * @param[out] p_error pointer to InputError to write error to (or NULL)
  *
- * @return Pointer to newly allocated and initialized GameInfo object
+ * @return Pointer to newly allocated and initialized GameInfo object or NULL on
+ * error
  */
 GameInfo *
-GameInfo_create_from_file(const char *filename);
+GameInfo_create_from_file(const char *filename, InputError *p_error);
+
+/**
+ * Reads GameInfo object of game with index `index` of `corpus`.
+ *
+ * @param[in] corpus Corpus to read from
+ * @param[in] index index of game (0-based)
+ * @param[out] p_error pointer to InputError to write error to (or NULL)
+ *
+ * @return Pointer to newly allocated and initialized GameInfo object or NULL on
+ * error
+ */
+GameInfo *
+GameInfo_create_from_corpus(
+  const Corpus *corpus, long index, InputError *p_error
+);
+
+/**
+ * Reads GameInfo object from `len` bytes of `buffer` in the input file format.
+ *
+ * @param[in] buffer buffer to parse (need not be null-terminated)
+ * @param[in] len length of buffer
+ * @param[out] p_error pointer to InputError to write error to (or NULL)
+ *
+ * @return Pointer to newly allocated and initialized GameInfo object or NULL on
+ * error
+ */
+GameInfo *
+GameInfo_create_from_buffer(
+  const char *buffer, size_t len, InputError *p_error
+);
+
+/**
+ * Reads GameInfo object from single line `line` of length `len` in the row
+ * format (see Input_parse_line()).
+ *
+ * @param[in] line line to parse (need not be null-terminated)
+ * @param[in] len length of line
+ *
+ * @return Pointer to newly allocated and initialized GameInfo object or NULL if
+ * `line` is invalid
+ */
+GameInfo *
+GameInfo_create_from_line(const char *line, size_t len);
+
+/**
+ * Creates copy of board of `info` (hooks are not copied).
+ *
+ * @param[in] info GameInfo object to copy
+ *
+ * @return Pointer to newly allocated GameInfo object
+ */
+GameInfo *
+GameInfo_copy(const GameInfo *info);
+
+/**
+ * Overwrites board of `dst` by board of `src` (of the same dimensions).
+ *
+ * @param[out] dst GameInfo object to write to
+ * @param[in] src GameInfo object to copy board from
+ */
+void
+GameInfo_assign(GameInfo *dst, const GameInfo *src);
+
+/**
+ * Hides the lowest `num_hidden` slots of every tube of `info` (except those in
+ * the topmost chunk, see Tube_reveal()).
+ *
+ * @param[in,out] info GameInfo object to hide slots of
+ * @param[in] num_hidden number of slots to hide per tube
+ */
+void
+GameInfo_hide(GameInfo *info, int num_hidden);
+
+/**
+ * Returns number of hidden slots of `info`.
+ *
+ * @param[in] info GameInfo object to check
+ *
+ * @return Number of hidden slots
+ */
+int
+GameInfo_count_hidden(const GameInfo *info);
+
+/**
+ * Writes a determinization of `info` to `sample` (of the same dimensions): the
+ * visible slots are copied and the hidden slots are filled with a random
+ * assignment of the colors not visible (every color fills one tube), drawn from
+ * `rng` such that no hidden slot would belong to a topmost chunk. `sample` has
+ * no hidden slots.
+ *
+ * @param[in] info GameInfo object to sample (only visible slots are read)
+ * @param[out] sample GameInfo object to write determinization to
+ * @param[in,out] rng Rng to draw from
+ *
+ * @return Error code (failure if the visible colors do not fit a full game or
+ *         no consistent assignment was drawn within a few tries)
+ */
+int
+GameInfo_determinize(const GameInfo *info, GameInfo *sample, Rng *rng);
+
+/**
+ * Returns hash of board of `info`. Unlike the hash of the solver, it depends on
+ * the order of the tubes and on which slots are hidden.
+ *
+ * @param[in] info GameInfo object to hash
+ *
+ * @return Hash of board
+ */
+uint64_t
+GameInfo_hash(const GameInfo *info);
 
 /**
  * Destroys `info` and frees memory.
@@ -55,21 +254,115 @@ void
 GameInfo_destroy(GameInfo *info);
 
 /**
- * Runs main game loop on `info`.
+ * Prints `info` to FILE stream `out` in the input file format (one tube per
+ * line, empty slots as -1), so that it can be read again.
+ *
+ * @param[in] out output FILE stream
+ * @param[in] info GameInfo object to be printed
+ */
+void
+GameInfo_fprint_raw(FILE *out, const GameInfo *info);
+
+/**
+ * Returns if `info` is solved (all tubes are uniformly filled).
+ *
+ * @param[in] info GameInfo object to be checked
+ *
+ * @return Is `info` solved?
+ */
+bool
+GameInfo_is_solved(const GameInfo *info);
+
+/**
+ * Runs main game loop on `info`. The command 'h' prints the next move from
+ * `info->hints` (if set). Hidden slots are revealed once they get on top.
  *
  * @param[in] info GameInfo object to perform action on
  */
 void
 GameInfo_play(GameInfo *info);
 
+/**
+ * Reverts all actions of `info` according to `log`. Thus, also empties `log`.
+ *
+ * @param[in] info GameInfo object to perform action on
+ * @param[in,out] log ActionLog to use to revert all actions
+ */
+void
+GameInfo_revert_all(GameInfo *info, ActionLog *log);
+
+/**
+ * Searches for a solution of `info` within `limits` and writes the first found
+ * solution to `log` (if not NULL). Afterwards, `info` is in its solved state if
+ * a solution was found and in its initial state otherwise (an already solved
+ * board is solved with 0 moves). The outcome is written to `result` (if not
+ * NULL). All search state lives in `ctx`, which is reset first and may be
+ * reused for the next search; pass NULL to use a temporary one.
+ *
+ * @param[in] info GameInfo object to check for solution
+ * @param[in,out] ctx SolverContext to work with (or NULL)
+ * @param[out] log ActionLog to write solution to (if found)
+ * @param[in] limits SolverLimits to obey (NULL for unlimited)
+ * @param[out] result SolverResult to write outcome to
+ *
+ * @return Solver status enumerator
+ */
+int
+GameInfo_find_solution(
+  GameInfo *info, SolverContext *ctx, ActionLog *log,
+  const SolverLimits *limits, SolverResult *result
+);
+
+/**
+ * Looks up initial board of `info` in `cache`, which also finds boards that
+ * only differ by names of colors or order of tubes (the moves are mapped back
+ * to the tubes of `info`). A cached solution is only accepted if it actually
+ * solves `info`, which is left in its initial state.
+ *
+ * @param[in] info GameInfo object to look up (in its initial state)
+ * @param[in,out] cache SolutionCache to look up
+ * @param[out] log ActionLog to write solution to
+ * @param[out] result SolverResult to write cached outcome to
+ *
+ * @return Found valid entry?
+ */
+bool
+GameInfo_lookup_solution(
+  GameInfo *info, SolutionCache *cache, ActionLog *log, SolverResult *result
+);
+
+/**
+ * Appends outcome `result` of search on initial board of `info` (and the
+ * solution `log`) to `cache`. Only final outcomes (solved or unsolved) are
+ * stored, as aborted ones would never be accepted by a lookup.
+ *
+ * @param[in] info GameInfo object that was solved (in its initial state)
+ * @param[in,out] cache SolutionCache to append to
+ * @param[in] log ActionLog with solution (or NULL)
+ * @param[in] result SolverResult of search
+ *
+ * @return Error code
+ */
+int
+GameInfo_store_solution(
+  const GameInfo *info, SolutionCache *cache, const ActionLog *log,
+  const SolverResult *result
+);
+
 /**
  * Tries to solve game in `info`. If successful, writes solution to file with a
  * standardize name (either "${info->seed}.solution" or
- * "${info->filename}.solution").
+ * "${info->filename}.solution") in `info->solution_format`: text with the
+ * board first or binary (moves only). If `cache` is not NULL, it is looked up
+ * first (keyed by the canonical initial board) and filled on a miss. If
+ * `stats` is not NULL, statistics of the search are written to it (all zero on
+ * a cache hit).
  *
  * @param[in] info GameInfo object to perform action on
+ * @param[in,out] cache SolutionCache to use (or NULL)
+ * @param[out] stats SolverStats to write statistics to (or NULL)
  */
 void
-GameInfo_solve(GameInfo *info);
+GameInfo_solve(GameInfo *info, SolutionCache *cache, SolverStats *stats);
 
 #endif /* GAMEINFO_H_INCLUDED */
@@ -0,0 +1,318 @@
+#include "hint.h"
+
+#include <stdlib.h>
+
+#include "log.h"
+#include "tube.h"
+#include "util.h"
+
+/**
+ * Looks up board with hash `hash` in hint table of `engine` (which must be
+ * locked).
+ *
+ * @param[in] engine HintEngine to look up
+ * @param[in] hash hash of board
+ *
+ * @return Pointer to entry of board or NULL if not found
+ */
+static const HintEntry *
+HintEngine_lookup(const HintEngine *engine, uint64_t hash)
+{
+    const HintEntry *const entry
+      = &engine->entries[hash & (HINT_TABLE_SIZE - 1)];
+    return (entry->hash == hash) ? entry : NULL;
+}
+
+/**
+ * Stores hint for board with hash `hash` in hint table of `engine`. It replaces
+ * any other board in its entry, unless it is speculative and the other board
+ * is not (so speculation never evicts hints for the line of the player).
+ *
+ * @param[in,out] engine HintEngine to store hint in
+ * @param[in] hash hash of board
+ * @param[in] status hint status enumerator
+ * @param[in] i_src index of source tube of next move
+ * @param[in] i_dst index of destination tube of next move
+ * @param[in] is_speculative is hint from speculative search?
+ */
+static void
+HintEngine_store(
+  HintEngine *engine, uint64_t hash, int status, int i_src, int i_dst,
+  bool is_speculative
+)
+{
+    pthread_mutex_lock(&engine->mutex);
+    HintEntry *const entry = &engine->entries[hash & (HINT_TABLE_SIZE - 1)];
+    if (is_speculative == true && entry->is_speculative == false
+        && entry->hash != 0 && entry->hash != hash) {
+        pthread_mutex_unlock(&engine->mutex);
+        return;
+    }
+    entry->hash = hash;
+    entry->is_speculative = is_speculative;
+    entry->status = status;
+    entry->i_src = i_src;
+    entry->i_dst = i_dst;
+    pthread_mutex_unlock(&engine->mutex);
+}
+
+/**
+ * Solves private board of `engine` (unless already known) within `limits` and
+ * stores a hint for every board on the found solution. Afterwards, the board is
+ * unchanged. A speculative search that hits its node limit is not stored, so
+ * the board is solved again with the full limit once the player reaches it.
+ *
+ * @param[in,out] engine HintEngine to solve with
+ * @param[in] limits SolverLimits to obey
+ * @param[in] is_speculative is board only a guess of the next board?
+ */
+static void
+HintEngine_solve(
+  HintEngine *engine, const SolverLimits *limits, bool is_speculative
+)
+{
+    GameInfo *const work = engine->work;
+    const uint64_t hash = GameInfo_hash(work);
+    pthread_mutex_lock(&engine->mutex);
+    const bool is_known = HintEngine_lookup(engine, hash) != NULL;
+    pthread_mutex_unlock(&engine->mutex);
+    if (is_known == true) {
+        return;
+    }
+
+    ActionLog *log = ActionLog_create();
+    SolverResult result;
+    GameInfo_find_solution(work, engine->ctx, log, limits, &result);
+    if (result.status == SOLVER_UNSOLVED
+        || (result.status == SOLVER_ABORTED && is_speculative == false)) {
+        HintEngine_store(
+          engine, hash,
+          (result.status == SOLVER_UNSOLVED) ? HINT_UNSOLVED : HINT_ABORTED, 0,
+          0, is_speculative
+        );
+    }
+    Action action;
+    while (ActionLog_pop(log, &action) == TUBE_SUCCESS) {
+        work->ops->revert(
+          work->tubes[action.i_src], work->tubes[action.i_dst], &action.chunk
+        );
+        HintEngine_store(
+          engine, GameInfo_hash(work), HINT_MOVE, action.i_src, action.i_dst,
+          is_speculative
+        );
+    }
+    ActionLog_destroy(log);
+}
+
+/**
+ * Returns if board of player changed since generation `generation` (or
+ * `engine` was stopped).
+ *
+ * @param[in,out] engine HintEngine to check
+ * @param[in] generation generation of board being worked on
+ *
+ * @return Is work of `generation` stale?
+ */
+static bool
+HintEngine_is_stale(HintEngine *engine, long generation)
+{
+    pthread_mutex_lock(&engine->mutex);
+    const bool is_stale
+      = engine->generation != generation || engine->is_stopped == true;
+    pthread_mutex_unlock(&engine->mutex);
+    return is_stale;
+}
+
+/**
+ * Picks most robust move for private board of `engine` (with hidden slots) by
+ * the determinization solver and stores it as hint.
+ *
+ * @param[in,out] engine HintEngine to work with
+ */
+static void
+HintEngine_sample(HintEngine *engine)
+{
+    const uint64_t hash = GameInfo_hash(engine->work);
+    pthread_mutex_lock(&engine->mutex);
+    const bool is_known = HintEngine_lookup(engine, hash) != NULL;
+    pthread_mutex_unlock(&engine->mutex);
+    if (is_known == true) {
+        return;
+    }
+
+    SamplerResult result;
+    if (Sampler_best_move(engine->work, &engine->sampler, &result)
+        != TUBE_SUCCESS) {
+        result.status = HINT_ABORTED;
+    }
+    HintEngine_store(
+      engine, hash, result.status, result.i_src, result.i_dst, false
+    );
+}
+
+/**
+ * Solves private board of `engine` of generation `generation`, then the boards
+ * after every legal move from it with a smaller node limit (until the player
+ * moves on, which is only checked between two searches). Boards with hidden
+ * slots are only sampled.
+ *
+ * @param[in,out] engine HintEngine to work with
+ * @param[in] generation generation of board
+ */
+static void
+HintEngine_think(HintEngine *engine, long generation)
+{
+    GameInfo *const work = engine->work;
+    if (GameInfo_count_hidden(work) > 0) {
+        HintEngine_sample(engine);
+        return;
+    }
+    HintEngine_solve(engine, &engine->limits, false);
+    SolverLimits limits = {.max_nodes = HINT_SPECULATIVE_NODES};
+    if (engine->limits.max_nodes > 0
+        && engine->limits.max_nodes < limits.max_nodes) {
+        limits = engine->limits;
+    }
+    for (int i_src = 0; i_src < work->num_tubes; ++i_src) {
+        for (int i_dst = 0; i_dst < work->num_tubes; ++i_dst) {
+            if (i_src == i_dst) {
+                continue;
+            }
+            if (HintEngine_is_stale(engine, generation) == true) {
+                return;
+            }
+            Tube *const tube_src = work->tubes[i_src];
+            Tube *const tube_dst = work->tubes[i_dst];
+            ColorChunk chunk;
+            if (work->ops->pour(tube_src, tube_dst, &chunk) != TUBE_SUCCESS) {
+                continue;
+            }
+            HintEngine_solve(engine, &limits, true);
+            work->ops->revert(tube_src, tube_dst, &chunk);
+        }
+    }
+}
+
+/**
+ * Thread function: works on every new board of the player until stopped.
+ *
+ * @param[in] arg pointer to HintEngine
+ *
+ * @return NULL
+ */
+static void *
+_thinker(void *arg)
+{
+    HintEngine *const engine = arg;
+
+    pthread_mutex_lock(&engine->mutex);
+    while (engine->is_stopped == false) {
+        if (engine->done == engine->generation) {
+            pthread_cond_wait(&engine->changed, &engine->mutex);
+            continue;
+        }
+        const long generation = engine->generation;
+        GameInfo_assign(engine->work, engine->board);
+        pthread_mutex_unlock(&engine->mutex);
+        HintEngine_think(engine, generation);
+        pthread_mutex_lock(&engine->mutex);
+        engine->done = generation;
+    }
+    pthread_mutex_unlock(&engine->mutex);
+
+    return NULL;
+}
+
+/**
+ * Hook of GameHints: hands current board `info` to engine `data`.
+ *
+ * @param[in,out] data pointer to HintEngine
+ * @param[in] info GameInfo object with current board
+ */
+static void
+_update(void *data, const GameInfo *info)
+{
+    HintEngine *const engine = data;
+    pthread_mutex_lock(&engine->mutex);
+    GameInfo_assign(engine->board, info);
+    ++engine->generation;
+    pthread_cond_signal(&engine->changed);
+    pthread_mutex_unlock(&engine->mutex);
+}
+
+/**
+ * Hook of GameHints: looks up next move for current board `info` in engine
+ * `data`.
+ *
+ * @param[in,out] data pointer to HintEngine
+ * @param[in] info GameInfo object with current board
+ * @param[out] p_i_src pointer to index of source tube
+ * @param[out] p_i_dst pointer to index of destination tube
+ *
+ * @return Hint status enumerator
+ */
+static int
+_get(void *data, const GameInfo *info, int *p_i_src, int *p_i_dst)
+{
+    HintEngine *const engine = data;
+    const uint64_t hash = GameInfo_hash(info);
+    pthread_mutex_lock(&engine->mutex);
+    const HintEntry *const entry = HintEngine_lookup(engine, hash);
+    const HintEntry hint
+      = (entry != NULL) ? *entry : (HintEntry){.status = HINT_PENDING};
+    pthread_mutex_unlock(&engine->mutex);
+    *p_i_src = hint.i_src;
+    *p_i_dst = hint.i_dst;
+    return hint.status;
+}
+
+HintEngine *
+HintEngine_start(GameInfo *info, const SamplerOptions *opts)
+{
+    HintEngine *engine = malloc(sizeof *engine);
+
+    engine->board = GameInfo_copy(info);
+    engine->work = GameInfo_copy(info);
+    engine->ctx = SolverContext_create();
+    engine->dead = DeadTable_create();
+    engine->ctx->dead = engine->dead;
+    engine->limits = (SolverLimits){.max_nodes = opts->max_nodes};
+    engine->sampler = *opts;
+    engine->entries = calloc(HINT_TABLE_SIZE, sizeof *engine->entries);
+    engine->generation = 0;
+    engine->done = 0;
+    engine->is_stopped = false;
+    engine->hints = (GameHints){.update = _update, .get = _get, .data = engine};
+    pthread_mutex_init(&engine->mutex, NULL);
+    pthread_cond_init(&engine->changed, NULL);
+    if (pthread_create(&engine->thread, NULL, _thinker, engine) != 0) {
+        ERROR("Could not create hint thread!");
+    }
+
+    info->hints = &engine->hints;
+    return engine;
+}
+
+void
+HintEngine_stop(HintEngine *engine)
+{
+    if (engine == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&engine->mutex);
+    engine->is_stopped = true;
+    pthread_cond_signal(&engine->changed);
+    pthread_mutex_unlock(&engine->mutex);
+    pthread_join(engine->thread, NULL);
+
+    pthread_cond_destroy(&engine->changed);
+    pthread_mutex_destroy(&engine->mutex);
+    GameInfo_destroy(engine->board);
+    GameInfo_destroy(engine->work);
+    SolverContext_destroy(engine->ctx);
+    DeadTable_destroy(engine->dead);
+    free(engine->entries);
+
+    free(engine);
+}
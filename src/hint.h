@@ -0,0 +1,90 @@
+/** hint.h
+ *
+ * Header for the background hint engine of 'tubes'. While the player thinks,
+ * a HintEngine solves the current board in a separate thread (with one
+ * SolverContext that stays allocated across solves) and remembers the next
+ * move for every board on the found solution, so following a hint needs no new
+ * search. Afterwards, it speculatively solves the boards after every legal
+ * move of the player (with a small node limit). Boards with hidden slots are
+ * not solved directly (that would reveal them) but by the determinization
+ * solver (see sampler.h). Hints are looked up by board hash and never wait for
+ * the solver (see GameHints in gameinfo.h). Boards proven unsolvable are
+ * remembered across solves (see DeadTable in solver.h), so once the player is
+ * stuck, later boards are mostly refuted without search.
+ */
+
+#ifndef HINT_H_INCLUDED
+#define HINT_H_INCLUDED
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "gameinfo.h"
+#include "sampler.h"
+#include "solver.h"
+
+/**
+ * Number of entries of hint table (power of 2).
+ */
+#define HINT_TABLE_SIZE 16384
+
+/**
+ * Node limit of speculative searches (keeps engine responsive to moves).
+ */
+#define HINT_SPECULATIVE_NODES 20000
+
+/**
+ * Auxiliary struct for entry of hint table.
+ */
+typedef struct {
+    uint64_t hash;       /* hash of board (0 for empty entry) */
+    int status;          /* hint status enumerator */
+    int i_src;
+    int i_dst;
+    bool is_speculative; /* from search on guessed board? */
+} HintEntry;
+
+/**
+ * Struct for hint engine (all fields but `work`, `ctx` and `dead` are guarded
+ * by `mutex`).
+ */
+typedef struct {
+    GameInfo *board;    /* latest board of player */
+    GameInfo *work;     /* private copy of board solved by thread */
+    SolverContext *ctx; /* reused for every solve */
+    DeadTable *dead;    /* boards proven unsolvable (used by `ctx`) */
+    SolverLimits limits;
+    SamplerOptions sampler; /* for boards with hidden slots */
+    HintEntry *entries; /* direct-mapped by hash of board */
+    long generation;    /* number of updates of `board` */
+    long done;          /* generation handled by thread */
+    bool is_stopped;
+    GameHints hints; /* hooks for GameInfo_play() */
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+} HintEngine;
+
+/**
+ * Starts thread solving boards of game `info` (with node limit
+ * `opts->max_nodes` per solve, boards with hidden slots with `opts`) and sets
+ * `info->hints` to the hooks of the engine.
+ *
+ * @param[in,out] info GameInfo object to provide hints for
+ * @param[in] opts SamplerOptions to use
+ *
+ * @return Pointer to newly allocated HintEngine object
+ */
+HintEngine *
+HintEngine_start(GameInfo *info, const SamplerOptions *opts);
+
+/**
+ * Stops thread of `engine` (after the current solve) and frees memory.
+ *
+ * @param[in] engine HintEngine to stop (or NULL)
+ */
+void
+HintEngine_stop(HintEngine *engine);
+
+#endif /* HINT_H_INCLUDED */
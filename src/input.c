@@ -1,14 +1,22 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "input.h"
 
 #include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "alloc.h"
 #include "util.h"
 
-#define BUFFER_SIZE 128
+#define READ_BLOCK_SIZE (1 << 16)
 #define DEFAULT_INITIAL_CAPACITY 4
 
 /**
@@ -31,7 +39,7 @@ typedef struct {
 static IntVec *
 IntVec_alloc(int initial_capacity)
 {
-    IntVec *vec = malloc(sizeof *vec);
+    IntVec *vec = Alloc_malloc(ALLOC_INPUT, sizeof *vec);
 
     if (initial_capacity <= 0) {
         initial_capacity = DEFAULT_INITIAL_CAPACITY;
@@ -39,7 +47,7 @@ IntVec_alloc(int initial_capacity)
 
     vec->size = 0;
     vec->capacity = initial_capacity;
-    vec->data = malloc(vec->capacity * sizeof *vec->data);
+    vec->data = Alloc_malloc(ALLOC_INPUT, vec->capacity * sizeof *vec->data);
 
     return vec;
 }
@@ -56,9 +64,9 @@ IntVec_free(IntVec *vec)
         return;
     }
 
-    free(vec->data);
+    Alloc_free(vec->data);
 
-    free(vec);
+    Alloc_free(vec);
 }
 
 /**
@@ -72,353 +80,354 @@ IntVec_push_back(IntVec *vec, int val)
 {
     if (vec->size == vec->capacity) {
         vec->capacity *= 2;
-        vec->data = realloc(vec->data, vec->capacity * sizeof *vec->data);
+        vec->data = Alloc_realloc(
+          ALLOC_INPUT, vec->data, vec->capacity * sizeof *vec->data
+        );
     }
     vec->data[vec->size] = val;
     ++vec->size;
 }
 
 /**
- * Shrinks memory of `vec` to actual number of elements.
+ * Parses (possibly negative) decimal integer starting at `p` (but not beyond
+ * `end`) and writes it to `p_value`. Negative values are mapped to
+ * EMPTY_COLOR_INDEX.
+ *
+ * @param[in] p start of number (digit or '-')
+ * @param[in] end end of buffer
+ * @param[out] p_value pointer to write value to
  *
- * @param[in] vec vector to shrink
+ * @return Pointer to first character after number or NULL if invalid
  */
-static void
-IntVec_shrink_to_fit(IntVec *vec)
+static const char *
+_parse_color(const char *p, const char *end, int *p_value)
 {
-    if (vec->size == vec->capacity) {
-        return;
+    bool is_negative = false;
+    if (*p == '-') {
+        is_negative = true;
+        ++p;
+    }
+    if (p == end || isdigit((unsigned char) *p) == 0) {
+        return NULL;
+    }
+    int value = 0;
+    for (; p < end && isdigit((unsigned char) *p); ++p) {
+        const int digit = *p - '0';
+        if (value > (INT_MAX - digit) / 10) {
+            return NULL;
+        }
+        value = 10 * value + digit;
     }
-    vec->capacity = vec->size;
-    vec->data = realloc(vec->data, vec->size * sizeof *vec->data);
+    *p_value = is_negative ? EMPTY_COLOR_INDEX : value;
+    return p;
 }
 
-/**
- * Counts lines (separated by '\n') in file `in`. Rewinds `in`.
- *
- * @param[in] in FILE stream to count lines of
- *
- * @return Number of lines in `in`
- */
-static int
-_count_lines(FILE *in)
+int
+Input_sanity_check(Input *input)
 {
-    rewind(in);
-    char c;
-    int ctr = 1;
-    while ((c = fgetc(in)) != EOF) {
-        if (c == '\n') {
-            ++ctr;
+    const int num_tot = input->num_slots * input->num_tubes;
+    int *counts = Alloc_calloc(ALLOC_INPUT, num_tot, sizeof *counts);
+
+    int num_empty = 0;
+    int num_colors = 0;
+    int status = TUBE_SUCCESS;
+    for (int i = 0; i < num_tot && status == TUBE_SUCCESS; ++i) {
+        const int color = input->data[i];
+        if (color == EMPTY_COLOR_INDEX) {
+            ++num_empty;
+        } else if (color >= num_tot || counts[color] == input->num_slots) {
+            status = TUBE_FAILURE;
+        } else if (counts[color]++ == 0) {
+            ++num_colors;
         }
-    };
-    rewind(in);
-    return ctr;
+    }
+    Alloc_free(counts);
+
+    if (status == TUBE_FAILURE || num_empty == 0 || num_empty == num_tot
+        || num_empty % input->num_slots != 0
+        || num_colors != input->num_tubes - num_empty / input->num_slots) {
+        return TUBE_FAILURE;
+    }
+    input->num_colors = num_colors;
+    return TUBE_SUCCESS;
 }
 
 /**
- * Buffered input function to read data from `in`. Buffer never exceeds certain
- * size.
+ * Creates Input object from `len` bytes of `buffer` in a single pass. Every
+ * non-empty line is a tube, colors go straight to their place in the layout of
+ * Input::data.
  *
- * There's probably already an implementation for this which does things better,
- * faster and smarter than I ever could, but I don't care! I do my own
- * unoptimized stuff! Don't judge me!
+ * @param[in] buffer buffer to parse (need not be null-terminated)
+ * @param[in] len length of buffer
+ * @param[out] p_error pointer to InputError to write error to
  *
- * @todo Maybe rewrite/optimize this function. Somehow, I don't like it in this
- * state.
- *
- * @param[in] in input FILE stream to read data from
- * @param[in,out] p_num_elems pointer to number of elements of returned array
- * (output), also used as initial guess for capacity of output vector
- *
- * @return Newly allocated array with elements of line
+ * @return newly malloc'd and initialized Input object or NULL on error
  */
-static int *
-_read_elems(FILE *in, int *p_num_elems)
+static Input *
+Input_parse_text(const char *buffer, size_t len, InputError *p_error)
 {
-    static char buffer[BUFFER_SIZE + 1] = {0};
-
-    IntVec *vec = IntVec_alloc(*p_num_elems);
-
-    bool is_done = false;
-    bool is_error = false;
-    bool is_empty = true;
+    /* Every color takes at least two characters (except the last one) */
+    IntVec *vec = IntVec_alloc((int) (len / 2 + 1));
+    int num_tubes = 0;
+    int num_slots = -1;
+    int num_elems = 0; /* of current line */
+    int line = 1;
+
+    const char *p = buffer;
+    const char *const end = buffer + len;
     for (;;) {
-        fpos_t pos;
-        fgetpos(in, &pos);
-
-        /* Preprocess input in buffer */
-        int idx;
-        is_error = false;
-        for (idx = 0; idx < BUFFER_SIZE; ++idx) {
-            const char c = fgetc(in);
-            if (isdigit(c) || c == '-') {
-                buffer[idx] = c;
-            } else if (c == '\n' || c == EOF) {
-                buffer[idx] = '\0';
-                is_done = true;
-                break;
-            } else if (isalpha(c)) {
-                is_error = true;
+        const char c = (p < end) ? *p : '\n';
+        if (isdigit((unsigned char) c) || c == '-') {
+            int color;
+            p = _parse_color(p, end, &color);
+            if (p == NULL) {
+                p_error->code = INPUT_ERROR_SYNTAX;
                 break;
-            } else if (c == '#') {
-                buffer[idx] = '#';
-            } else {
-                buffer[idx] = ' ';
-            }
-            if (is_empty == true) {
-                if (c == '#') { /* Comment */
-                    break;
-                }
-                if (c != ' ' && c != '\n' && c != '\0' && c != EOF) {
-                    is_empty = false;
-                }
             }
+            IntVec_push_back(vec, color);
+            ++num_elems;
+            continue;
         }
-        if (is_empty == true || is_error == true) {
-            break;
+        if (c == '#') { /* Comment: skip rest of line */
+            const char *eol = memchr(p, '\n', end - p);
+            p = (eol == NULL) ? end : eol;
+            continue;
         }
-
-        /* Read elements */
-        char *endp = buffer;
-        const char *nptr = endp;
-        do {
-            nptr = endp;
-            const int elem = (int) strtol(nptr, &endp, 10);
-            if (endp != nptr) {
-                IntVec_push_back(vec, elem);
-            }
-        } while (endp != nptr && endp != NULL);
-
-        if (is_done == true) {
+        if (isalpha((unsigned char) c)) {
+            p_error->code = INPUT_ERROR_SYNTAX;
             break;
         }
-
-        /* Move to last whitespace so that all numbers are complete */
-        long last = idx;
-        for (; buffer[last] != ' ' && last > 0; --last)
-            ;
-        ++last;
-
-        /* Is buffer empty? */
-        if (last == 0) {
-            continue;
+        if (c == '\n') {
+            if (num_elems > 0) {
+                if (num_slots == -1) {
+                    num_slots = num_elems;
+                }
+                if (num_elems != num_slots) {
+                    p_error->code = INPUT_ERROR_NUM_SLOTS;
+                    p_error->expected = num_slots;
+                    p_error->got = num_elems;
+                    break;
+                }
+                ++num_tubes;
+            }
+            if (p >= end) {
+                break;
+            }
+            num_elems = 0;
+            ++line;
         }
-
-        /* Restart buffer at last whitespace */
-        fsetpos(in, &pos);
-        fseek(in, last, SEEK_CUR);
+        ++p;
     }
-    if (is_empty == true) {
-        IntVec_free(vec);
-        *p_num_elems = 0;
-        return NULL;
+    if (p_error->code == INPUT_OK && num_tubes == 0) {
+        p_error->code = INPUT_ERROR_SANITY;
     }
-    if (is_error == true) {
+    if (p_error->code != INPUT_OK) {
+        if (p_error->code != INPUT_ERROR_SANITY) {
+            p_error->line = line;
+        }
         IntVec_free(vec);
-        *p_num_elems = -1;
         return NULL;
     }
 
-    IntVec_shrink_to_fit(vec);
-    int *res = vec->data;
-    *p_num_elems = vec->size;
+    Input *input = Alloc_malloc(ALLOC_INPUT, sizeof *input);
+
+    input->num_tubes = num_tubes;
+    input->num_slots = num_slots;
+    input->num_colors = 0;
+    input->data = vec->data;
     vec->data = NULL;
     IntVec_free(vec);
 
-    return res;
-}
-
-/**
- * Auxiliary struct for raw (line by line) input data.
- */
-typedef struct {
-    int num_lines;
-    int num_elems;
-    int **data;
-} RawInput;
-
-/**
- * Creates RawInput object from data in `filename`.
- *
- * @param[in] filename input filename
- *
- * @return Pointer to newly allocated and initialized RawInput object
- */
-static RawInput *
-RawInput_read(const char *filename)
-{
-    FILE *in = fopen(filename, "r");
-    if (in == NULL) {
+    if (Input_sanity_check(input) == TUBE_FAILURE) {
+        p_error->code = INPUT_ERROR_SANITY;
+        Input_destroy(input);
         return NULL;
     }
 
-    RawInput *raw = malloc(sizeof *raw);
-
-    raw->num_lines = _count_lines(in);
-    raw->data = malloc(raw->num_lines * sizeof *raw->data);
-    raw->num_elems = -1;
-    int i_line;
-    for (i_line = 0; i_line < raw->num_lines; ++i_line) {
-        int num_elems = raw->num_elems;
-        raw->data[i_line] = _read_elems(in, &num_elems);
-        if (num_elems == -1) {
-            ERROR("Error reading file '%s' at line %i!", filename, i_line + 1);
-        }
-        if (raw->data[i_line] != NULL && raw->num_elems == -1) {
-            raw->num_elems = num_elems;
-        }
-        if (raw->data[i_line] != NULL && raw->num_elems != num_elems) {
-            fprintf(
-              stderr, "Invalid number of arguments in file '%s' at line %i!\n",
-              filename, i_line + 1
-            );
-            ERROR("Expected %i got %i!", raw->num_elems, num_elems);
-        }
-    }
-
-    fclose(in);
-
-    return raw;
+    return input;
 }
 
 /**
- * Destroys `raw` and frees memory.
+ * Resets `p_error` (or points it to `aux` if NULL).
+ *
+ * @param[in] p_error pointer to InputError passed by caller
+ * @param[in] aux auxiliary InputError
  *
- * @param[in] raw RawInput to be destroyed
+ * @return Pointer to InputError to use
  */
-static void
-RawInput_free(RawInput *raw)
+static InputError *
+_reset_error(InputError *p_error, InputError *aux)
 {
-    if (raw == NULL) {
-        return;
+    if (p_error == NULL) {
+        p_error = aux;
     }
-
-    for (int i = 0; i < raw->num_lines; ++i) {
-        free(raw->data[i]);
-    }
-    free(raw->data);
-
-    free(raw);
+    p_error->code = INPUT_OK;
+    p_error->line = 0;
+    p_error->expected = 0;
+    p_error->got = 0;
+    return p_error;
 }
 
 /**
- * Counts filled (non-NULL) lines in `raw`.
+ * Reads all of `fd` into a newly malloc'd buffer in large blocks (fallback for
+ * inputs that cannot be mapped, e.g., pipes).
  *
- * @param[in] raw RawInput to count lines of
+ * @param[in] fd file descriptor to read from
+ * @param[out] p_len pointer to write length of buffer to
  *
- * @return Number of filled lines in `raw`
+ * @return Newly malloc'd buffer or NULL on error
  */
-static int
-RawInput_count_lines(const RawInput *raw)
+static char *
+_read_all(int fd, size_t *p_len)
 {
-    int ctr = 0;
-    for (int i = 0; i < raw->num_lines; ++i) {
-        if (raw->data[i] == NULL) {
-            continue;
+    size_t capacity = READ_BLOCK_SIZE;
+    size_t len = 0;
+    char *buffer = Alloc_malloc(ALLOC_INPUT, capacity);
+    for (;;) {
+        if (len == capacity) {
+            capacity *= 2;
+            buffer = Alloc_realloc(ALLOC_INPUT, buffer, capacity);
+        }
+        const ssize_t num_read = read(fd, buffer + len, capacity - len);
+        if (num_read < 0) {
+            Alloc_free(buffer);
+            return NULL;
+        }
+        if (num_read == 0) {
+            break;
         }
-        ++ctr;
+        len += (size_t) num_read;
     }
-    return ctr;
+    *p_len = len;
+    return buffer;
 }
 
-/**
- * Comparison function for integers in the style of the C standard library.
- * Returns <0 if integer pointed to by `lhs` is less than that pointed to by
- * `rhs, >0 if greater than, 0 if equal.
- *
- * @param[in] lhs pointer to value of left hand side
- * @param[in] rhs pointer to value of right hand side
- *
- * @return <0 if `lhs` is less than `rhs, >0 if greater than, 0 if equal
- */
-static int
-_cmp_fnc_int(const void *lhs, const void *rhs)
+Input *
+Input_read(const char *filename, InputError *p_error)
 {
-    const int a = *(const int *) lhs;
-    const int b = *(const int *) rhs;
-    return (a > b) - (a < b);
-}
+    InputError aux;
+    p_error = _reset_error(p_error, &aux);
 
-/**
- * Checks if data in `input` is a valid game. If so, sets number of colors in
- * `input`.
- *
- * @param[in] input Input to check sanity of
- *
- * @return Error code
- */
-int
-Input_sanity_check(Input *input)
-{
-    const int num_tot = input->num_slots * input->num_tubes;
-    int *cpy = malloc(num_tot * sizeof *cpy);
-    cpy = memcpy(cpy, input->data, num_tot * sizeof *input->data);
-    qsort(cpy, num_tot, sizeof *cpy, &_cmp_fnc_int);
-
-    /* First, count empty slots, i.e., extra tubes */
-    int idx = 0;
-    for (; cpy[idx] == EMPTY_COLOR_INDEX; ++idx)
-        ;
-    if (idx == 0 || idx % input->num_slots != 0) {
-        free(cpy);
-        return TUBE_FAILURE;
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        p_error->code = INPUT_ERROR_OPEN;
+        return NULL;
     }
-    const int num_extra = idx / input->num_slots;
-    input->num_colors = input->num_tubes - num_extra;
-
-    /* Then, count colors */
-    int ctr = 1;
-    for (; idx < num_tot - 1; ++idx) {
-        if (cpy[idx] == cpy[idx + 1]) {
-            ++ctr;
-            continue;
-        }
-        if (ctr != input->num_slots) {
-            free(cpy);
-            return TUBE_FAILURE;
+
+    Input *input = NULL;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        const size_t len = (size_t) st.st_size;
+        void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            input = Input_parse_text(map, len, p_error);
+            munmap(map, len);
+            close(fd);
+            return input;
         }
-        ctr = 1;
     }
 
-    free(cpy);
-    return TUBE_SUCCESS;
+    size_t len = 0;
+    char *buffer = _read_all(fd, &len);
+    close(fd);
+    if (buffer == NULL) {
+        p_error->code = INPUT_ERROR_OPEN;
+        return NULL;
+    }
+    input = Input_parse_text(buffer, len, p_error);
+    Alloc_free(buffer);
+
+    return input;
 }
 
 Input *
-Input_read(const char *filename)
+Input_parse(const char *buffer, size_t len, InputError *p_error)
 {
-    RawInput *raw = RawInput_read(filename);
-    if (raw == NULL) {
-        return NULL;
-    }
-
-    Input *input = malloc(sizeof *input);
+    InputError aux;
+    p_error = _reset_error(p_error, &aux);
 
-    input->num_slots = raw->num_elems;
-    input->num_tubes = RawInput_count_lines(raw);
+    return Input_parse_text(buffer, len, p_error);
+}
 
-    const int num_tot = input->num_slots * input->num_tubes;
-    input->data = malloc(num_tot * sizeof *input->data);
+void
+InputError_fprint(FILE *out, const InputError *error, const char *name)
+{
+    switch (error->code) {
+    case INPUT_OK:
+        break;
+    case INPUT_ERROR_OPEN:
+        fprintf(out, "Could not open input '%s'!\n", name);
+        break;
+    case INPUT_ERROR_SYNTAX:
+        fprintf(
+          out, "Error reading input '%s' at line %i!\n", name, error->line
+        );
+        break;
+    case INPUT_ERROR_NUM_SLOTS:
+        fprintf(
+          out, "Invalid number of arguments in input '%s' at line %i!\n", name,
+          error->line
+        );
+        fprintf(out, "Expected %i got %i!\n", error->expected, error->got);
+        break;
+    case INPUT_ERROR_SANITY:
+    default:
+        fprintf(out, "Input '%s' failed sanity check!\n", name);
+        break;
+    }
+}
 
-    int i_tube = 0;
-    for (int i_line = 0; i_line < raw->num_lines; ++i_line) {
-        if (raw->data[i_line] == NULL) {
-            continue;
-        }
-        for (int i_elem = 0; i_elem < raw->num_elems; ++i_elem) {
-            const int i_data = i_tube * raw->num_elems + i_elem;
-            input->data[i_data] = raw->data[i_line][i_elem];
-            if (input->data[i_data] < 0) {
-                input->data[i_data] = EMPTY_COLOR_INDEX;
+Input *
+Input_parse_line(const char *line, size_t len)
+{
+    IntVec *vec = IntVec_alloc(0);
+    int num_tubes = 0;
+    int num_slots = -1;
+    int num_elems = 0; /* of current tube */
+    bool is_error = false;
+    for (size_t i = 0; i <= len && is_error == false; ++i) {
+        const char c = (i < len) ? line[i] : '|';
+        if (isdigit((unsigned char) c) || c == '-') {
+            int color;
+            const char *next = _parse_color(line + i, line + len, &color);
+            if (next == NULL) {
+                is_error = true;
+                break;
+            }
+            i = (size_t) (next - line) - 1;
+            IntVec_push_back(vec, color);
+            ++num_elems;
+        } else if (c == '|' || c == ';') {
+            if (num_elems == 0) {
+                continue;
             }
+            if (num_slots == -1) {
+                num_slots = num_elems;
+            }
+            is_error = (num_elems != num_slots);
+            ++num_tubes;
+            num_elems = 0;
+        } else if (c != ',' && isspace((unsigned char) c) == 0) {
+            is_error = true;
         }
-        ++i_tube;
+    }
+    if (is_error == true || num_tubes == 0) {
+        IntVec_free(vec);
+        return NULL;
     }
 
-    RawInput_free(raw);
+    Input *input = Alloc_malloc(ALLOC_INPUT, sizeof *input);
+
+    input->num_tubes = num_tubes;
+    input->num_slots = num_slots;
+    input->num_colors = 0;
+    input->data = vec->data;
+    vec->data = NULL;
+    IntVec_free(vec);
 
     if (Input_sanity_check(input) == TUBE_FAILURE) {
-        ERROR("Input file '%s' failed sanity check!", filename);
+        Input_destroy(input);
+        return NULL;
     }
 
     return input;
@@ -431,7 +440,7 @@ Input_destroy(Input *input)
         return;
     }
 
-    free(input->data);
+    Alloc_free(input->data);
 
-    free(input);
+    Alloc_free(input);
 }
@@ -7,6 +7,30 @@
 #ifndef INPUT_H_INCLUDED
 #define INPUT_H_INCLUDED
 
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Input error enumerator.
+ */
+enum {
+    INPUT_OK = 0,
+    INPUT_ERROR_OPEN,
+    INPUT_ERROR_SYNTAX,
+    INPUT_ERROR_NUM_SLOTS,
+    INPUT_ERROR_SANITY,
+};
+
+/**
+ * Struct for details of input error.
+ */
+typedef struct {
+    int code; /* input error enumerator */
+    int line; /* line of error (1-based, 0 if unknown) */
+    int expected;
+    int got;
+} InputError;
+
 /**
  * Struct for input data.
  */
@@ -21,11 +45,59 @@ typedef struct {
  * Creates Input object from data in `filename`.
  *
  * @param[in] filename input filename
+ * @param[out] p_error pointer to InputError to write error to (or NULL)
+ *
+ * @return newly malloc'd and initialized Input object or NULL on error
+ */
+Input *
+Input_read(const char *filename, InputError *p_error);
+
+/**
+ * Creates Input object from `len` bytes of `buffer` in the input file format.
+ *
+ * @param[in] buffer buffer to parse (need not be null-terminated)
+ * @param[in] len length of buffer
+ * @param[out] p_error pointer to InputError to write error to (or NULL)
+ *
+ * @return newly malloc'd and initialized Input object or NULL on error
+ */
+Input *
+Input_parse(const char *buffer, size_t len, InputError *p_error);
+
+/**
+ * Prints human-readable message of `error` for input `name` to `out`.
  *
- * @return newly malloc'd and initialized Input object
+ * @param[in] out output FILE stream
+ * @param[in] error InputError to print
+ * @param[in] name name of input (e.g., filename)
+ */
+void
+InputError_fprint(FILE *out, const InputError *error, const char *name);
+
+/**
+ * Creates Input object from single line `line` of length `len` in the row
+ * format, with tubes separated by '|' or ';' (e.g., "1 0 | 0 1 | -1 -1").
+ *
+ * @param[in] line line to parse (need not be null-terminated)
+ * @param[in] len length of line
+ *
+ * @return newly malloc'd and initialized Input object or NULL if invalid
  */
 Input *
-Input_read(const char *filename);
+Input_parse_line(const char *line, size_t len);
+
+/**
+ * Checks if data in `input` is a valid game, i.e., the empty slots fill whole
+ * tubes and every color appears exactly `num_slots` times (counted in a single
+ * pass, colors need to be less than the total number of slots). If so, sets
+ * number of colors in `input`.
+ *
+ * @param[in,out] input Input to check sanity of
+ *
+ * @return Error code
+ */
+int
+Input_sanity_check(Input *input);
 
 /**
  * Destroys `input` and frees memory.
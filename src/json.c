@@ -0,0 +1,18 @@
+#include "json.h"
+
+void
+Json_fprint_string(FILE *out, const char *str)
+{
+    fputc('"', out);
+    for (const char *p = str; *p != '\0'; ++p) {
+        const unsigned char c = (unsigned char) *p;
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
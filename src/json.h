@@ -0,0 +1,20 @@
+/** json.h
+ *
+ * Header for (tiny) JSON output helpers of 'tubes'.
+ */
+
+#ifndef JSON_H_INCLUDED
+#define JSON_H_INCLUDED
+
+#include <stdio.h>
+
+/**
+ * Prints `str` as quoted and escaped JSON string to `out`.
+ *
+ * @param[in] out output FILE stream
+ * @param[in] str string to print
+ */
+void
+Json_fprint_string(FILE *out, const char *str);
+
+#endif /* JSON_H_INCLUDED */
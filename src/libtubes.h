@@ -0,0 +1,33 @@
+/** libtubes.h
+ *
+ * Public header of 'libtubes', the embeddable library of 'tubes'.
+ *
+ * All functions are reentrant: the only global state is the allocation layer
+ * (alloc.h, whose allocator must be set before any object is created and whose
+ * counters are updated atomically), games are created from files or memory
+ * buffers (GameInfo_create_from_buffer()) and errors are reported by return
+ * values (never by exiting). Different threads may thus work
+ * on different GameInfo objects concurrently; a single GameInfo object must not
+ * be used by several threads at once (same for SolverContext objects). Solving
+ * with limits is done by GameInfo_find_solution(); reusing one SolverContext
+ * per thread avoids allocations when solving many games in a row.
+ */
+
+#ifndef LIBTUBES_H_INCLUDED
+#define LIBTUBES_H_INCLUDED
+
+#include "alloc.h"
+#include "cache.h"
+#include "checkpoint.h"
+#include "corpus.h"
+#include "gameinfo.h"
+#include "input.h"
+#include "log.h"
+#include "profile.h"
+#include "rng.h"
+#include "solver.h"
+#include "trace.h"
+#include "tube.h"
+#include "util.h"
+
+#endif /* LIBTUBES_H_INCLUDED */
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "alloc.h"
 #include "gameinfo.h"
 #include "util.h"
 
@@ -12,11 +13,12 @@
 ActionLog *
 ActionLog_create(void)
 {
-    ActionLog *log = malloc(sizeof *log);
+    ActionLog *log = Alloc_malloc(ALLOC_LOG, sizeof *log);
 
     log->counter = 0;
     log->capacity = ACTION_LOG_INITIAL_CAPACITY;
-    log->actions = malloc(log->capacity * sizeof *log->actions);
+    log->actions
+      = Alloc_malloc(ALLOC_LOG, log->capacity * sizeof *log->actions);
 
     return log;
 }
@@ -28,33 +30,50 @@ ActionLog_destroy(ActionLog *log)
         return;
     }
 
-    free(log->actions);
+    Alloc_free(log->actions);
 
-    free(log);
+    Alloc_free(log);
 }
 
 ActionLog *
 ActionLog_duplicate(const ActionLog *log)
 {
-    ActionLog *dup = malloc(sizeof *log);
+    ActionLog *dup = Alloc_malloc(ALLOC_LOG, sizeof *log);
 
     dup->counter = log->counter;
     dup->capacity = log->capacity;
-    dup->actions = malloc(dup->capacity * sizeof *dup->actions);
+    dup->actions
+      = Alloc_malloc(ALLOC_LOG, dup->capacity * sizeof *dup->actions);
     dup->actions = memcpy(
-      dup->actions, log->actions, log->capacity * sizeof *log->actions
+      dup->actions, log->actions, log->counter * sizeof *log->actions
     );
 
     return dup;
 }
 
+void
+ActionLog_copy(ActionLog *dst, const ActionLog *src)
+{
+    if (dst->capacity < src->counter) {
+        while (dst->capacity < src->counter) {
+            dst->capacity *= 2;
+        }
+        dst->actions = Alloc_realloc(
+          ALLOC_LOG, dst->actions, dst->capacity * sizeof *dst->actions
+        );
+    }
+    memcpy(dst->actions, src->actions, src->counter * sizeof *src->actions);
+    dst->counter = src->counter;
+}
+
 void
 ActionLog_push_back(ActionLog *log, const Action *action)
 {
     if (log->counter == log->capacity) {
         log->capacity *= 2;
-        log->actions
-          = realloc(log->actions, log->capacity * sizeof *log->actions);
+        log->actions = Alloc_realloc(
+          ALLOC_LOG, log->actions, log->capacity * sizeof *log->actions
+        );
     }
     log->actions[log->counter] = *action;
     ++log->counter;
@@ -74,10 +93,214 @@ ActionLog_pop(ActionLog *log, Action *action)
 void
 ActionLog_fprint(FILE *out, const ActionLog *log)
 {
-    const int counter_width = (int) log10(log->counter + 1) + 1;
+    SolutionWriter *writer
+      = SolutionWriter_create(out, SOLUTION_TEXT, 0, log->counter);
     for (int i = 0; i < log->counter; ++i) {
-        const int i_src = log->actions[i].i_src + 1;
-        const int i_dst = log->actions[i].i_dst + 1;
-        fprintf(out, "%*i: %2i %2i\n", counter_width, i + 1, i_src, i_dst);
+        SolutionWriter_write(writer, &log->actions[i]);
+    }
+    SolutionWriter_destroy(writer);
+}
+
+int
+ActionCode_width(int num_tubes)
+{
+    return (num_tubes <= ACTION_CODE_MAX_SHORT) ? 2 : 4;
+}
+
+void
+ActionCode_encode(unsigned char *p, int width, const Action *action)
+{
+    const int half = width / 2;
+    for (int i = 0; i < half; ++i) {
+        p[i] = (unsigned char) ((action->i_src >> (8 * i)) & 0xff);
+        p[half + i] = (unsigned char) ((action->i_dst >> (8 * i)) & 0xff);
+    }
+}
+
+void
+ActionCode_decode(const unsigned char *p, int width, Action *action)
+{
+    const int half = width / 2;
+    action->i_src = 0;
+    action->i_dst = 0;
+    for (int i = half - 1; i >= 0; --i) {
+        action->i_src = (action->i_src << 8) | p[i];
+        action->i_dst = (action->i_dst << 8) | p[half + i];
+    }
+    action->chunk.color = EMPTY_COLOR_INDEX;
+    action->chunk.count = 0;
+}
+
+/**
+ * Writes `value` right-aligned to at least `width` characters to `p`.
+ *
+ * @param[out] p pointer to characters (without terminating null character)
+ * @param[in] value non-negative number to write
+ * @param[in] width minimum number of characters
+ *
+ * @return Number of characters written
+ */
+static int
+_format_uint(unsigned char *p, unsigned long value, int width)
+{
+    unsigned char digits[24];
+    int num_digits = 0;
+    do {
+        digits[num_digits++] = (unsigned char) ('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    int len = 0;
+    for (; len < width - num_digits; ++len) {
+        p[len] = ' ';
+    }
+    while (num_digits > 0) {
+        p[len++] = digits[--num_digits];
+    }
+    return len;
+}
+
+int
+SolutionWriter_parse_format(const char *str)
+{
+    if (strcmp(str, "text") == 0) {
+        return SOLUTION_TEXT;
+    }
+    if (strcmp(str, "binary") == 0) {
+        return SOLUTION_BINARY;
+    }
+    return TUBE_FAILURE;
+}
+
+SolutionWriter *
+SolutionWriter_create(FILE *out, int format, int num_tubes, long num_moves)
+{
+    SolutionWriter *writer = Alloc_malloc(ALLOC_LOG, sizeof *writer);
+
+    writer->out = out;
+    writer->format = format;
+    writer->width = ActionCode_width(num_tubes);
+    writer->counter_width = (int) log10(num_moves + 1) + 1;
+    writer->counter = 0;
+    writer->head = 0;
+
+    if (format == SOLUTION_BINARY) {
+        unsigned char *const header = writer->buffer;
+        memset(header, 0, SOLUTION_HEADER_SIZE);
+        memcpy(header, SOLUTION_MAGIC, sizeof SOLUTION_MAGIC - 1);
+        for (int i = 0; i < 4; ++i) {
+            header[8 + i] = (unsigned char) ((writer->width >> (8 * i)) & 0xff);
+            header[12 + i] = (unsigned char) ((num_tubes >> (8 * i)) & 0xff);
+        }
+        writer->head = SOLUTION_HEADER_SIZE;
+    }
+
+    return writer;
+}
+
+void
+SolutionWriter_destroy(SolutionWriter *writer)
+{
+    if (writer == NULL) {
+        return;
+    }
+
+    SolutionWriter_flush(writer);
+
+    Alloc_free(writer);
+}
+
+void
+SolutionWriter_write(SolutionWriter *writer, const Action *action)
+{
+    /* Longest line: three numbers (at most 20 digits each) and separators */
+    if (writer->head > SOLUTION_BUFFER_SIZE - 80) {
+        SolutionWriter_flush(writer);
+    }
+    unsigned char *p = writer->buffer + writer->head;
+    ++writer->counter;
+    if (writer->format == SOLUTION_BINARY) {
+        ActionCode_encode(p, writer->width, action);
+        writer->head += writer->width;
+        return;
     }
+    p += _format_uint(p, writer->counter, writer->counter_width);
+    *p++ = ':';
+    *p++ = ' ';
+    p += _format_uint(p, action->i_src + 1, 2);
+    *p++ = ' ';
+    p += _format_uint(p, action->i_dst + 1, 2);
+    *p++ = '\n';
+    writer->head = (int) (p - writer->buffer);
+}
+
+int
+SolutionWriter_flush(SolutionWriter *writer)
+{
+    const size_t len = (size_t) writer->head;
+    const int status = (fwrite(writer->buffer, 1, len, writer->out) == len)
+                         ? TUBE_SUCCESS
+                         : TUBE_FAILURE;
+    writer->head = 0;
+    return status;
+}
+
+SolutionReader *
+SolutionReader_create(FILE *in)
+{
+    unsigned char header[SOLUTION_HEADER_SIZE];
+    if (fread(header, 1, sizeof header, in) != sizeof header
+        || memcmp(header, SOLUTION_MAGIC, sizeof SOLUTION_MAGIC - 1) != 0) {
+        return NULL;
+    }
+    int width = 0;
+    int num_tubes = 0;
+    for (int i = 3; i >= 0; --i) {
+        width = (width << 8) | header[8 + i];
+        num_tubes = (num_tubes << 8) | header[12 + i];
+    }
+    if (num_tubes <= 0 || width != ActionCode_width(num_tubes)) {
+        return NULL;
+    }
+
+    SolutionReader *reader = Alloc_malloc(ALLOC_LOG, sizeof *reader);
+
+    reader->in = in;
+    reader->width = width;
+    reader->num_tubes = num_tubes;
+    reader->head = 0;
+    reader->size = 0;
+
+    return reader;
+}
+
+void
+SolutionReader_destroy(SolutionReader *reader)
+{
+    if (reader == NULL) {
+        return;
+    }
+
+    Alloc_free(reader);
+}
+
+int
+SolutionReader_read(SolutionReader *reader, Action *action)
+{
+    if (reader->size - reader->head < reader->width) {
+        /* Keep the rest of a move split between two reads */
+        const int rest = reader->size - reader->head;
+        memmove(reader->buffer, reader->buffer + reader->head, rest);
+        reader->head = 0;
+        reader->size
+          = rest
+            + (int) fread(
+              reader->buffer + rest, 1, SOLUTION_BUFFER_SIZE - rest, reader->in
+            );
+        if (reader->size < reader->width) {
+            return TUBE_FAILURE;
+        }
+    }
+    ActionCode_decode(reader->buffer + reader->head, reader->width, action);
+    reader->head += reader->width;
+    return TUBE_SUCCESS;
 }
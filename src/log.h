@@ -1,6 +1,20 @@
 /** log.h
  *
  * Header for log of actions of 'tubes'. Needed to revert moves and for solver.
+ *
+ * Moves can also be stored compactly as ActionCode (2 bytes per move for at
+ * most ACTION_CODE_MAX_SHORT tubes, 4 bytes otherwise, only the indices of the
+ * tubes; the chunks follow from replaying the moves). A SolutionWriter streams
+ * moves to a file one by one (as text or as binary ActionCode), so even very
+ * long solutions need not be collected first; a SolutionReader streams them
+ * back from a binary solution file. A binary solution file starts
+ * with a header of 16 bytes (SOLUTION_MAGIC, the size of a move and the number
+ * of tubes as 32-bit integers), followed by the moves in order, all integers
+ * little-endian:
+ *
+ *   offset  size  field
+ *        0   w/2  index of source tube
+ *      w/2   w/2  index of destination tube
  */
 
 #ifndef LOG_H_INCLUDED
@@ -10,6 +24,19 @@
 
 #include "tube.h"
 
+#define ACTION_CODE_MAX_SHORT 256 /* maximum number of tubes for 2 bytes */
+#define SOLUTION_MAGIC "TUBESOL1"
+#define SOLUTION_HEADER_SIZE 16
+#define SOLUTION_BUFFER_SIZE 4096 /* bytes buffered between writes */
+
+/**
+ * Solution format enumerator.
+ */
+enum {
+    SOLUTION_TEXT,   /* one numbered line per move (1-based tube indices) */
+    SOLUTION_BINARY, /* header and one ActionCode per move */
+};
+
 /**
  * Auxiliary struct to store action.
  */
@@ -54,6 +81,15 @@ ActionLog_destroy(ActionLog *log);
 ActionLog *
 ActionLog_duplicate(const ActionLog *log);
 
+/**
+ * Copies contents of `src` to `dst` (reusing memory of `dst`).
+ *
+ * @param[out] dst ActionLog to overwrite
+ * @param[in] src ActionLog to copy
+ */
+void
+ActionLog_copy(ActionLog *dst, const ActionLog *src);
+
 /**
  * Appends `action` to the end of `log` and potentially increases capacity.
  *
@@ -85,4 +121,145 @@ ActionLog_pop(ActionLog *log, Action *action);
 void
 ActionLog_fprint(FILE *out, const ActionLog *log);
 
+/**
+ * Struct for streaming writer of solutions.
+ */
+typedef struct {
+    FILE *out;
+    int format;        /* solution format enumerator */
+    int width;         /* size of ActionCode (binary) */
+    int counter_width; /* minimum digits of move numbers (text) */
+    long counter;      /* number of moves written */
+    int head;          /* number of bytes buffered */
+    unsigned char buffer[SOLUTION_BUFFER_SIZE];
+} SolutionWriter;
+
+/**
+ * Struct for streaming reader of binary solutions.
+ */
+typedef struct {
+    FILE *in;
+    int width;     /* size of ActionCode */
+    int num_tubes; /* number of tubes of board (from header) */
+    int head;      /* offset of next move in buffer */
+    int size;      /* number of bytes buffered */
+    unsigned char buffer[SOLUTION_BUFFER_SIZE];
+} SolutionReader;
+
+/**
+ * Returns size of ActionCode for moves on board with `num_tubes` tubes.
+ *
+ * @param[in] num_tubes number of tubes
+ *
+ * @return Size in bytes (2 or 4)
+ */
+int
+ActionCode_width(int num_tubes);
+
+/**
+ * Encodes indices of tubes of `action` to ActionCode of `width` bytes at `p`.
+ *
+ * @param[out] p pointer to bytes
+ * @param[in] width size of ActionCode (see ActionCode_width())
+ * @param[in] action Action to encode
+ */
+void
+ActionCode_encode(unsigned char *p, int width, const Action *action);
+
+/**
+ * Decodes ActionCode of `width` bytes at `p` to `action` (with empty chunk,
+ * which is only known after replaying the move).
+ *
+ * @param[in] p pointer to bytes
+ * @param[in] width size of ActionCode (see ActionCode_width())
+ * @param[out] action Action to write to
+ */
+void
+ActionCode_decode(const unsigned char *p, int width, Action *action);
+
+/**
+ * Parses name of solution format ("text" or "binary").
+ *
+ * @param[in] str name of format
+ *
+ * @return Solution format enumerator (or TUBE_FAILURE if unknown)
+ */
+int
+SolutionWriter_parse_format(const char *str);
+
+/**
+ * Allocates SolutionWriter writing to `out` in format `format` (for binary, the
+ * header is buffered like the moves, so nothing is written before the first
+ * flush). Move numbers of text are padded to the width of `num_moves` (pass 0
+ * if unknown), as in ActionLog_fprint().
+ *
+ * @param[in] out output FILE stream (binary for SOLUTION_BINARY)
+ * @param[in] format solution format enumerator
+ * @param[in] num_tubes number of tubes of board
+ * @param[in] num_moves expected number of moves (or 0)
+ *
+ * @return Pointer to newly allocated SolutionWriter object
+ */
+SolutionWriter *
+SolutionWriter_create(FILE *out, int format, int num_tubes, long num_moves);
+
+/**
+ * Flushes and destroys `writer` and frees memory (does not close its stream).
+ *
+ * @param[in] writer SolutionWriter to be destroyed (or NULL)
+ */
+void
+SolutionWriter_destroy(SolutionWriter *writer);
+
+/**
+ * Appends `action` to solution of `writer`.
+ *
+ * @param[in,out] writer SolutionWriter to write to
+ * @param[in] action Action to append
+ */
+void
+SolutionWriter_write(SolutionWriter *writer, const Action *action);
+
+/**
+ * Writes buffered moves of `writer` to its stream.
+ *
+ * @param[in,out] writer SolutionWriter to flush
+ *
+ * @return Error code
+ */
+int
+SolutionWriter_flush(SolutionWriter *writer);
+
+/**
+ * Allocates SolutionReader reading binary solution from `in` and reads its
+ * header.
+ *
+ * @param[in] in input FILE stream (binary)
+ *
+ * @return Pointer to newly allocated SolutionReader object (or NULL if the
+ *         header is missing or invalid)
+ */
+SolutionReader *
+SolutionReader_create(FILE *in);
+
+/**
+ * Destroys `reader` and frees memory (does not close its stream).
+ *
+ * @param[in] reader SolutionReader to be destroyed (or NULL)
+ */
+void
+SolutionReader_destroy(SolutionReader *reader);
+
+/**
+ * Reads next move of solution of `reader` to `action` (with empty chunk, see
+ * ActionCode_decode()).
+ *
+ * @param[in,out] reader SolutionReader to read from
+ * @param[out] action Action to write to
+ *
+ * @return Error code (failure at end of solution or within a truncated move)
+ */
+int
+SolutionReader_read(SolutionReader *reader, Action *action);
+
 #endif /* LOG_H_INCLUDED */
@@ -1,7 +1,14 @@
 #include <string.h>
 
+#include "alloc.h"
+#include "batch.h"
+#include "bulk.h"
+#include "daemon.h"
 #include "gameinfo.h"
+#include "hint.h"
 #include "options.h"
+#include "progress.h"
+#include "sampler.h"
 #include "seed.h"
 #include "util.h"
 
@@ -10,6 +17,9 @@
 #define DEFAULT_NUMBER_OF_COLORS 5
 #define DEFAULT_NUMBER_OF_EXTRA_TUBES 2
 #define DEFAULT_NUMBER_OF_SLOTS 4
+#define DEFAULT_NODE_LIMIT 1000000
+#define DEFAULT_PROGRESS_INTERVAL 1.0
+#define DEFAULT_CHECKPOINT_INTERVAL 60.0
 
 /**
  * Enumerator for possible options.
@@ -23,6 +33,39 @@ enum {
     OPT_f,
     OPT_S,
     OPT_N,
+    OPT_G,
+    OPT_R,
+    OPT_j,
+    OPT_n,
+    OPT_m,
+    OPT_M,
+    OPT_o,
+    OPT_r,
+    OPT_B,
+    OPT_L,
+    OPT_F,
+    OPT_k,
+    OPT_D,
+    OPT_d,
+    OPT_U,
+    OPT_C,
+    OPT_K,
+    OPT_T,
+    OPT_P,
+    OPT_Y,
+    OPT_A,
+    OPT_X,
+    OPT_x,
+    OPT_p,
+    OPT_w,
+    OPT_E,
+    OPT_W,
+    OPT_I,
+    OPT_Z,
+    OPT_H,
+    OPT_V,
+    OPT_Q,
+    OPT_O,
 };
 
 /**
@@ -33,6 +76,24 @@ static const ProgramOption OPTIONS[] = {
   [OPT_e] = {'e', "extra", true},  [OPT_l] = {'l', "slots", true},
   [OPT_s] = {'s', "seed", true},   [OPT_f] = {'f', "file", true},
   [OPT_S] = {'S', "solve", false}, [OPT_N] = {'N', "noplay", false},
+  [OPT_G] = {'G', "generate", false}, [OPT_R] = {'R', "range", true},
+  [OPT_j] = {'j', "threads", true},   [OPT_n] = {'n', "nodes", true},
+  [OPT_m] = {'m', "min-moves", true}, [OPT_M] = {'M', "max-moves", true},
+  [OPT_o] = {'o', "output", true},   [OPT_r] = {'r', "scramble", true},
+  [OPT_B] = {'B', "batch", false},    [OPT_L] = {'L', "list", true},
+  [OPT_F] = {'F', "format", true},    [OPT_k] = {'k', "shard", true},
+  [OPT_D] = {'D', "segments", true},  [OPT_d] = {'d', "daemon", false},
+  [OPT_U] = {'U', "socket", true},   [OPT_C] = {'C', "corpus", true},
+  [OPT_K] = {'K', "cache", true},    [OPT_T] = {'T', "stats", false},
+  [OPT_P] = {'P', "profile", false},  [OPT_Y] = {'Y', "trace", true},
+  [OPT_A] = {'A', "alloc", false},   [OPT_X] = {'X', "search-trace", true},
+  [OPT_x] = {'x', "trace-last", true}, [OPT_p] = {'p', "progress", true},
+  [OPT_w] = {'w', "status", true},    [OPT_E] = {'E', "metrics", true},
+  [OPT_W] = {'W', "checkpoint", true},
+  [OPT_I] = {'I', "checkpoint-interval", true},
+  [OPT_Z] = {'Z', "resume", false},  [OPT_H] = {'H', "nohints", false},
+  [OPT_V] = {'V', "hidden", true},    [OPT_Q] = {'Q', "samples", true},
+  [OPT_O] = {'O', "solution-format", true},
 };
 
 /**
@@ -50,7 +111,59 @@ static const char *const usage
     "  -s, --seed    Random seed for game (default = random)\n"
     "  -f, --file    Read game from file instead of generating it from seed\n"
     "  -S, --solve   Print solution to file?\n"
-    "  -N, --noplay  Do not actually play game?\n";
+    "  -O, --solution-format  Format of solution file ('text' or 'binary',\n"
+    "                         default = 'text')\n"
+    "  -N, --noplay  Do not actually play game?\n"
+    "  -H, --nohints  Do not solve in background for hints ('h') while\n"
+    "                 playing? (node limit per board, see -n)\n"
+    "  -V, --hidden   Hide this number of lowest slots of every tube (shown\n"
+    "                 as '?' until they get on top, default = 0)\n"
+    "  -Q, --samples  Number of sampled assignments of hidden colors for\n"
+    "                 hints (solved in parallel, see -j, default = 1000)\n"
+    "  -K, --cache   Look up (and store) solution in this cache file\n"
+    "  -T, --stats   Print solver statistics as JSON to stderr (also batch)\n"
+    "  -P, --profile   Print wall and CPU time of phases as JSON to stderr\n"
+    "                  (also batch)\n"
+    "  -Y, --trace     Write trace of phases to this file (Chrome format)\n"
+    "  -A, --alloc     Print allocation counters (per subsystem) as JSON to\n"
+    "                  stderr at exit (also batch)\n"
+    "  -X, --search-trace  Write binary trace of search to this file (batch:\n"
+    "                      one file per thread, suffixed '.INDEX'; decode\n"
+    "                      with 'tubes-traceview')\n"
+    "  -x, --trace-last    Only keep this number of last events of search\n"
+    "  -p, --progress  Report progress of solver (nodes, nodes/s, depth, best\n"
+    "                  bound, memory) as JSON to stderr every this number of\n"
+    "                  seconds (also batch)\n"
+    "  -w, --status    Write progress reports to this status file instead\n"
+    "                  (replaced on every report, default interval = 1)\n"
+    "  -W, --checkpoint  Periodically save state of search to this file (it\n"
+    "                    is removed once the search is finished)\n"
+    "  -I, --checkpoint-interval  Seconds between checkpoints (default = 60)\n"
+    "  -Z, --resume      Continue search from checkpoint (see -W)\n"
+    "  -r, --scramble  Generate solvable game by applying this number of\n"
+    "                  reverse moves to solved game (default = off)\n"
+    "\n"
+    "Bulk generation and batch solving:\n"
+    "  -G, --generate   Generate puzzle pack for range of seeds\n"
+    "  -B, --batch      Solve games of range of seeds, list or corpus\n"
+    "  -R, --range      Range of seeds 'FIRST:LAST' (inclusive)\n"
+    "  -L, --list       File with list of input files (one per line)\n"
+    "  -C, --corpus     Corpus file (text or binary, see 'tubes-pack')\n"
+    "  -F, --format     Output format of batch ('jsonl' or 'csv')\n"
+    "  -j, --threads    Number of threads (default = number of cores)\n"
+    "  -n, --nodes      Node limit of solver (default = 1000000)\n"
+    "  -m, --min-moves  Minimum number of moves of solution (default = 0)\n"
+    "  -M, --max-moves  Maximum number of moves of solution (default = any)\n"
+    "  -o, --output     Output file (default = stdout)\n"
+    "  -k, --shard      Only solve shard 'INDEX/COUNT' of batch (0-based)\n"
+    "  -D, --segments   Write resumable result segment of shard to this\n"
+    "                   directory (combine segments with 'tubes-merge')\n"
+    "\n"
+    "Daemon (one request '[ID:] TUBE | TUBE | ...' per line, see -j, -n, -K):\n"
+    "  -d, --daemon     Solve requests from stdin (or socket) until end\n"
+    "  -U, --socket     Listen on this Unix domain socket instead of stdin\n"
+    "  -E, --metrics    Write metrics (Prometheus text format) to this file\n"
+    "                   every second\n";
 
 /**
  * Quick-and-dirty implementation of 'strnlen' to ensure it's available.
@@ -98,9 +211,114 @@ _strndup(const char *str, size_t maxlen)
     return dup;
 }
 
+/**
+ * Parses range of seeds 'FIRST:LAST' in `str` and writes it to `p_first` and
+ * `p_last`.
+ *
+ * @param[in] str string to parse
+ * @param[out] p_first pointer to first seed
+ * @param[out] p_last pointer to last seed
+ *
+ * @return Error code
+ */
+static int
+_parse_range(const char *str, unsigned int *p_first, unsigned int *p_last)
+{
+    char *end;
+    *p_first = (unsigned int) strtoul(str, &end, 10);
+    if (end == str || *end != ':') {
+        return TUBE_FAILURE;
+    }
+    const char *p = end + 1;
+    *p_last = (unsigned int) strtoul(p, &end, 10);
+    if (end == p || *end != '\0' || *p_last < *p_first) {
+        return TUBE_FAILURE;
+    }
+    return TUBE_SUCCESS;
+}
+
+/**
+ * Opens output file `outname` for writing (or returns 'stdout' if NULL).
+ *
+ * @param[in] outname name of output file
+ *
+ * @return Opened FILE stream
+ */
+static FILE *
+_open_output(const char *outname)
+{
+    if (outname == NULL) {
+        return stdout;
+    }
+    FILE *out = fopen(outname, "w");
+    if (out == NULL) {
+        ERROR("Could not open output file '%s'!", outname);
+    }
+    return out;
+}
+
+/**
+ * Parses shard 'INDEX/COUNT' in `str` and writes it to `p_index` and
+ * `p_count`.
+ *
+ * @param[in] str string to parse
+ * @param[out] p_index pointer to index of shard
+ * @param[out] p_count pointer to number of shards
+ *
+ * @return Error code
+ */
+static int
+_parse_shard(const char *str, int *p_index, int *p_count)
+{
+    char *end;
+    *p_index = (int) strtol(str, &end, 10);
+    if (end == str || *end != '/') {
+        return TUBE_FAILURE;
+    }
+    const char *p = end + 1;
+    *p_count = (int) strtol(p, &end, 10);
+    if (end == p || *end != '\0' || *p_count < 1 || *p_index < 0
+        || *p_index >= *p_count) {
+        return TUBE_FAILURE;
+    }
+    return TUBE_SUCCESS;
+}
+
+/**
+ * Writes trace of `profiler` to file `tracename` (if not NULL), prints its
+ * phases to stderr (if `do_profile` is true) and destroys it.
+ *
+ * @param[in] profiler Profiler to report (or NULL)
+ * @param[in] do_profile print phases?
+ * @param[in] tracename name of trace file (or NULL)
+ */
+static void
+_report_profile(Profiler *profiler, bool do_profile, const char *tracename)
+{
+    if (profiler == NULL) {
+        return;
+    }
+    if (tracename != NULL) {
+        FILE *out = fopen(tracename, "w");
+        if (out == NULL) {
+            ERROR("Could not open trace file '%s'!", tracename);
+        }
+        Profiler_fprint_trace(out, profiler);
+        fclose(out);
+    }
+    if (do_profile == true) {
+        Profiler_fprint_json(stderr, profiler);
+    }
+    Profiler_destroy(profiler);
+}
+
 int
 main(int argc, char **argv)
 {
+    /* Always time option parsing, profiler is dropped if not requested */
+    Profiler *profiler = Profiler_create(true);
+    ProfileSpan span = Profiler_begin(profiler, "options");
+
     int num_colors = DEFAULT_NUMBER_OF_COLORS;
     int num_extra = DEFAULT_NUMBER_OF_EXTRA_TUBES;
     int num_slots = DEFAULT_NUMBER_OF_SLOTS;
@@ -108,6 +326,42 @@ main(int argc, char **argv)
     char *filename = NULL;
     bool do_solve = false;
     bool do_noplay = false;
+    bool do_nohints = false;
+    int num_hidden = 0;
+    int num_samples = SAMPLER_DEFAULT_SAMPLES;
+    bool do_generate = false;
+    bool do_batch = false;
+    const char *listname = NULL;
+    const char *corpusname = NULL;
+    const char *cachename = NULL;
+    bool do_stats = false;
+    bool do_profile = false;
+    bool do_alloc = false;
+    const char *tracename = NULL;
+    const char *searchtracename = NULL;
+    long trace_last = 0;
+    double progress_interval = 0;
+    const char *statusname = NULL;
+    const char *format = "jsonl";
+    const char *solution_format = "text";
+    const char *shard = NULL;
+    const char *segment_dir = NULL;
+    bool do_daemon = false;
+    const char *socket_path = NULL;
+    const char *metricsname = NULL;
+    SolverCheckpoint checkpoint = {
+      .filename = NULL,
+      .interval = DEFAULT_CHECKPOINT_INTERVAL,
+    };
+    int num_scramble = 0;
+    const char *range = NULL;
+    const char *outname = NULL;
+    BulkOptions bulk = {
+      .max_nodes = DEFAULT_NODE_LIMIT,
+      .min_moves = 0,
+      .max_moves = 0,
+      .num_threads = 0,
+    };
 
     char *optarg;
     for (int i = 1; i < argc; ++i) {
@@ -143,6 +397,138 @@ main(int argc, char **argv)
             do_noplay = true;
             continue;
         }
+        if (ProgramOption_check(&OPTIONS[OPT_G], &i, argv, &optarg) == true) {
+            do_generate = true;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_R], &i, argv, &optarg) == true) {
+            range = optarg;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_j], &i, argv, &optarg) == true) {
+            bulk.num_threads = atoi(optarg);
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_n], &i, argv, &optarg) == true) {
+            bulk.max_nodes = atol(optarg);
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_m], &i, argv, &optarg) == true) {
+            bulk.min_moves = atoi(optarg);
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_M], &i, argv, &optarg) == true) {
+            bulk.max_moves = atoi(optarg);
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_B], &i, argv, &optarg) == true) {
+            do_batch = true;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_L], &i, argv, &optarg) == true) {
+            listname = optarg;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_C], &i, argv, &optarg) == true) {
+            corpusname = optarg;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_T], &i, argv, &optarg) == true) {
+            do_stats = true;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_P], &i, argv, &optarg) == true) {
+            do_profile = true;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_A], &i, argv, &optarg) == true) {
+            do_alloc = true;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_Y], &i, argv, &optarg) == true) {
+            tracename = optarg;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_X], &i, argv, &optarg) == true) {
+            searchtracename = optarg;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_x], &i, argv, &optarg) == true) {
+            trace_last = atol(optarg);
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_p], &i, argv, &optarg) == true) {
+            progress_interval = atof(optarg);
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_w], &i, argv, &optarg) == true) {
+            statusname = optarg;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_K], &i, argv, &optarg) == true) {
+            cachename = optarg;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_F], &i, argv, &optarg) == true) {
+            format = optarg;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_k], &i, argv, &optarg) == true) {
+            shard = optarg;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_D], &i, argv, &optarg) == true) {
+            segment_dir = optarg;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_d], &i, argv, &optarg) == true) {
+            do_daemon = true;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_U], &i, argv, &optarg) == true) {
+            socket_path = optarg;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_W], &i, argv, &optarg) == true) {
+            checkpoint.filename = optarg;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_I], &i, argv, &optarg) == true) {
+            checkpoint.interval = atof(optarg);
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_Z], &i, argv, &optarg) == true) {
+            checkpoint.do_resume = true;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_H], &i, argv, &optarg) == true) {
+            do_nohints = true;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_V], &i, argv, &optarg) == true) {
+            num_hidden = atoi(optarg);
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_Q], &i, argv, &optarg) == true) {
+            num_samples = atoi(optarg);
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_O], &i, argv, &optarg) == true) {
+            solution_format = optarg;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_E], &i, argv, &optarg) == true) {
+            metricsname = optarg;
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_r], &i, argv, &optarg) == true) {
+            num_scramble = atoi(optarg);
+            continue;
+        }
+        if (ProgramOption_check(&OPTIONS[OPT_o], &i, argv, &optarg) == true) {
+            outname = optarg;
+            continue;
+        }
         ERROR("Unknown argument: '%s'\n\n%s", argv[i], usage);
     }
 
@@ -155,21 +541,214 @@ main(int argc, char **argv)
     if (num_slots < 1) {
         ERROR("Invalid number of slots per tube: %i", num_slots);
     }
+    if (statusname != NULL && progress_interval <= 0) {
+        progress_interval = DEFAULT_PROGRESS_INTERVAL;
+    }
+    Profiler_end(profiler, &span);
+    Alloc_set_tracking(do_alloc);
+    SolverProgress progress;
+    SolverProgress_init(&progress);
+    if (do_profile == false && tracename == NULL) {
+        Profiler_destroy(profiler);
+        profiler = NULL;
+    }
+
+    if (do_daemon == true) {
+        const DaemonOptions daemon = {
+          .socket_path = socket_path,
+          .max_nodes = bulk.max_nodes,
+          .num_threads = bulk.num_threads,
+          .cache_path = cachename,
+          .metrics_path = metricsname,
+        };
+        free(filename);
+        if (Daemon_run(&daemon) == TUBE_FAILURE) {
+            ERROR(
+              "Could not open cache or listen on socket '%s'!", socket_path
+            );
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if (do_generate == true) {
+        bulk.num_colors = num_colors;
+        bulk.num_extra = num_extra;
+        bulk.num_slots = num_slots;
+        bulk.num_scramble = num_scramble;
+        if (range == NULL) {
+            ERROR("Missing range of seeds (option -R)");
+        }
+        if (_parse_range(range, &bulk.seed_first, &bulk.seed_last)
+            == TUBE_FAILURE) {
+            ERROR("Invalid range of seeds: '%s'", range);
+        }
+        FILE *out = _open_output(outname);
+        const long num_accepted = Bulk_generate(&bulk, out);
+        if (out != stdout) {
+            fclose(out);
+        }
+        fprintf(stderr, "Accepted %li puzzles.\n", num_accepted);
+        free(filename);
+        return EXIT_SUCCESS;
+    }
+
+    if (do_batch == true) {
+        SolverStats stats = {0};
+        BatchOptions batch = {
+          .num_colors = num_colors,
+          .num_extra = num_extra,
+          .num_slots = num_slots,
+          .listname = listname,
+          .corpusname = corpusname,
+          .max_nodes = bulk.max_nodes,
+          .num_threads = bulk.num_threads,
+          .format = Batch_parse_format(format),
+          .segment_dir = segment_dir,
+          .stats = do_stats ? &stats : NULL,
+          .trace_name = searchtracename,
+          .trace_last = trace_last,
+          .progress = (progress_interval > 0) ? &progress : NULL,
+        };
+        if (batch.format == TUBE_FAILURE) {
+            ERROR("Invalid output format: '%s'", format);
+        }
+        if (shard != NULL
+            && _parse_shard(shard, &batch.shard_index, &batch.num_shards)
+                 == TUBE_FAILURE) {
+            ERROR("Invalid shard: '%s'", shard);
+        }
+        if (listname == NULL && corpusname == NULL) {
+            if (range == NULL) {
+                ERROR("Missing range of seeds (option -R)");
+            }
+            if (_parse_range(range, &batch.seed_first, &batch.seed_last)
+                == TUBE_FAILURE) {
+                ERROR("Invalid range of seeds: '%s'", range);
+            }
+        }
+        FILE *out = _open_output(outname);
+        ProgressReporter *reporter
+          = (batch.progress != NULL)
+              ? ProgressReporter_start(&progress, progress_interval, statusname)
+              : NULL;
+        span = Profiler_begin(profiler, "batch");
+        const int res = Batch_run(&batch, out);
+        Profiler_end(profiler, &span);
+        ProgressReporter_stop(reporter);
+        if (out != stdout) {
+            fclose(out);
+        }
+        free(filename);
+        if (res == TUBE_FAILURE) {
+            ERROR("Could not open list, corpus or result segment!");
+        }
+        if (do_stats == true) {
+            SolverStats_fprint_json(stderr, &stats);
+        }
+        _report_profile(profiler, do_profile, tracename);
+        if (do_alloc == true) {
+            Alloc_fprint_json(stderr);
+        }
+        return EXIT_SUCCESS;
+    }
 
     GameInfo *info = NULL;
-    if (filename == NULL) {
+    span = Profiler_begin(
+      profiler, (filename == NULL) ? "generate" : "input_read"
+    );
+    if (filename == NULL && num_scramble > 0) {
+        info = GameInfo_create_from_scramble(
+          num_colors, num_extra, num_slots, seed, num_scramble, NULL
+        );
+    } else if (filename == NULL) {
         info
           = GameInfo_create_from_seed(num_colors, num_extra, num_slots, seed);
     } else {
-        info = GameInfo_create_from_file(filename);
+        InputError error;
+        info = GameInfo_create_from_file(filename, &error);
+        if (info == NULL) {
+            InputError_fprint(stderr, &error, filename);
+            free(filename);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (num_hidden > 0) {
+        GameInfo_hide(info, num_hidden);
+    }
+    Profiler_end(profiler, &span);
+    info->profiler = profiler;
+    info->solution_format = SolutionWriter_parse_format(solution_format);
+    if (info->solution_format == TUBE_FAILURE) {
+        ERROR("Invalid solution format: '%s'", solution_format);
     }
     if (do_solve == true) {
-        GameInfo_solve(info);
+        SolutionCache *cache = NULL;
+        if (cachename != NULL) {
+            cache = SolutionCache_open(cachename);
+            if (cache == NULL) {
+                ERROR("Could not open solution cache '%s'!", cachename);
+            }
+        }
+        FILE *trace_out = NULL;
+        if (searchtracename != NULL) {
+            trace_out = fopen(searchtracename, "wb");
+            if (trace_out == NULL) {
+                ERROR("Could not open search trace '%s'!", searchtracename);
+            }
+            info->trace = SearchTrace_create(
+              trace_out, (trace_last > 0) ? trace_last : TRACE_DEFAULT_CAPACITY,
+              trace_last > 0
+            );
+        }
+        ProgressReporter *reporter = NULL;
+        if (progress_interval > 0) {
+            info->progress = &progress;
+            reporter = ProgressReporter_start(
+              &progress, progress_interval, statusname
+            );
+        }
+        if (checkpoint.filename != NULL) {
+            info->checkpoint = &checkpoint;
+        } else if (checkpoint.do_resume == true) {
+            ERROR("Option --resume requires a checkpoint file (-W)!");
+        }
+        SolverStats stats;
+        GameInfo_solve(info, cache, &stats);
+        if (checkpoint.do_resume == true && checkpoint.is_resumed == false) {
+            fprintf(
+              stderr, "No valid checkpoint in '%s', started from scratch.\n",
+              checkpoint.filename
+            );
+        }
+        ProgressReporter_stop(reporter);
+        SolutionCache_close(cache);
+        if (trace_out != NULL) {
+            SearchTrace_destroy(info->trace);
+            info->trace = NULL;
+            fclose(trace_out);
+        }
+        if (do_stats == true) {
+            SolverStats_fprint_json(stderr, &stats);
+        }
     }
     if (do_noplay == false) {
+        const SamplerOptions sampler = {
+          .num_samples = num_samples,
+          .num_threads = bulk.num_threads,
+          .max_nodes = bulk.max_nodes,
+          .seed = (uint64_t) seed,
+        };
+        HintEngine *hints
+          = (do_nohints == false) ? HintEngine_start(info, &sampler) : NULL;
         GameInfo_play(info);
+        HintEngine_stop(hints);
+        info->hints = NULL;
     }
     GameInfo_destroy(info);
+    _report_profile(profiler, do_profile, tracename);
+    if (do_alloc == true) {
+        Alloc_fprint_json(stderr);
+    }
 
     free(filename);
 
@@ -0,0 +1,172 @@
+/** merge.c
+ *
+ * 'tubes-merge': combines the result segments of sharded batch runs of 'tubes'
+ * into one result sorted by id. Records with invalid checksums are dropped,
+ * duplicates are removed and incomplete runs are reported.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "segment.h"
+#include "util.h"
+
+#define INITIAL_CAPACITY 1024
+
+/**
+ * Auxiliary struct for a single record.
+ */
+typedef struct {
+    long id;
+    char *record;
+} Entry;
+
+/**
+ * Comparison function for Entry objects (by id) in the style of the C standard
+ * library.
+ *
+ * @param[in] lhs pointer to left hand side
+ * @param[in] rhs pointer to right hand side
+ *
+ * @return <0 if `lhs` is less than `rhs, >0 if greater than, 0 if equal
+ */
+static int
+_cmp_fnc_entry(const void *lhs, const void *rhs)
+{
+    const long a = ((const Entry *) lhs)->id;
+    const long b = ((const Entry *) rhs)->id;
+    return (a > b) - (a < b);
+}
+
+/**
+ * Usage string.
+ */
+static const char *const usage
+  = "Usage: tubes-merge [-o OUTPUT] SEGMENT...\n"
+    "Combines result segments of sharded batch runs of 'tubes' into one\n"
+    "result (JSONL) sorted by id.\n";
+
+int
+main(int argc, char **argv)
+{
+    const char *outname = NULL;
+    int i_arg = 1;
+    if (argc > 2 && strcmp(argv[1], "-o") == 0) {
+        outname = argv[2];
+        i_arg = 3;
+    }
+    if (i_arg >= argc || strcmp(argv[i_arg], "-h") == 0) {
+        ERROR("%s", usage);
+    }
+
+    Entry *entries = malloc(INITIAL_CAPACITY * sizeof *entries);
+    long num_entries = 0;
+    long capacity = INITIAL_CAPACITY;
+    long num_corrupt = 0;
+
+    char *desc = NULL;
+    int num_shards = 0;
+    bool *has_shard = NULL;
+
+    char *line = NULL;
+    size_t line_capacity = 0;
+    for (; i_arg < argc; ++i_arg) {
+        const char *const filename = argv[i_arg];
+        FILE *in = fopen(filename, "r");
+        if (in == NULL) {
+            ERROR("Could not open segment '%s'!", filename);
+        }
+        int file_index, file_num;
+        const char *file_desc;
+        if (getline(&line, &line_capacity, in) <= 0
+            || Segment_parse_header(line, &file_index, &file_num, &file_desc)
+                 == TUBE_FAILURE
+            || file_num < 1 || file_index < 0 || file_index >= file_num) {
+            ERROR("Invalid header of segment '%s'!", filename);
+        }
+        if (desc == NULL) {
+            const size_t len = strlen(file_desc);
+            desc = malloc(len + 1);
+            memcpy(desc, file_desc, len + 1);
+            num_shards = file_num;
+            has_shard = calloc(num_shards, sizeof *has_shard);
+        } else if (strcmp(desc, file_desc) != 0 || num_shards != file_num) {
+            ERROR("Segment '%s' belongs to a different run!", filename);
+        }
+        has_shard[file_index] = true;
+
+        ssize_t len;
+        while ((len = getline(&line, &line_capacity, in)) > 0) {
+            const char *record;
+            long id;
+            if (Segment_parse_line(line, (size_t) len, &record, &id)
+                == TUBE_FAILURE) {
+                ++num_corrupt;
+                continue;
+            }
+            if (num_entries == capacity) {
+                capacity *= 2;
+                entries = realloc(entries, capacity * sizeof *entries);
+            }
+            const size_t reclen = strlen(record);
+            entries[num_entries].id = id;
+            entries[num_entries].record = malloc(reclen + 1);
+            memcpy(entries[num_entries].record, record, reclen + 1);
+            ++num_entries;
+        }
+        fclose(in);
+    }
+    free(line);
+
+    qsort(entries, num_entries, sizeof *entries, &_cmp_fnc_entry);
+
+    FILE *out = stdout;
+    if (outname != NULL) {
+        out = fopen(outname, "w");
+        if (out == NULL) {
+            ERROR("Could not open output file '%s'!", outname);
+        }
+    }
+    long num_written = 0;
+    for (long i = 0; i < num_entries; ++i) {
+        if (i > 0 && entries[i].id == entries[i - 1].id) {
+            continue;
+        }
+        fprintf(out, "%s\n", entries[i].record);
+        ++num_written;
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    fprintf(stderr, "Merged %li records", num_written);
+    if (num_corrupt > 0) {
+        fprintf(stderr, ", dropped %li corrupt lines", num_corrupt);
+    }
+    fprintf(stderr, ".\n");
+    for (int i = 0; i < num_shards; ++i) {
+        if (has_shard[i] == false) {
+            fprintf(stderr, "Missing segment of shard %i/%i!\n", i, num_shards);
+        }
+    }
+    unsigned int first, last;
+    if (sscanf(desc, "source=seeds:%u:%u", &first, &last) == 2
+        && num_written != (long) (last - first) + 1) {
+        fprintf(
+          stderr, "Incomplete: expected %li records!\n",
+          (long) (last - first) + 1
+        );
+    }
+
+    for (long i = 0; i < num_entries; ++i) {
+        free(entries[i].record);
+    }
+    free(entries);
+    free(has_shard);
+    free(desc);
+
+    return EXIT_SUCCESS;
+}
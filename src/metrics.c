@@ -0,0 +1,156 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "metrics.h"
+
+#include <string.h>
+
+#include "ticker.h"
+#include "util.h"
+
+#define METRICS_NAME_BUFFER_SIZE 4096
+
+/**
+ * Upper bounds of buckets of latency histogram in seconds.
+ */
+static const double BOUNDS[METRICS_NUM_BUCKETS] = {
+  0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5, 10,
+};
+
+/**
+ * Names of outcomes (for labels).
+ */
+static const char *const OUTCOME_NAMES[METRICS_ERROR + 1] = {
+  [SOLVER_SOLVED] = "solved",
+  [SOLVER_UNSOLVED] = "unsolved",
+  [SOLVER_ABORTED] = "aborted",
+  [METRICS_ERROR] = "error",
+};
+
+void
+Metrics_init(Metrics *metrics, int num_workers)
+{
+    memset(metrics, 0, sizeof *metrics);
+    metrics->num_workers = num_workers;
+    metrics->start = Ticker_now();
+    pthread_mutex_init(&metrics->mutex, NULL);
+}
+
+void
+Metrics_free(Metrics *metrics)
+{
+    pthread_mutex_destroy(&metrics->mutex);
+}
+
+void
+Metrics_begin_request(Metrics *metrics)
+{
+    pthread_mutex_lock(&metrics->mutex);
+    ++metrics->active_workers;
+    pthread_mutex_unlock(&metrics->mutex);
+}
+
+void
+Metrics_end_request(
+  Metrics *metrics, int outcome, double seconds, long nodes, int cache
+)
+{
+    int i_bucket = 0;
+    while (i_bucket < METRICS_NUM_BUCKETS && seconds > BOUNDS[i_bucket]) {
+        ++i_bucket;
+    }
+
+    pthread_mutex_lock(&metrics->mutex);
+    --metrics->active_workers;
+    ++metrics->requests[outcome];
+    ++metrics->buckets[i_bucket];
+    metrics->seconds += seconds;
+    metrics->nodes += nodes;
+    metrics->cache_hits += cache == METRICS_CACHE_HIT;
+    metrics->cache_misses += cache == METRICS_CACHE_MISS;
+    pthread_mutex_unlock(&metrics->mutex);
+}
+
+void
+Metrics_fprint_prometheus(FILE *out, Metrics *metrics, long queue_depth)
+{
+    pthread_mutex_lock(&metrics->mutex);
+    const Metrics snapshot = *metrics;
+    pthread_mutex_unlock(&metrics->mutex);
+
+    fprintf(
+      out, "# HELP tubes_requests_total Requests by outcome (aborted means "
+           "node limit hit, unsolved means proven unsolvable).\n"
+           "# TYPE tubes_requests_total counter\n"
+    );
+    long count = 0;
+    for (int i = 0; i <= METRICS_ERROR; ++i) {
+        fprintf(
+          out, "tubes_requests_total{status=\"%s\"} %li\n", OUTCOME_NAMES[i],
+          snapshot.requests[i]
+        );
+        count += snapshot.requests[i];
+    }
+
+    fprintf(
+      out, "# HELP tubes_request_duration_seconds Latency of requests (parse, "
+           "cache lookup and solve).\n"
+           "# TYPE tubes_request_duration_seconds histogram\n"
+    );
+    long cumulative = 0;
+    for (int i = 0; i < METRICS_NUM_BUCKETS; ++i) {
+        cumulative += snapshot.buckets[i];
+        fprintf(
+          out, "tubes_request_duration_seconds_bucket{le=\"%g\"} %li\n",
+          BOUNDS[i], cumulative
+        );
+    }
+    fprintf(
+      out,
+      "tubes_request_duration_seconds_bucket{le=\"+Inf\"} %li\n"
+      "tubes_request_duration_seconds_sum %.6f\n"
+      "tubes_request_duration_seconds_count %li\n",
+      count, snapshot.seconds, count
+    );
+
+    fprintf(
+      out,
+      "# HELP tubes_cache_lookups_total Lookups in solution cache by result.\n"
+      "# TYPE tubes_cache_lookups_total counter\n"
+      "tubes_cache_lookups_total{result=\"hit\"} %li\n"
+      "tubes_cache_lookups_total{result=\"miss\"} %li\n"
+      "# HELP tubes_solver_nodes_total Boards expanded by solver.\n"
+      "# TYPE tubes_solver_nodes_total counter\n"
+      "tubes_solver_nodes_total %li\n"
+      "# HELP tubes_queue_depth Requests waiting for a worker.\n"
+      "# TYPE tubes_queue_depth gauge\n"
+      "tubes_queue_depth %li\n"
+      "# HELP tubes_workers_active Workers busy with a request.\n"
+      "# TYPE tubes_workers_active gauge\n"
+      "tubes_workers_active %i\n"
+      "# HELP tubes_workers Worker threads.\n"
+      "# TYPE tubes_workers gauge\n"
+      "tubes_workers %i\n"
+      "# HELP tubes_uptime_seconds Time since start of service.\n"
+      "# TYPE tubes_uptime_seconds gauge\n"
+      "tubes_uptime_seconds %.3f\n",
+      snapshot.cache_hits, snapshot.cache_misses, snapshot.nodes, queue_depth,
+      snapshot.active_workers, snapshot.num_workers,
+      Ticker_now() - snapshot.start
+    );
+}
+
+int
+Metrics_write(const char *filename, Metrics *metrics, long queue_depth)
+{
+    char name[METRICS_NAME_BUFFER_SIZE];
+    snprintf(name, sizeof name, "%s.tmp", filename);
+    FILE *out = fopen(name, "w");
+    if (out == NULL) {
+        return TUBE_FAILURE;
+    }
+    Metrics_fprint_prometheus(out, metrics, queue_depth);
+    if (fclose(out) != 0 || rename(name, filename) != 0) {
+        return TUBE_FAILURE;
+    }
+    return TUBE_SUCCESS;
+}
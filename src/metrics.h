@@ -0,0 +1,115 @@
+/** metrics.h
+ *
+ * Header for service metrics of 'tubes'. Metrics are counted on the request
+ * path of the daemon (outcomes, latency histogram, cache lookups, solver nodes
+ * and busy workers) and exported as snapshot in the Prometheus text format
+ * (e.g., for the textfile collector of the node exporter).
+ */
+
+#ifndef METRICS_H_INCLUDED
+#define METRICS_H_INCLUDED
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "gameinfo.h"
+
+/**
+ * Upper bounds of buckets of latency histogram in seconds (without +Inf).
+ */
+#define METRICS_NUM_BUCKETS 11
+
+/**
+ * Outcome of invalid request (in addition to the solver status enumerators).
+ */
+#define METRICS_ERROR (SOLVER_ABORTED + 1)
+
+/**
+ * Cache lookup enumerator.
+ */
+enum {
+    METRICS_CACHE_NONE, /* no cache (or no lookup) */
+    METRICS_CACHE_HIT,
+    METRICS_CACHE_MISS,
+};
+
+/**
+ * Struct for metrics of service (guarded by `mutex`).
+ */
+typedef struct {
+    long requests[METRICS_ERROR + 1];      /* requests by outcome */
+    long buckets[METRICS_NUM_BUCKETS + 1]; /* latencies per bucket (+Inf) */
+    double seconds;                        /* sum of latencies */
+    long cache_hits;
+    long cache_misses;
+    long nodes;         /* nodes expanded by solver */
+    int active_workers; /* workers busy with a request */
+    int num_workers;
+    double start; /* time of start in seconds */
+    pthread_mutex_t mutex;
+} Metrics;
+
+/**
+ * Initializes `metrics` for service with `num_workers` workers.
+ *
+ * @param[out] metrics Metrics to initialize
+ * @param[in] num_workers number of worker threads
+ */
+void
+Metrics_init(Metrics *metrics, int num_workers);
+
+/**
+ * Frees resources of `metrics`.
+ *
+ * @param[in] metrics Metrics to free
+ */
+void
+Metrics_free(Metrics *metrics);
+
+/**
+ * Marks worker as busy with a request.
+ *
+ * @param[in,out] metrics Metrics to update
+ */
+void
+Metrics_begin_request(Metrics *metrics);
+
+/**
+ * Marks worker as idle and counts finished request.
+ *
+ * @param[in,out] metrics Metrics to update
+ * @param[in] outcome solver status enumerator or METRICS_ERROR
+ * @param[in] seconds latency of request
+ * @param[in] nodes nodes expanded for request
+ * @param[in] cache cache lookup enumerator
+ */
+void
+Metrics_end_request(
+  Metrics *metrics, int outcome, double seconds, long nodes, int cache
+);
+
+/**
+ * Prints snapshot of `metrics` (and queue depth `queue_depth`) in the
+ * Prometheus text format to `out`.
+ *
+ * @param[in] out output FILE stream
+ * @param[in,out] metrics Metrics to print (locked while reading)
+ * @param[in] queue_depth number of queued requests
+ */
+void
+Metrics_fprint_prometheus(FILE *out, Metrics *metrics, long queue_depth);
+
+/**
+ * Replaces file `filename` by snapshot of `metrics` (via temporary file, so
+ * scrapers never see a partial snapshot).
+ *
+ * @param[in] filename name of metrics file
+ * @param[in,out] metrics Metrics to write
+ * @param[in] queue_depth number of queued requests
+ *
+ * @return Error code
+ */
+int
+Metrics_write(const char *filename, Metrics *metrics, long queue_depth);
+
+#endif /* METRICS_H_INCLUDED */
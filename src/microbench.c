@@ -0,0 +1,417 @@
+/** microbench.c
+ *
+ * 'tubes-microbench': measures the hot primitives of 'tubes' in isolation (tube
+ * kernels, action log, solved check and input parser) for several numbers of
+ * slots. Tube contents are taken from scrambled games, so they have realistic
+ * color runs and fill levels, and pour operands are random pairs of them.
+ *
+ * Every measurement runs a batch of operations several times and reports the
+ * fastest run as time and (on x86 with GCC or Clang) timestamp counter ticks
+ * per operation.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gameinfo.h"
+#include "input.h"
+#include "log.h"
+#include "rng.h"
+#include "tube.h"
+#include "util.h"
+
+#define MICRO_NUM_COLORS 8
+#define MICRO_NUM_EXTRA 2
+#define MICRO_NUM_SCRAMBLE 200
+#define MICRO_NUM_GAMES 64
+#define MICRO_NUM_OPS 65536
+#define DEFAULT_NUMBER_OF_RUNS 7
+
+/**
+ * Numbers of slots to measure (generic kernels are used above 8).
+ */
+static const int SLOTS[] = {3, 4, 6, 8, 12};
+
+/**
+ * Auxiliary struct for timing of one run of a batch.
+ */
+typedef struct {
+    double ns;
+    double ticks; /* negative if no timestamp counter */
+} MicroTime;
+
+/**
+ * Auxiliary struct for the data of all measurements of a number of slots.
+ */
+typedef struct {
+    int num_slots;
+    const TubeOps *ops;
+    GameInfo *games[MICRO_NUM_GAMES];
+    Tube **tubes; /* all tubes of all games */
+    int num_tubes;
+    int *i_src; /* random operands of pours */
+    int *i_dst;
+    int *results;
+    ColorChunk *chunks;
+    char *text; /* one game in input file format */
+    size_t text_len;
+} MicroData;
+
+/**
+ * Sink for results of measured functions (keeps them from being optimized
+ * away).
+ */
+static volatile long sink;
+
+/**
+ * Usage string.
+ */
+static const char *const usage
+  = "Usage: tubes-microbench [-r RUNS]\n"
+    "Measures cost per call of the tube kernels, the action log, the solved\n"
+    "check and the input parser of 'tubes' (fastest of RUNS runs, default\n"
+    "7). Slots 0 means independent of the number of slots.\n";
+
+/**
+ * Returns monotonic wall time in nanoseconds.
+ *
+ * @return Current time in nanoseconds
+ */
+static double
+_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * Returns timestamp counter (or 0 if not available).
+ *
+ * @return Current timestamp counter
+ */
+static uint64_t
+_ticks(void)
+{
+#if (defined(__GNUC__) || defined(__clang__))                                  \
+  && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Starts timing of a run.
+ *
+ * @param[out] time MicroTime to write start to
+ */
+static void
+_start(MicroTime *time)
+{
+    time->ticks = (double) _ticks();
+    time->ns = _now_ns();
+}
+
+/**
+ * Stops timing of a run of `num_ops` operations and keeps it in `best` if it
+ * is faster.
+ *
+ * @param[in] time MicroTime written by _start()
+ * @param[in] num_ops number of operations of run
+ * @param[in,out] best fastest MicroTime so far (per operation)
+ */
+static void
+_stop(const MicroTime *time, long num_ops, MicroTime *best)
+{
+    const double ns = (_now_ns() - time->ns) / num_ops;
+    const uint64_t ticks = _ticks();
+    if (best->ns < 0.0 || ns < best->ns) {
+        best->ns = ns;
+        best->ticks = (ticks == 0) ? -1.0 : (ticks - time->ticks) / num_ops;
+    }
+}
+
+/**
+ * Prints row of measurement `name` with `num_slots` slots and timing `best`.
+ *
+ * @param[in] name name of measurement
+ * @param[in] num_slots number of slots
+ * @param[in] best fastest MicroTime (per operation)
+ */
+static void
+_print_row(const char *name, int num_slots, const MicroTime *best)
+{
+    if (best->ticks < 0.0) {
+        printf("%-24s %5i %10.2f %10s\n", name, num_slots, best->ns, "-");
+    } else {
+        printf(
+          "%-24s %5i %10.2f %10.2f\n", name, num_slots, best->ns, best->ticks
+        );
+    }
+}
+
+/**
+ * Sets up data of measurements with `num_slots` slots.
+ *
+ * @param[out] data MicroData to initialize
+ * @param[in] num_slots number of slots
+ */
+static void
+MicroData_init(MicroData *data, int num_slots)
+{
+    data->num_slots = num_slots;
+    data->ops = TubeOps_get(num_slots);
+
+    const int num_tubes_game = MICRO_NUM_COLORS + MICRO_NUM_EXTRA;
+    data->num_tubes = MICRO_NUM_GAMES * num_tubes_game;
+    data->tubes = malloc(data->num_tubes * sizeof *data->tubes);
+    for (int i = 0; i < MICRO_NUM_GAMES; ++i) {
+        /* Every other game is solved (no scramble) for the solved check */
+        data->games[i] = GameInfo_create_from_scramble(
+          MICRO_NUM_COLORS, MICRO_NUM_EXTRA, num_slots, i + 1,
+          (i % 2 == 0) ? MICRO_NUM_SCRAMBLE : 0, NULL
+        );
+        for (int j = 0; j < num_tubes_game; ++j) {
+            data->tubes[i * num_tubes_game + j] = data->games[i]->tubes[j];
+        }
+    }
+
+    Rng rng;
+    Rng_seed(&rng, (uint64_t) num_slots);
+    data->i_src = malloc(MICRO_NUM_OPS * sizeof *data->i_src);
+    data->i_dst = malloc(MICRO_NUM_OPS * sizeof *data->i_dst);
+    data->results = malloc(MICRO_NUM_OPS * sizeof *data->results);
+    data->chunks = malloc(MICRO_NUM_OPS * sizeof *data->chunks);
+    const uint32_t bound = (uint32_t) data->num_tubes;
+    for (int i = 0; i < MICRO_NUM_OPS; ++i) {
+        data->i_src[i] = (int) Rng_below(&rng, bound);
+        do {
+            data->i_dst[i] = (int) Rng_below(&rng, bound);
+        } while (data->i_dst[i] == data->i_src[i]);
+    }
+
+    FILE *out = open_memstream(&data->text, &data->text_len);
+    GameInfo_fprint_raw(out, data->games[0]);
+    fclose(out);
+}
+
+/**
+ * Frees data of measurements.
+ *
+ * @param[in] data MicroData to free
+ */
+static void
+MicroData_free(MicroData *data)
+{
+    for (int i = 0; i < MICRO_NUM_GAMES; ++i) {
+        GameInfo_destroy(data->games[i]);
+    }
+    free(data->tubes);
+    free(data->i_src);
+    free(data->i_dst);
+    free(data->results);
+    free(data->chunks);
+    free(data->text);
+}
+
+/**
+ * Measures pouring (and reverting, which restores the tubes) of all random
+ * operands of `data` with kernels `pour` and `revert`.
+ *
+ * @param[in,out] data MicroData to measure on
+ * @param[in] pour pour kernel
+ * @param[in] revert revert kernel
+ * @param[in] num_runs number of runs
+ * @param[out] best_pour fastest MicroTime of pour
+ * @param[out] best_revert fastest MicroTime of revert
+ */
+static void
+_measure_pour(
+  MicroData *data, int (*pour)(Tube *, Tube *, ColorChunk *),
+  void (*revert)(Tube *, Tube *, const ColorChunk *), int num_runs,
+  MicroTime *best_pour, MicroTime *best_revert
+)
+{
+    Tube **const tubes = data->tubes;
+    best_pour->ns = best_revert->ns = -1.0;
+    for (int run = 0; run < num_runs; ++run) {
+        MicroTime time;
+        _start(&time);
+        for (int i = 0; i < MICRO_NUM_OPS; ++i) {
+            data->results[i] = pour(
+              tubes[data->i_src[i]], tubes[data->i_dst[i]], &data->chunks[i]
+            );
+        }
+        _stop(&time, MICRO_NUM_OPS, best_pour);
+
+        _start(&time);
+        for (int i = MICRO_NUM_OPS - 1; i >= 0; --i) {
+            if (data->results[i] == TUBE_SUCCESS) {
+                revert(
+                  tubes[data->i_src[i]], tubes[data->i_dst[i]],
+                  &data->chunks[i]
+                );
+            }
+        }
+        _stop(&time, MICRO_NUM_OPS, best_revert);
+    }
+}
+
+/**
+ * Measures predicate `check` on all tubes of `data`.
+ *
+ * @param[in] data MicroData to measure on
+ * @param[in] check tube predicate
+ * @param[in] num_runs number of runs
+ * @param[out] best fastest MicroTime
+ */
+static void
+_measure_check(
+  const MicroData *data, bool (*check)(const Tube *), int num_runs,
+  MicroTime *best
+)
+{
+    const long num_ops = (long) (MICRO_NUM_OPS / data->num_tubes)
+                         * data->num_tubes;
+    best->ns = -1.0;
+    for (int run = 0; run < num_runs; ++run) {
+        long count = 0;
+        MicroTime time;
+        _start(&time);
+        for (long i = 0; i < num_ops; ++i) {
+            count += check(data->tubes[i % data->num_tubes]);
+        }
+        _stop(&time, num_ops, best);
+        sink += count;
+    }
+}
+
+/**
+ * Runs all measurements with `num_slots` slots and prints them.
+ *
+ * @param[in] num_slots number of slots
+ * @param[in] num_runs number of runs per measurement
+ */
+static void
+_measure_slots(int num_slots, int num_runs)
+{
+    MicroData data;
+    MicroData_init(&data, num_slots);
+    MicroTime best;
+    MicroTime best_revert;
+
+    _measure_pour(
+      &data, Tube_pour, Tube_revert, num_runs, &best, &best_revert
+    );
+    _print_row("Tube_pour", num_slots, &best);
+    _print_row("Tube_revert", num_slots, &best_revert);
+    _measure_pour(
+      &data, data.ops->pour, data.ops->revert, num_runs, &best, &best_revert
+    );
+    _print_row("TubeOps.pour", num_slots, &best);
+    _print_row("TubeOps.revert", num_slots, &best_revert);
+
+    _measure_check(&data, Tube_is_pure, num_runs, &best);
+    _print_row("Tube_is_pure", num_slots, &best);
+    _measure_check(&data, data.ops->is_pure, num_runs, &best);
+    _print_row("TubeOps.is_pure", num_slots, &best);
+    _measure_check(&data, Tube_is_one_color, num_runs, &best);
+    _print_row("Tube_is_one_color", num_slots, &best);
+    _measure_check(&data, data.ops->is_one_color, num_runs, &best);
+    _print_row("TubeOps.is_one_color", num_slots, &best);
+
+    best.ns = -1.0;
+    for (int run = 0; run < num_runs; ++run) {
+        const int num_ops = MICRO_NUM_OPS / MICRO_NUM_GAMES * MICRO_NUM_GAMES;
+        long count = 0;
+        MicroTime time;
+        _start(&time);
+        for (int i = 0; i < num_ops; ++i) {
+            count += GameInfo_is_solved(data.games[i % MICRO_NUM_GAMES]);
+        }
+        _stop(&time, num_ops, &best);
+        sink += count;
+    }
+    _print_row("GameInfo_is_solved", num_slots, &best);
+
+    best.ns = -1.0;
+    const int num_parses = MICRO_NUM_OPS / 64;
+    for (int run = 0; run < num_runs; ++run) {
+        MicroTime time;
+        _start(&time);
+        for (int i = 0; i < num_parses; ++i) {
+            Input *input = Input_parse(data.text, data.text_len, NULL);
+            sink += input->num_tubes;
+            Input_destroy(input);
+        }
+        _stop(&time, num_parses, &best);
+    }
+    _print_row("Input_parse", num_slots, &best);
+    best.ns /= data.text_len;
+    best.ticks = (best.ticks < 0.0) ? best.ticks : best.ticks / data.text_len;
+    _print_row("Input_parse (per byte)", num_slots, &best);
+
+    MicroData_free(&data);
+}
+
+/**
+ * Measures pushing and popping `MICRO_NUM_OPS` actions of an ActionLog.
+ *
+ * @param[in] num_runs number of runs
+ */
+static void
+_measure_log(int num_runs)
+{
+    ActionLog *log = ActionLog_create();
+    const Action action = {.i_src = 1, .i_dst = 2, .chunk = {3, 1}};
+    MicroTime best_push = {.ns = -1.0};
+    MicroTime best_pop = {.ns = -1.0};
+    for (int run = 0; run < num_runs; ++run) {
+        MicroTime time;
+        _start(&time);
+        for (int i = 0; i < MICRO_NUM_OPS; ++i) {
+            ActionLog_push_back(log, &action);
+        }
+        _stop(&time, MICRO_NUM_OPS, &best_push);
+
+        Action popped = {0};
+        _start(&time);
+        for (int i = 0; i < MICRO_NUM_OPS; ++i) {
+            ActionLog_pop(log, &popped);
+        }
+        _stop(&time, MICRO_NUM_OPS, &best_pop);
+        sink += popped.i_src;
+    }
+    _print_row("ActionLog_push_back", 0, &best_push);
+    _print_row("ActionLog_pop", 0, &best_pop);
+    ActionLog_destroy(log);
+}
+
+int
+main(int argc, char **argv)
+{
+    int num_runs = DEFAULT_NUMBER_OF_RUNS;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            num_runs = atoi(argv[++i]);
+        } else {
+            ERROR("%s", usage);
+        }
+    }
+    if (num_runs < 1) {
+        ERROR("%s", usage);
+    }
+
+    printf("%-24s %5s %10s %10s\n", "primitive", "slots", "ns/op", "ticks/op");
+    _measure_log(num_runs);
+    for (size_t i = 0; i < sizeof SLOTS / sizeof *SLOTS; ++i) {
+        _measure_slots(SLOTS[i], num_runs);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+/** pack.c
+ *
+ * 'tubes-pack': converts corpora of 'tubes' between the text format (games
+ * separated by blank lines or headers) and the fixed-width binary format (see
+ * corpus.h). Invalid games abort the conversion, as do games of other
+ * dimensions than the first one when packing.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "corpus.h"
+#include "input.h"
+#include "util.h"
+
+#define NAME_BUFFER_SIZE 4096
+
+/**
+ * Usage string.
+ */
+static const char *const usage
+  = "Usage: tubes-pack [-u] -o OUTPUT CORPUS\n"
+    "Converts corpus of 'tubes' (text or binary) to the binary format (all\n"
+    "games of the same size), or to the text format with '-u' (unpack).\n";
+
+/**
+ * Reads game with index `index` of `corpus` and exits on error.
+ *
+ * @param[in] corpus Corpus to read from
+ * @param[in] index index of game
+ * @param[in] corpusname name of corpus (for error messages)
+ *
+ * @return newly malloc'd and initialized Input object
+ */
+static Input *
+_read_game(const Corpus *corpus, long index, const char *corpusname)
+{
+    InputError error;
+    Input *input = Corpus_read(corpus, index, &error);
+    if (input == NULL) {
+        char name[NAME_BUFFER_SIZE];
+        snprintf(name, sizeof name, "%s (game %li)", corpusname, index);
+        InputError_fprint(stderr, &error, name);
+        exit(EXIT_FAILURE);
+    }
+    return input;
+}
+
+/**
+ * Prints game `input` with index `index` to `out` in the text corpus format.
+ *
+ * @param[in] out output FILE stream
+ * @param[in] input Input to print
+ * @param[in] index index of game
+ */
+static void
+_fprint_game(FILE *out, const Input *input, long index)
+{
+    fprintf(out, "# game %li\n", index);
+    for (int i_tube = 0; i_tube < input->num_tubes; ++i_tube) {
+        const int *const row = &input->data[i_tube * input->num_slots];
+        for (int i_slot = 0; i_slot < input->num_slots; ++i_slot) {
+            fprintf(out, (i_slot == 0) ? "%i" : " %i", row[i_slot]);
+        }
+        fprintf(out, "\n");
+    }
+    fprintf(out, "\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    bool do_unpack = false;
+    const char *outname = NULL;
+    const char *corpusname = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-u") == 0) {
+            do_unpack = true;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outname = argv[++i];
+        } else if (argv[i][0] != '-' && corpusname == NULL) {
+            corpusname = argv[i];
+        } else {
+            ERROR("%s", usage);
+        }
+    }
+    if (outname == NULL || corpusname == NULL) {
+        ERROR("%s", usage);
+    }
+
+    Corpus *corpus = Corpus_open(corpusname);
+    if (corpus == NULL) {
+        ERROR("Could not open corpus '%s'!", corpusname);
+    }
+    FILE *out = fopen(outname, do_unpack ? "w" : "wb");
+    if (out == NULL) {
+        ERROR("Could not open output file '%s'!", outname);
+    }
+
+    if (do_unpack == true) {
+        for (long i = 0; i < corpus->num_games; ++i) {
+            Input *input = _read_game(corpus, i, corpusname);
+            _fprint_game(out, input, i);
+            Input_destroy(input);
+        }
+    } else {
+        CorpusWriter *writer = CorpusWriter_create(out);
+        for (long i = 0; i < corpus->num_games; ++i) {
+            Input *input = _read_game(corpus, i, corpusname);
+            if (CorpusWriter_add(writer, input) == TUBE_FAILURE) {
+                ERROR(
+                  "Game %li of '%s' is too large or not of the size of the "
+                  "first game!",
+                  i, corpusname
+                );
+            }
+            Input_destroy(input);
+        }
+        if (CorpusWriter_finish(writer) == TUBE_FAILURE) {
+            ERROR("Could not write corpus '%s'!", outname);
+        }
+    }
+
+    fclose(out);
+    fprintf(stderr, "Converted %li games.\n", corpus->num_games);
+    Corpus_close(corpus);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "profile.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alloc.h"
+#include "json.h"
+
+#define PROFILE_INITIAL_CAPACITY 64
+
+/**
+ * Returns time of clock `clock_id` in milliseconds.
+ *
+ * @param[in] clock_id clock to read
+ *
+ * @return Current time in milliseconds
+ */
+static double
+_clock_ms(clockid_t clock_id)
+{
+    struct timespec ts;
+    clock_gettime(clock_id, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+Profiler *
+Profiler_create(bool do_trace)
+{
+    Profiler *profiler = Alloc_calloc(ALLOC_PROFILE, 1, sizeof *profiler);
+
+    profiler->origin_ms = _clock_ms(CLOCK_MONOTONIC);
+    if (do_trace == true) {
+        profiler->capacity = PROFILE_INITIAL_CAPACITY;
+        profiler->events
+          = Alloc_malloc(
+            ALLOC_PROFILE, profiler->capacity * sizeof *profiler->events
+          );
+    }
+
+    return profiler;
+}
+
+void
+Profiler_destroy(Profiler *profiler)
+{
+    if (profiler == NULL) {
+        return;
+    }
+
+    Alloc_free(profiler->events);
+
+    Alloc_free(profiler);
+}
+
+ProfileSpan
+Profiler_begin(Profiler *profiler, const char *name)
+{
+    ProfileSpan span = {.i_phase = -1};
+    if (profiler == NULL) {
+        return span;
+    }
+
+    int i = 0;
+    for (; i < profiler->num_phases; ++i) {
+        if (strcmp(profiler->phases[i].name, name) == 0) {
+            break;
+        }
+    }
+    if (i == profiler->num_phases) {
+        if (i == PROFILE_MAX_PHASES) {
+            return span;
+        }
+        profiler->phases[i].name = name;
+        ++profiler->num_phases;
+    }
+
+    span.i_phase = i;
+    span.cpu_ms = _clock_ms(CLOCK_PROCESS_CPUTIME_ID);
+    span.wall_ms = _clock_ms(CLOCK_MONOTONIC);
+    return span;
+}
+
+void
+Profiler_end(Profiler *profiler, const ProfileSpan *span)
+{
+    if (profiler == NULL || span->i_phase < 0) {
+        return;
+    }
+    const double wall_ms = _clock_ms(CLOCK_MONOTONIC) - span->wall_ms;
+    const double cpu_ms = _clock_ms(CLOCK_PROCESS_CPUTIME_ID) - span->cpu_ms;
+
+    ProfilePhase *const phase = &profiler->phases[span->i_phase];
+    ++phase->count;
+    phase->wall_ms += wall_ms;
+    phase->cpu_ms += cpu_ms;
+
+    if (profiler->events == NULL) {
+        return;
+    }
+    if (profiler->num_events == profiler->capacity) {
+        profiler->capacity *= 2;
+        profiler->events = Alloc_realloc(
+          ALLOC_PROFILE, profiler->events,
+          profiler->capacity * sizeof *profiler->events
+        );
+    }
+    ProfileEvent *const event = &profiler->events[profiler->num_events++];
+    event->i_phase = span->i_phase;
+    event->start_us = (span->wall_ms - profiler->origin_ms) * 1e3;
+    event->dur_us = wall_ms * 1e3;
+}
+
+void
+Profiler_fprint_json(FILE *out, const Profiler *profiler)
+{
+    fprintf(out, "{\"phases\":[");
+    for (int i = 0; i < profiler->num_phases; ++i) {
+        const ProfilePhase *const phase = &profiler->phases[i];
+        fprintf(out, (i == 0) ? "{\"name\":" : ",{\"name\":");
+        Json_fprint_string(out, phase->name);
+        fprintf(
+          out, ",\"count\":%li,\"wall_ms\":%.3f,\"cpu_ms\":%.3f}", phase->count,
+          phase->wall_ms, phase->cpu_ms
+        );
+    }
+    fprintf(out, "]}\n");
+}
+
+void
+Profiler_fprint_trace(FILE *out, const Profiler *profiler)
+{
+    fprintf(out, "[\n");
+    for (long i = 0; i < profiler->num_events; ++i) {
+        const ProfileEvent *const event = &profiler->events[i];
+        fprintf(out, "{\"name\":");
+        Json_fprint_string(out, profiler->phases[event->i_phase].name);
+        fprintf(
+          out,
+          ",\"cat\":\"tubes\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+          "\"pid\":1,\"tid\":1}%s\n",
+          event->start_us, event->dur_us,
+          (i < profiler->num_events - 1) ? "," : ""
+        );
+    }
+    fprintf(out, "]\n");
+}
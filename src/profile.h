@@ -0,0 +1,118 @@
+/** profile.h
+ *
+ * Header for the lightweight timing layer of 'tubes'. A Profiler accumulates
+ * wall time (monotonic clock) and CPU time (process CPU clock) per named phase
+ * (e.g., "input_read", "solve") and can report them as JSON or as a trace in
+ * the Chrome trace event format (loadable by Perfetto and chrome://tracing).
+ *
+ * All functions accept a NULL Profiler and then do nothing, so instrumented
+ * code costs (almost) nothing unless profiling was requested. A Profiler must
+ * only be used by one thread at a time.
+ */
+
+#ifndef PROFILE_H_INCLUDED
+#define PROFILE_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define PROFILE_MAX_PHASES 16
+
+/**
+ * Struct for accumulated times of a phase.
+ */
+typedef struct {
+    const char *name; /* string literal */
+    long count;
+    double wall_ms;
+    double cpu_ms;
+} ProfilePhase;
+
+/**
+ * Auxiliary struct for a single trace event (one span of a phase).
+ */
+typedef struct {
+    int i_phase;
+    double start_us; /* relative to creation of Profiler */
+    double dur_us;
+} ProfileEvent;
+
+/**
+ * Struct for profiler.
+ */
+typedef struct {
+    ProfilePhase phases[PROFILE_MAX_PHASES];
+    int num_phases;
+    double origin_ms; /* monotonic wall time of creation */
+    ProfileEvent *events; /* NULL if not tracing */
+    long num_events;
+    long capacity;
+} Profiler;
+
+/**
+ * Struct for running span of a phase (see Profiler_begin()).
+ */
+typedef struct {
+    int i_phase; /* -1 if not profiling */
+    double wall_ms;
+    double cpu_ms;
+} ProfileSpan;
+
+/**
+ * Allocates and initializes Profiler object.
+ *
+ * @param[in] do_trace record individual spans for Profiler_fprint_trace()?
+ *
+ * @return Pointer to newly allocated Profiler object
+ */
+Profiler *
+Profiler_create(bool do_trace);
+
+/**
+ * Destroys `profiler` and frees memory.
+ *
+ * @param[in] profiler Profiler to be destroyed
+ */
+void
+Profiler_destroy(Profiler *profiler);
+
+/**
+ * Starts span of phase `name` (a string literal) of `profiler`.
+ *
+ * @param[in] profiler Profiler to record to (or NULL)
+ * @param[in] name name of phase
+ *
+ * @return Running ProfileSpan
+ */
+ProfileSpan
+Profiler_begin(Profiler *profiler, const char *name);
+
+/**
+ * Ends `span` of `profiler` and adds its times to its phase.
+ *
+ * @param[in] profiler Profiler to record to (or NULL)
+ * @param[in] span ProfileSpan returned by Profiler_begin()
+ */
+void
+Profiler_end(Profiler *profiler, const ProfileSpan *span);
+
+/**
+ * Prints times of all phases of `profiler` as single-line JSON object to `out`.
+ *
+ * @param[in] out output FILE stream
+ * @param[in] profiler Profiler to print
+ */
+void
+Profiler_fprint_json(FILE *out, const Profiler *profiler);
+
+/**
+ * Prints all recorded spans of `profiler` to `out` in the Chrome trace event
+ * format (JSON array of complete events).
+ *
+ * @param[in] out output FILE stream
+ * @param[in] profiler Profiler to print
+ */
+void
+Profiler_fprint_trace(FILE *out, const Profiler *profiler);
+
+#endif /* PROFILE_H_INCLUDED */
@@ -0,0 +1,136 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "progress.h"
+
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include "ticker.h"
+#include "util.h"
+
+#define PROGRESS_NAME_BUFFER_SIZE 4096
+
+/**
+ * Prints snapshot of progress of `reporter` as single-line JSON object to
+ * `out`.
+ *
+ * @param[in,out] reporter ProgressReporter to report
+ * @param[in] out output FILE stream
+ */
+static void
+ProgressReporter_fprint_json(ProgressReporter *reporter, FILE *out)
+{
+    SolverProgress snapshot;
+    SolverProgress_read(reporter->progress, &snapshot);
+    const double now = Ticker_now();
+    const double seconds = now - reporter->last_time;
+    const double nodes_per_sec
+      = (seconds > 0) ? (snapshot.nodes - reporter->last_nodes) / seconds : 0;
+    reporter->last_time = now;
+    reporter->last_nodes = snapshot.nodes;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    fprintf(
+      out,
+      "{\"elapsed\":%.3f,\"nodes\":%li,\"nodes_per_sec\":%.0f,\"depth\":%i,"
+      "\"best_bound\":%i,\"searches\":%li,\"visited\":%li,"
+      "\"peak_rss_kb\":%li}\n",
+      now - reporter->start, snapshot.nodes, nodes_per_sec, snapshot.depth,
+      snapshot.best_bound, snapshot.searches, snapshot.visited,
+      (long) usage.ru_maxrss
+    );
+    fflush(out);
+}
+
+/**
+ * Writes report of `reporter` to its status file (via temporary file, so
+ * readers never see a partial report) or to 'stderr'.
+ *
+ * @param[in,out] reporter ProgressReporter to report
+ */
+static void
+ProgressReporter_report(ProgressReporter *reporter)
+{
+    if (reporter->status_name == NULL) {
+        ProgressReporter_fprint_json(reporter, stderr);
+        return;
+    }
+    char name[PROGRESS_NAME_BUFFER_SIZE];
+    snprintf(name, sizeof name, "%s.tmp", reporter->status_name);
+    FILE *out = fopen(name, "w");
+    if (out == NULL) {
+        return;
+    }
+    ProgressReporter_fprint_json(reporter, out);
+    fclose(out);
+    rename(name, reporter->status_name);
+}
+
+/**
+ * Thread function: reports every interval until stopped.
+ *
+ * @param[in] arg pointer to ProgressReporter
+ *
+ * @return NULL
+ */
+static void *
+_reporter(void *arg)
+{
+    ProgressReporter *const reporter = arg;
+
+    pthread_mutex_lock(&reporter->mutex);
+    Ticker ticker;
+    Ticker_init(&ticker, reporter->interval);
+    while (reporter->is_stopped == false) {
+        Ticker_wait(
+          &ticker, &reporter->stop, &reporter->mutex, &reporter->is_stopped
+        );
+        ProgressReporter_report(reporter);
+    }
+    pthread_mutex_unlock(&reporter->mutex);
+
+    return NULL;
+}
+
+ProgressReporter *
+ProgressReporter_start(
+  const SolverProgress *progress, double interval, const char *status_name
+)
+{
+    ProgressReporter *reporter = malloc(sizeof *reporter);
+
+    reporter->progress = progress;
+    reporter->interval = interval;
+    reporter->status_name = status_name;
+    reporter->start = Ticker_now();
+    reporter->last_time = reporter->start;
+    reporter->last_nodes = 0;
+    reporter->is_stopped = false;
+    pthread_mutex_init(&reporter->mutex, NULL);
+    pthread_cond_init(&reporter->stop, NULL);
+    if (pthread_create(&reporter->thread, NULL, _reporter, reporter) != 0) {
+        ERROR("Could not create progress thread!");
+    }
+
+    return reporter;
+}
+
+void
+ProgressReporter_stop(ProgressReporter *reporter)
+{
+    if (reporter == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&reporter->mutex);
+    reporter->is_stopped = true;
+    pthread_cond_signal(&reporter->stop);
+    pthread_mutex_unlock(&reporter->mutex);
+    pthread_join(reporter->thread, NULL);
+
+    pthread_cond_destroy(&reporter->stop);
+    pthread_mutex_destroy(&reporter->mutex);
+
+    free(reporter);
+}
@@ -0,0 +1,59 @@
+/** progress.h
+ *
+ * Header for live progress reporting of 'tubes'. A ProgressReporter samples a
+ * SolverProgress (published by the solver, see solver.h) from a separate thread
+ * at a fixed interval and reports nodes, nodes per second, current depth, best
+ * lower bound on moves left and memory use as one JSON object per line, either
+ * to 'stderr' or to a status file (replaced atomically on every report). The
+ * search loop itself never waits for the reporter.
+ */
+
+#ifndef PROGRESS_H_INCLUDED
+#define PROGRESS_H_INCLUDED
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "solver.h"
+
+/**
+ * Struct for progress reporter.
+ */
+typedef struct {
+    const SolverProgress *progress;
+    double interval;          /* seconds between two reports */
+    const char *status_name;  /* status file to replace (or NULL for stderr) */
+    double start;             /* time of start in seconds */
+    double last_time;         /* time of last report */
+    long last_nodes;          /* nodes at last report */
+    bool is_stopped;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t stop;
+} ProgressReporter;
+
+/**
+ * Starts thread reporting `progress` every `interval` seconds to status file
+ * `status_name` (or to 'stderr' if NULL).
+ *
+ * @param[in] progress SolverProgress to sample (must outlive reporter)
+ * @param[in] interval seconds between two reports
+ * @param[in] status_name name of status file (or NULL)
+ *
+ * @return Pointer to newly allocated ProgressReporter object
+ */
+ProgressReporter *
+ProgressReporter_start(
+  const SolverProgress *progress, double interval, const char *status_name
+);
+
+/**
+ * Stops thread of `reporter` (after a final report) and frees memory.
+ *
+ * @param[in] reporter ProgressReporter to stop (or NULL)
+ */
+void
+ProgressReporter_stop(ProgressReporter *reporter);
+
+#endif /* PROGRESS_H_INCLUDED */
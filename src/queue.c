@@ -0,0 +1,85 @@
+#include "queue.h"
+
+#include <stdlib.h>
+
+Queue *
+Queue_create(int capacity)
+{
+    Queue *queue = malloc(sizeof *queue);
+
+    queue->capacity = capacity;
+    queue->items = malloc(capacity * sizeof *queue->items);
+    queue->head = 0;
+    queue->size = 0;
+    queue->is_closed = false;
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+
+    return queue;
+}
+
+void
+Queue_destroy(Queue *queue)
+{
+    if (queue == NULL) {
+        return;
+    }
+
+    pthread_cond_destroy(&queue->not_full);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_mutex_destroy(&queue->mutex);
+    free(queue->items);
+
+    free(queue);
+}
+
+void
+Queue_push(Queue *queue, void *item)
+{
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->size == queue->capacity) {
+        pthread_cond_wait(&queue->not_full, &queue->mutex);
+    }
+    const int tail = (queue->head + queue->size) % queue->capacity;
+    queue->items[tail] = item;
+    ++queue->size;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+void *
+Queue_pop(Queue *queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->size == 0 && queue->is_closed == false) {
+        pthread_cond_wait(&queue->not_empty, &queue->mutex);
+    }
+    void *item = NULL;
+    if (queue->size > 0) {
+        item = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        --queue->size;
+        pthread_cond_signal(&queue->not_full);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return item;
+}
+
+int
+Queue_size(Queue *queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+    const int size = queue->size;
+    pthread_mutex_unlock(&queue->mutex);
+    return size;
+}
+
+void
+Queue_close(Queue *queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+    queue->is_closed = true;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_mutex_unlock(&queue->mutex);
+}
@@ -0,0 +1,85 @@
+/** queue.h
+ *
+ * Header for bounded blocking queue of 'tubes'. Connects the stages of the
+ * multi-threaded pipelines (producers block if the queue is full, consumers if
+ * it is empty).
+ */
+
+#ifndef QUEUE_H_INCLUDED
+#define QUEUE_H_INCLUDED
+
+#include <pthread.h>
+#include <stdbool.h>
+
+/**
+ * Struct for bounded blocking queue (ring buffer of pointers).
+ */
+typedef struct {
+    void **items;
+    int capacity;
+    int head;
+    int size;
+    bool is_closed;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} Queue;
+
+/**
+ * Allocates and initializes empty Queue object holding at most `capacity`
+ * items.
+ *
+ * @param[in] capacity maximum number of items
+ *
+ * @return Pointer to newly allocated Queue object
+ */
+Queue *
+Queue_create(int capacity);
+
+/**
+ * Destroys `queue` and frees memory (but not the items left in it).
+ *
+ * @param[in] queue Queue to be destroyed
+ */
+void
+Queue_destroy(Queue *queue);
+
+/**
+ * Appends `item` to `queue`. Blocks while `queue` is full.
+ *
+ * @param[in] queue Queue to push to
+ * @param[in] item item to push (must not be NULL)
+ */
+void
+Queue_push(Queue *queue, void *item);
+
+/**
+ * Removes and returns first item of `queue`. Blocks while `queue` is empty and
+ * not closed.
+ *
+ * @param[in] queue Queue to pop from
+ *
+ * @return First item or NULL if `queue` is closed and empty
+ */
+void *
+Queue_pop(Queue *queue);
+
+/**
+ * Returns number of items currently in `queue`.
+ *
+ * @param[in] queue Queue to inspect
+ *
+ * @return Number of items
+ */
+int
+Queue_size(Queue *queue);
+
+/**
+ * Closes `queue`, i.e., signals consumers that no more items will be pushed.
+ *
+ * @param[in] queue Queue to be closed
+ */
+void
+Queue_close(Queue *queue);
+
+#endif /* QUEUE_H_INCLUDED */
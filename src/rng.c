@@ -0,0 +1,93 @@
+#include "rng.h"
+
+/**
+ * Rotates `x` left by `k` bits.
+ *
+ * @param[in] x value to rotate
+ * @param[in] k number of bits to rotate by
+ *
+ * @return Rotated value
+ */
+static inline uint64_t
+_rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+uint64_t
+Rng_mix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+void
+Rng_seed(Rng *rng, uint64_t seed)
+{
+    for (int i = 0; i < 4; ++i) {
+        seed = Rng_mix64(seed);
+        rng->s[i] = seed;
+    }
+}
+
+uint64_t
+Rng_next(Rng *rng)
+{
+    uint64_t *const s = rng->s;
+    const uint64_t res = _rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = _rotl(s[3], 45);
+    return res;
+}
+
+/**
+ * Lemire's "nearly divisionless" method: multiply instead of modulo and only
+ * reject in the (rare) biased region.
+ */
+uint32_t
+Rng_below(Rng *rng, uint32_t bound)
+{
+    uint64_t m = (Rng_next(rng) >> 32) * bound;
+    uint32_t low = (uint32_t) m;
+    if (low < bound) {
+        const uint32_t threshold = -bound % bound;
+        while (low < threshold) {
+            m = (Rng_next(rng) >> 32) * bound;
+            low = (uint32_t) m;
+        }
+    }
+    return (uint32_t) (m >> 32);
+}
+
+void
+Rng_jump(Rng *rng)
+{
+    static const uint64_t JUMP[] = {
+      0x180ec6d33cfd0aba,
+      0xd5a61266f0c9392c,
+      0xa9582618e03fc9aa,
+      0x39abdc4529b1661c,
+    };
+
+    uint64_t s[4] = {0};
+    for (int i = 0; i < 4; ++i) {
+        for (int b = 0; b < 64; ++b) {
+            if (JUMP[i] & ((uint64_t) 1 << b)) {
+                for (int j = 0; j < 4; ++j) {
+                    s[j] ^= rng->s[j];
+                }
+            }
+            Rng_next(rng);
+        }
+    }
+    for (int j = 0; j < 4; ++j) {
+        rng->s[j] = s[j];
+    }
+}
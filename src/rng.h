@@ -0,0 +1,72 @@
+/** rng.h
+ *
+ * Header for reentrant pseudo random number generator of 'tubes'. This is
+ * xoshiro256** by D. Blackman and S. Vigna, seeded via splitmix64. In contrast
+ * to rand(), all state lives in the Rng object, so it is thread-safe as long as
+ * every thread uses its own object.
+ */
+
+#ifndef RNG_H_INCLUDED
+#define RNG_H_INCLUDED
+
+#include <stdint.h>
+
+/**
+ * Struct for state of random number generator.
+ */
+typedef struct {
+    uint64_t s[4];
+} Rng;
+
+/**
+ * Scrambles `x` with the splitmix64 finalizer. Useful as cheap hash function
+ * (e.g., to combine seeds).
+ *
+ * @param[in] x value to scramble
+ *
+ * @return Scrambled value
+ */
+uint64_t
+Rng_mix64(uint64_t x);
+
+/**
+ * (Re-)initializes `rng` from `seed`. Equal seeds yield equal sequences.
+ *
+ * @param[out] rng Rng to initialize
+ * @param[in] seed seed for random number generator
+ */
+void
+Rng_seed(Rng *rng, uint64_t seed);
+
+/**
+ * Returns next 64 bit random number of `rng`.
+ *
+ * @param[in,out] rng Rng to draw from
+ *
+ * @return Random number
+ */
+uint64_t
+Rng_next(Rng *rng);
+
+/**
+ * Returns uniformly distributed random number in [0, `bound`) (without modulo
+ * bias). `bound` must be positive.
+ *
+ * @param[in,out] rng Rng to draw from
+ * @param[in] bound exclusive upper bound
+ *
+ * @return Random number below `bound`
+ */
+uint32_t
+Rng_below(Rng *rng, uint32_t bound);
+
+/**
+ * Advances `rng` by 2^128 steps. Calling this repeatedly on copies yields
+ * non-overlapping streams (e.g., one per thread).
+ *
+ * @param[in,out] rng Rng to advance
+ */
+void
+Rng_jump(Rng *rng);
+
+#endif /* RNG_H_INCLUDED */
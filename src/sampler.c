@@ -0,0 +1,284 @@
+#include "sampler.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "bulk.h"
+#include "log.h"
+#include "rng.h"
+#include "solver.h"
+#include "util.h"
+
+/**
+ * Auxiliary struct for outcome of one distinct board after a move.
+ */
+typedef struct {
+    uint64_t hash; /* hash of board (0 for empty entry) */
+    int status;    /* solver status enumerator */
+} SampleOutcome;
+
+/**
+ * Auxiliary struct for shared state of determinization solver (all fields
+ * from `next` on are guarded by `mutex`).
+ */
+typedef struct {
+    const GameInfo *info;
+    const SamplerOptions *opts;
+    int *moves;             /* candidate moves (i_src * num_tubes + i_dst) */
+    int num_moves;
+    DeadTable *dead;        /* boards proven unsolvable (shared by threads) */
+    int next;               /* index of next determinization */
+    Rng rng;                /* stream of next determinization */
+    SampleOutcome *table;   /* outcomes by hash (open addressing) */
+    long capacity;          /* capacity of table (power of 2) */
+    int *scores;            /* per candidate move */
+    SamplerResult *result;
+    pthread_mutex_t mutex;
+} Sampler;
+
+/**
+ * Returns entry of board with hash `hash` in table of `sampler` (which must be
+ * locked): either its outcome or the empty entry to store it in.
+ *
+ * @param[in] sampler Sampler to look up
+ * @param[in] hash hash of board
+ *
+ * @return Pointer to entry
+ */
+static SampleOutcome *
+Sampler_find(Sampler *sampler, uint64_t hash)
+{
+    long i = (long) (hash & (sampler->capacity - 1));
+    while (sampler->table[i].hash != 0 && sampler->table[i].hash != hash) {
+        i = (i + 1) & (sampler->capacity - 1);
+    }
+    return &sampler->table[i];
+}
+
+/**
+ * Collects the candidate moves of the board of `sampler`: those whose source
+ * is not empty and whose destination has a free slot and an equal (or no)
+ * topmost color. Only the topmost slots are read, which are visible in every
+ * consistent determinization, so a move legal in one of them is a candidate.
+ *
+ * @param[in,out] sampler Sampler to collect candidate moves of
+ */
+static void
+Sampler_collect_moves(Sampler *sampler)
+{
+    const GameInfo *const info = sampler->info;
+    sampler->moves = malloc(
+      (size_t) info->num_tubes * info->num_tubes * sizeof *sampler->moves
+    );
+    sampler->num_moves = 0;
+    for (int i_src = 0; i_src < info->num_tubes; ++i_src) {
+        const Tube *const tube_src = info->tubes[i_src];
+        const int i_top_src
+          = tube_src->num_slots - Tube_count_free(tube_src) - 1;
+        if (i_top_src < 0 || tube_src->slots[i_top_src].is_hidden == true) {
+            continue;
+        }
+        for (int i_dst = 0; i_dst < info->num_tubes; ++i_dst) {
+            const Tube *const tube_dst = info->tubes[i_dst];
+            const int i_top_dst
+              = tube_dst->num_slots - Tube_count_free(tube_dst) - 1;
+            if (i_dst == i_src || i_top_dst == tube_dst->num_slots - 1) {
+                continue;
+            }
+            if (i_top_dst < 0
+                || tube_dst->slots[i_top_dst].color
+                     == tube_src->slots[i_top_src].color) {
+                sampler->moves[sampler->num_moves++]
+                  = i_src * info->num_tubes + i_dst;
+            }
+        }
+    }
+}
+
+/**
+ * Returns outcome of board `sample`, which is solved unless `sampler` (which
+ * is locked only for the lookup and store) knows it already.
+ *
+ * @param[in,out] sampler Sampler to look up and store outcome in
+ * @param[in,out] sample board to solve (same state afterwards)
+ * @param[in,out] ctx SolverContext to solve with
+ * @param[in,out] log ActionLog to solve with
+ *
+ * @return Solver status enumerator
+ */
+static int
+Sampler_solve(
+  Sampler *sampler, GameInfo *sample, SolverContext *ctx, ActionLog *log
+)
+{
+    const SolverLimits limits = {.max_nodes = sampler->opts->max_nodes};
+    const uint64_t hash = GameInfo_hash(sample);
+    pthread_mutex_lock(&sampler->mutex);
+    const SampleOutcome *entry = Sampler_find(sampler, hash);
+    const int known = (entry->hash != 0) ? entry->status : -1;
+    pthread_mutex_unlock(&sampler->mutex);
+    if (known >= 0) {
+        return known;
+    }
+
+    const int status = GameInfo_find_solution(sample, ctx, log, &limits, NULL);
+    if (status == SOLVER_SOLVED) {
+        GameInfo_revert_all(sample, log);
+    }
+
+    pthread_mutex_lock(&sampler->mutex);
+    SampleOutcome *slot = Sampler_find(sampler, hash);
+    if (slot->hash == 0) {
+        *slot = (SampleOutcome){.hash = hash, .status = status};
+        ++sampler->result->num_distinct;
+    }
+    pthread_mutex_unlock(&sampler->mutex);
+    return status;
+}
+
+/**
+ * Thread function: scores the candidate moves of determinizations until all
+ * are done. Each thread reuses one SolverContext for all its searches.
+ *
+ * @param[in] arg pointer to Sampler
+ *
+ * @return NULL
+ */
+static void *
+_worker(void *arg)
+{
+    Sampler *const sampler = arg;
+    const GameInfo *const info = sampler->info;
+    SolverContext *ctx = SolverContext_create();
+    GameInfo *sample = GameInfo_copy(info);
+    ActionLog *log = ActionLog_create();
+    bool *is_solvable = malloc(sampler->num_moves * sizeof *is_solvable);
+    ctx->dead = sampler->dead;
+
+    for (;;) {
+        /* Every determinization draws from its own non-overlapping stream */
+        pthread_mutex_lock(&sampler->mutex);
+        const int i_sample = sampler->next++;
+        Rng rng = sampler->rng;
+        Rng_jump(&sampler->rng);
+        pthread_mutex_unlock(&sampler->mutex);
+        if (i_sample >= sampler->opts->num_samples) {
+            break;
+        }
+
+        if (GameInfo_determinize(info, sample, &rng) != TUBE_SUCCESS) {
+            pthread_mutex_lock(&sampler->mutex);
+            ++sampler->result->num_skipped;
+            pthread_mutex_unlock(&sampler->mutex);
+            continue;
+        }
+        bool is_any_solvable = false;
+        bool is_all_unsolvable = true;
+        for (int i = 0; i < sampler->num_moves; ++i) {
+            const int i_src = sampler->moves[i] / info->num_tubes;
+            const int i_dst = sampler->moves[i] % info->num_tubes;
+            Tube *const tube_src = sample->tubes[i_src];
+            Tube *const tube_dst = sample->tubes[i_dst];
+            ColorChunk chunk;
+            is_solvable[i] = false;
+            /* Pouring a whole tube into an empty one changes nothing */
+            if (Tube_count_free(tube_dst) == tube_dst->num_slots
+                && sample->ops->is_one_color(tube_src) == true) {
+                continue;
+            }
+            if (sample->ops->pour(tube_src, tube_dst, &chunk)
+                != TUBE_SUCCESS) {
+                continue;
+            }
+            const int status = Sampler_solve(sampler, sample, ctx, log);
+            sample->ops->revert(tube_src, tube_dst, &chunk);
+            is_solvable[i] = status == SOLVER_SOLVED;
+            is_any_solvable |= is_solvable[i];
+            is_all_unsolvable &= status == SOLVER_UNSOLVED;
+        }
+
+        pthread_mutex_lock(&sampler->mutex);
+        for (int i = 0; i < sampler->num_moves; ++i) {
+            sampler->scores[i] += is_solvable[i];
+        }
+        if (is_any_solvable == true) {
+            ++sampler->result->num_solved;
+        } else if (is_all_unsolvable == true) {
+            ++sampler->result->num_unsolved;
+        }
+        pthread_mutex_unlock(&sampler->mutex);
+    }
+
+    free(is_solvable);
+    ActionLog_destroy(log);
+    GameInfo_destroy(sample);
+    SolverContext_destroy(ctx);
+    return NULL;
+}
+
+int
+Sampler_best_move(
+  const GameInfo *info, const SamplerOptions *opts, SamplerResult *result
+)
+{
+    *result
+      = (SamplerResult){.status = HINT_ABORTED, .i_src = -1, .i_dst = -1};
+
+    Sampler sampler = {
+      .info = info,
+      .opts = opts,
+      .dead = DeadTable_create(),
+      .next = 0,
+      .capacity = 1,
+      .result = result,
+    };
+    Rng_seed(&sampler.rng, opts->seed);
+    Sampler_collect_moves(&sampler);
+    while (sampler.capacity < 2L * opts->num_samples * sampler.num_moves) {
+        sampler.capacity <<= 1;
+    }
+    sampler.table = calloc(sampler.capacity, sizeof *sampler.table);
+    sampler.scores = calloc(sampler.num_moves, sizeof *sampler.scores);
+    pthread_mutex_init(&sampler.mutex, NULL);
+
+    int num_threads = opts->num_threads;
+    if (num_threads <= 0) {
+        num_threads = Bulk_num_cores();
+    }
+    if (num_threads > opts->num_samples) {
+        num_threads = (opts->num_samples > 0) ? opts->num_samples : 1;
+    }
+    pthread_t *workers = malloc(num_threads * sizeof *workers);
+    for (int i = 0; i < num_threads; ++i) {
+        if (pthread_create(&workers[i], NULL, &_worker, &sampler) != 0) {
+            ERROR("Could not create sampler thread!");
+        }
+    }
+    for (int i = 0; i < num_threads; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+
+    for (int i = 0; i < sampler.num_moves; ++i) {
+        if (sampler.scores[i] > result->score) {
+            result->score = sampler.scores[i];
+            result->i_src = sampler.moves[i] / info->num_tubes;
+            result->i_dst = sampler.moves[i] % info->num_tubes;
+        }
+    }
+    const int num_drawn = opts->num_samples - result->num_skipped;
+    if (result->score > 0) {
+        result->status = HINT_MOVE;
+    } else if (num_drawn > 0 && result->num_unsolved == num_drawn) {
+        result->status = HINT_UNSOLVED;
+    }
+
+    pthread_mutex_destroy(&sampler.mutex);
+    DeadTable_destroy(sampler.dead);
+    free(sampler.table);
+    free(sampler.scores);
+    free(sampler.moves);
+    const bool is_valid = opts->num_samples == 0 || num_drawn > 0;
+    return (is_valid == true) ? TUBE_SUCCESS : TUBE_FAILURE;
+}
@@ -0,0 +1,64 @@
+/** sampler.h
+ *
+ * Header for the determinization solver of 'tubes' (for boards with hidden
+ * slots). It samples many assignments of the hidden colors that are consistent
+ * with the visible slots (see GameInfo_determinize()) and, in parallel, solves
+ * the board after every legal move of each of them. The move after which most
+ * determinizations are still solvable wins. Identical boards (common with few
+ * hidden slots) are solved only once: all threads share one table of outcomes
+ * keyed by the board after the move, and one DeadTable.
+ */
+
+#ifndef SAMPLER_H_INCLUDED
+#define SAMPLER_H_INCLUDED
+
+#include <stdint.h>
+
+#include "gameinfo.h"
+
+#define SAMPLER_DEFAULT_SAMPLES 1000
+
+/**
+ * Struct for options of determinization solver.
+ */
+typedef struct {
+    int num_samples; /* number of determinizations */
+    int num_threads; /* non-positive for number of cores */
+    long max_nodes;  /* node limit per determinization */
+    uint64_t seed;   /* seed of streams of determinizations */
+} SamplerOptions;
+
+/**
+ * Struct for outcome of determinization solver.
+ */
+typedef struct {
+    int status;       /* hint status enumerator */
+    int i_src;        /* most robust move (if status is HINT_MOVE) */
+    int i_dst;
+    int score;        /* determinizations still solvable after this move */
+    int num_solved;   /* determinizations solved at all */
+    int num_unsolved; /* determinizations proven unsolvable */
+    int num_skipped;  /* determinizations that could not be drawn */
+    int num_distinct; /* distinct boards solved */
+} SamplerResult;
+
+/**
+ * Picks most robust next move for board of `info` (whose hidden slots are not
+ * read) by solving the moves of `opts->num_samples` determinizations in
+ * parallel. A determinization that cannot be drawn is skipped. Status is
+ * HINT_UNSOLVED if every drawn determinization is unsolvable and HINT_ABORTED
+ * if none was solved otherwise.
+ *
+ * @param[in] info GameInfo object to pick move for
+ * @param[in] opts SamplerOptions to use
+ * @param[out] result SamplerResult to write outcome to
+ *
+ * @return Error code (failure if no determinization could be drawn, e.g., since
+ *         the visible colors do not fit a full game)
+ */
+int
+Sampler_best_move(
+  const GameInfo *info, const SamplerOptions *opts, SamplerResult *result
+);
+
+#endif /* SAMPLER_H_INCLUDED */
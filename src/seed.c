@@ -1,15 +1,16 @@
 #include "seed.h"
 
-#include <stdlib.h>
+#include <stdint.h>
 #include <time.h>
 
+#include "rng.h"
+
 unsigned int
 get_seed(void)
 {
-    srand(time(NULL));
-    size_t hash1 = (size_t) rand();
-    srand(clock());
-    size_t hash2 = (size_t) rand();
-    hash1 += 0x9e3779b9 + (hash2 << 6) + (hash2 >> 2);
-    return (unsigned int) (hash2 ^ hash1);
+    const uint64_t hash1 = Rng_mix64((uint64_t) time(NULL));
+    const uint64_t hash2 = Rng_mix64((uint64_t) clock());
+    const uint64_t hash
+      = hash1 ^ (hash2 + 0x9e3779b9 + (hash1 << 6) + (hash1 >> 2));
+    return (unsigned int) (hash ^ (hash >> 32));
 }
@@ -7,9 +7,9 @@
 #define SEED_H_INCLUDED
 
 /**
- * Creates "hashes" (i.e., size_t) from time() and clock() and uses
- * boost::hash_combine() to create random number. I didn't check, however, if
- * this is actually a good choice. Could be total horseshit...
+ * Creates hashes from time() and clock() (scrambled with splitmix64) and uses
+ * boost::hash_combine() to create random number. Does not touch the global
+ * state of rand().
  *
  * If we were on C11, we could use timespec.tv_nsec. But I hate myself and so we
  * aren't...
@@ -0,0 +1,233 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "segment.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "util.h"
+
+#define IDSET_INITIAL_CAPACITY 1024
+
+IdSet *
+IdSet_create(void)
+{
+    IdSet *set = malloc(sizeof *set);
+
+    set->capacity = IDSET_INITIAL_CAPACITY;
+    set->bits = calloc(set->capacity / 8, sizeof *set->bits);
+
+    return set;
+}
+
+void
+IdSet_destroy(IdSet *set)
+{
+    if (set == NULL) {
+        return;
+    }
+
+    free(set->bits);
+
+    free(set);
+}
+
+void
+IdSet_insert(IdSet *set, long id)
+{
+    if (id >= set->capacity) {
+        long capacity = set->capacity;
+        while (id >= capacity) {
+            capacity *= 2;
+        }
+        set->bits = realloc(set->bits, capacity / 8);
+        memset(
+          set->bits + set->capacity / 8, 0, (capacity - set->capacity) / 8
+        );
+        set->capacity = capacity;
+    }
+    set->bits[id / 8] |= (unsigned char) (1u << (id % 8));
+}
+
+bool
+IdSet_contains(const IdSet *set, long id)
+{
+    if (id < 0 || id >= set->capacity) {
+        return false;
+    }
+    return (set->bits[id / 8] & (1u << (id % 8))) != 0;
+}
+
+/**
+ * Bitwise implementation (records are short, so a table does not pay off).
+ */
+uint32_t
+Segment_crc32(const char *data, size_t len)
+{
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= (unsigned char) data[i];
+        for (int k = 0; k < 8; ++k) {
+            crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1));
+        }
+    }
+    return crc ^ 0xffffffffu;
+}
+
+char *
+Segment_filename(const char *dir, int shard_index, int num_shards)
+{
+    const char *const fmt = "%s/shard-%i-of-%i.seg";
+    const int len = snprintf(NULL, 0, fmt, dir, shard_index, num_shards);
+    char *filename = malloc(len + 1);
+    snprintf(filename, len + 1, fmt, dir, shard_index, num_shards);
+    return filename;
+}
+
+/**
+ * Strips trailing newline of `line` of length `len`.
+ *
+ * @param[in,out] line line to strip
+ * @param[in] len length of line
+ *
+ * @return Was there a newline (i.e., is the line complete)?
+ */
+static bool
+_strip_newline(char *line, size_t len)
+{
+    if (len == 0 || line[len - 1] != '\n') {
+        return false;
+    }
+    line[len - 1] = '\0';
+    return true;
+}
+
+int
+Segment_parse_header(
+  char *line, int *p_shard_index, int *p_num_shards, const char **p_desc
+)
+{
+    const size_t len = strlen(line);
+    _strip_newline(line, len);
+    const size_t magic_len = strlen(SEGMENT_MAGIC);
+    if (strncmp(line, SEGMENT_MAGIC, magic_len) != 0) {
+        return TUBE_FAILURE;
+    }
+    int offset = 0;
+    if (sscanf(
+          line + magic_len, " shard=%i/%i %n", p_shard_index, p_num_shards,
+          &offset
+        )
+          != 2
+        || offset == 0) {
+        return TUBE_FAILURE;
+    }
+    *p_desc = line + magic_len + offset;
+    return TUBE_SUCCESS;
+}
+
+int
+Segment_parse_line(char *line, size_t len, const char **p_record, long *p_id)
+{
+    if (_strip_newline(line, len) == false || len < 10 || line[8] != ' ') {
+        return TUBE_FAILURE;
+    }
+    char *end;
+    const uint32_t crc = (uint32_t) strtoul(line, &end, 16);
+    if (end != line + 8) {
+        return TUBE_FAILURE;
+    }
+    const char *const record = line + 9;
+    if (Segment_crc32(record, len - 10) != crc) {
+        return TUBE_FAILURE;
+    }
+    const char *const key = "{\"id\":";
+    if (strncmp(record, key, strlen(key)) != 0) {
+        return TUBE_FAILURE;
+    }
+    *p_id = strtol(record + strlen(key), NULL, 10);
+    *p_record = record;
+    return TUBE_SUCCESS;
+}
+
+/**
+ * Reads existing segment `in`, inserts ids of valid records into `done` and
+ * returns offset after last valid record.
+ *
+ * @param[in] in input FILE stream (after header)
+ * @param[out] done IdSet to insert ids into
+ *
+ * @return Offset after last valid record
+ */
+static long
+_read_records(FILE *in, IdSet *done)
+{
+    long offset = ftell(in);
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t len;
+    while ((len = getline(&line, &capacity, in)) > 0) {
+        const char *record;
+        long id;
+        if (Segment_parse_line(line, (size_t) len, &record, &id)
+            == TUBE_FAILURE) {
+            break;
+        }
+        IdSet_insert(done, id);
+        offset += len;
+    }
+    free(line);
+    return offset;
+}
+
+FILE *
+Segment_open(
+  const char *filename, int shard_index, int num_shards, const char *desc,
+  IdSet *done
+)
+{
+    FILE *in = fopen(filename, "r");
+    if (in == NULL) {
+        FILE *out = fopen(filename, "w");
+        if (out == NULL) {
+            return NULL;
+        }
+        fprintf(
+          out, "%s shard=%i/%i %s\n", SEGMENT_MAGIC, shard_index, num_shards,
+          desc
+        );
+        fflush(out);
+        return out;
+    }
+
+    char *line = NULL;
+    size_t capacity = 0;
+    int file_index, file_num;
+    const char *file_desc;
+    if (getline(&line, &capacity, in) <= 0
+        || Segment_parse_header(line, &file_index, &file_num, &file_desc)
+             == TUBE_FAILURE
+        || file_index != shard_index || file_num != num_shards
+        || strcmp(file_desc, desc) != 0) {
+        free(line);
+        fclose(in);
+        return NULL;
+    }
+    free(line);
+    const long offset = _read_records(in, done);
+    fclose(in);
+
+    /* Cut off torn or corrupt tail */
+    if (truncate(filename, offset) != 0) {
+        return NULL;
+    }
+    return fopen(filename, "a");
+}
+
+void
+Segment_write_record(FILE *out, const char *record, size_t len)
+{
+    const unsigned long crc = Segment_crc32(record, len);
+    fprintf(out, "%08lx %.*s\n", crc, (int) len, record);
+}
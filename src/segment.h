@@ -0,0 +1,149 @@
+/** segment.h
+ *
+ * Header for result segments of sharded batch runs of 'tubes'. A segment is a
+ * text file starting with a self-describing header line followed by one record
+ * per line, each prefixed by its CRC-32. Partially written segments (e.g.,
+ * after a crash) can be resumed, and 'tubes-merge' combines the segments of
+ * all shards into one sorted result.
+ */
+
+#ifndef SEGMENT_H_INCLUDED
+#define SEGMENT_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define SEGMENT_MAGIC "# tubes-segment v1"
+
+/**
+ * Struct for set of non-negative ids (bitset).
+ */
+typedef struct {
+    unsigned char *bits;
+    long capacity;
+} IdSet;
+
+/**
+ * Allocates and initializes empty IdSet object.
+ *
+ * @return Pointer to newly allocated IdSet object
+ */
+IdSet *
+IdSet_create(void);
+
+/**
+ * Destroys `set` and frees memory.
+ *
+ * @param[in] set IdSet to be destroyed
+ */
+void
+IdSet_destroy(IdSet *set);
+
+/**
+ * Inserts `id` into `set` (and potentially increases capacity).
+ *
+ * @param[in] set IdSet to insert into
+ * @param[in] id id to insert
+ */
+void
+IdSet_insert(IdSet *set, long id);
+
+/**
+ * Returns if `set` contains `id`.
+ *
+ * @param[in] set IdSet to check
+ * @param[in] id id to look for
+ *
+ * @return Does `set` contain `id`?
+ */
+bool
+IdSet_contains(const IdSet *set, long id);
+
+/**
+ * Computes CRC-32 (IEEE) of `len` bytes of `data`.
+ *
+ * @param[in] data pointer to data
+ * @param[in] len number of bytes
+ *
+ * @return CRC-32 of data
+ */
+uint32_t
+Segment_crc32(const char *data, size_t len);
+
+/**
+ * Returns standardized filename of segment of shard `shard_index` of
+ * `num_shards` in directory `dir`.
+ *
+ * @param[in] dir directory of segments
+ * @param[in] shard_index index of shard
+ * @param[in] num_shards number of shards
+ *
+ * @return Newly allocated filename
+ */
+char *
+Segment_filename(const char *dir, int shard_index, int num_shards);
+
+/**
+ * Opens segment `filename` for appending records. If it already exists, its
+ * header must match `shard_index`, `num_shards` and `desc`; all ids of valid
+ * records are inserted into `done`, and everything after the last valid record
+ * (e.g., a torn line) is cut off. Otherwise, the segment is created with a new
+ * header.
+ *
+ * @param[in] filename name of segment file
+ * @param[in] shard_index index of shard
+ * @param[in] num_shards number of shards
+ * @param[in] desc description of run (must not contain newlines)
+ * @param[out] done IdSet to insert ids of existing records into
+ *
+ * @return FILE stream to append to or NULL on error (e.g., header mismatch)
+ */
+FILE *
+Segment_open(
+  const char *filename, int shard_index, int num_shards, const char *desc,
+  IdSet *done
+);
+
+/**
+ * Writes `record` (of length `len`, without newline) with checksum to `out`.
+ *
+ * @param[in] out output FILE stream
+ * @param[in] record record to write
+ * @param[in] len length of record
+ */
+void
+Segment_write_record(FILE *out, const char *record, size_t len);
+
+/**
+ * Checks checksum of line `line` (of length `len`, newline included) and
+ * extracts record (without newline) and its id.
+ *
+ * @param[in,out] line line to check (newline is replaced by '\0')
+ * @param[in] len length of line
+ * @param[out] p_record pointer to record within `line`
+ * @param[out] p_id pointer to id of record
+ *
+ * @return Error code
+ */
+int
+Segment_parse_line(char *line, size_t len, const char **p_record, long *p_id);
+
+/**
+ * Parses header line `line` into shard index, number of shards and
+ * description (pointer into `line`, without newline).
+ *
+ * @param[in,out] line header line (newline is replaced by '\0')
+ * @param[out] p_shard_index pointer to index of shard
+ * @param[out] p_num_shards pointer to number of shards
+ * @param[out] p_desc pointer to description of run
+ *
+ * @return Error code
+ */
+int
+Segment_parse_header(
+  char *line, int *p_shard_index, int *p_num_shards, const char **p_desc
+);
+
+#endif /* SEGMENT_H_INCLUDED */
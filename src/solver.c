@@ -0,0 +1,395 @@
+#include "solver.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "rng.h"
+#include "util.h"
+
+#define SOLVER_INITIAL_DEPTH 64
+#define VISITED_INITIAL_CAPACITY 1024
+
+/**
+ * Initializes empty `table`.
+ *
+ * @param[out] table VisitedTable to initialize
+ */
+static void
+VisitedTable_init(VisitedTable *table)
+{
+    table->capacity = VISITED_INITIAL_CAPACITY;
+    table->keys
+      = Alloc_malloc(ALLOC_SOLVER, table->capacity * sizeof *table->keys);
+    table->stamps
+      = Alloc_calloc(ALLOC_SOLVER, table->capacity, sizeof *table->stamps);
+    table->size = 0;
+    table->stamp = 1;
+}
+
+/**
+ * Frees memory of `table`.
+ *
+ * @param[in] table VisitedTable to free
+ */
+static void
+VisitedTable_free(VisitedTable *table)
+{
+    Alloc_free(table->stamps);
+    Alloc_free(table->keys);
+}
+
+/**
+ * Clears `table` by advancing the stamp (only touches memory on wrap-around).
+ *
+ * @param[in,out] table VisitedTable to clear
+ */
+static void
+VisitedTable_clear(VisitedTable *table)
+{
+    table->size = 0;
+    ++table->stamp;
+    if (table->stamp == 0) {
+        memset(table->stamps, 0, table->capacity * sizeof *table->stamps);
+        table->stamp = 1;
+    }
+}
+
+/**
+ * Inserts `key` into `table` without growing.
+ *
+ * @param[in,out] table VisitedTable to insert into
+ * @param[in] key hash to insert
+ *
+ * @return Was `key` newly inserted?
+ */
+static bool
+VisitedTable_insert_aux(VisitedTable *table, uint64_t key)
+{
+    const long mask = table->capacity - 1;
+    for (long i = (long) (key & mask);; i = (i + 1) & mask) {
+        if (table->stamps[i] != table->stamp) {
+            table->stamps[i] = table->stamp;
+            table->keys[i] = key;
+            ++table->size;
+            return true;
+        }
+        if (table->keys[i] == key) {
+            return false;
+        }
+    }
+}
+
+/**
+ * Doubles capacity of `table` and rehashes all entries.
+ *
+ * @param[in,out] table VisitedTable to grow
+ */
+static void
+VisitedTable_grow(VisitedTable *table)
+{
+    VisitedTable old = *table;
+
+    table->capacity *= 2;
+    table->keys
+      = Alloc_malloc(ALLOC_SOLVER, table->capacity * sizeof *table->keys);
+    table->stamps
+      = Alloc_calloc(ALLOC_SOLVER, table->capacity, sizeof *table->stamps);
+    table->size = 0;
+    table->stamp = 1;
+    for (long i = 0; i < old.capacity; ++i) {
+        if (old.stamps[i] == old.stamp) {
+            VisitedTable_insert_aux(table, old.keys[i]);
+        }
+    }
+
+    VisitedTable_free(&old);
+}
+
+bool
+VisitedTable_insert(VisitedTable *table, uint64_t key)
+{
+    /* Keep load factor below 1/2 */
+    if (2 * (table->size + 1) > table->capacity) {
+        VisitedTable_grow(table);
+    }
+    return VisitedTable_insert_aux(table, key);
+}
+
+SolverContext *
+SolverContext_create(void)
+{
+    SolverContext *ctx = Alloc_malloc(ALLOC_SOLVER, sizeof *ctx);
+
+    ctx->log = ActionLog_create();
+    ctx->capacity = SOLVER_INITIAL_DEPTH;
+    ctx->frames
+      = Alloc_malloc(ALLOC_SOLVER, ctx->capacity * sizeof *ctx->frames);
+    ctx->num_tubes = 0;
+    ctx->tube_hashes = NULL;
+    ctx->tops = NULL;
+    ctx->num_free = NULL;
+    ctx->hash = 0;
+    VisitedTable_init(&ctx->visited);
+    ctx->dead = NULL;
+    memset(&ctx->stats, 0, sizeof ctx->stats);
+    ctx->trace = NULL;
+    ctx->progress = NULL;
+    ctx->checkpoint = NULL;
+
+    return ctx;
+}
+
+void
+SolverContext_destroy(SolverContext *ctx)
+{
+    if (ctx == NULL) {
+        return;
+    }
+
+    VisitedTable_free(&ctx->visited);
+    Alloc_free(ctx->num_free);
+    Alloc_free(ctx->tops);
+    Alloc_free(ctx->tube_hashes);
+    Alloc_free(ctx->frames);
+    ActionLog_destroy(ctx->log);
+
+    Alloc_free(ctx);
+}
+
+void
+SolverContext_reset(SolverContext *ctx, int num_tubes)
+{
+    ctx->log->counter = 0;
+    if (num_tubes > ctx->num_tubes) {
+        ctx->num_tubes = num_tubes;
+        ctx->tube_hashes = Alloc_realloc(
+          ALLOC_SOLVER, ctx->tube_hashes,
+          ctx->num_tubes * sizeof *ctx->tube_hashes
+        );
+        ctx->tops = Alloc_realloc(
+          ALLOC_SOLVER, ctx->tops, ctx->num_tubes * sizeof *ctx->tops
+        );
+        ctx->num_free = Alloc_realloc(
+          ALLOC_SOLVER, ctx->num_free, ctx->num_tubes * sizeof *ctx->num_free
+        );
+    }
+    ctx->hash = 0;
+    VisitedTable_clear(&ctx->visited);
+    memset(&ctx->stats, 0, sizeof ctx->stats);
+}
+
+void
+SolverContext_reserve(SolverContext *ctx, int depth)
+{
+    if (depth < ctx->capacity) {
+        return;
+    }
+    while (depth >= ctx->capacity) {
+        ctx->capacity *= 2;
+    }
+    ctx->frames = Alloc_realloc(
+      ALLOC_SOLVER, ctx->frames, ctx->capacity * sizeof *ctx->frames
+    );
+}
+
+void
+SolverContext_learn_dead(SolverContext *ctx)
+{
+    const VisitedTable *const visited = &ctx->visited;
+    if (ctx->dead == NULL) {
+        return;
+    }
+    for (long i = 0; i < visited->capacity; ++i) {
+        if (visited->stamps[i] == visited->stamp) {
+            DeadTable_insert(ctx->dead, visited->keys[i]);
+        }
+    }
+}
+
+void
+SolverStats_add(SolverStats *dst, const SolverStats *src)
+{
+    dst->nodes += src->nodes;
+    dst->pours_tried += src->pours_tried;
+    dst->pours_done += src->pours_done;
+    dst->pruned += src->pruned;
+    dst->visited_hits += src->visited_hits;
+    dst->dead_hits += src->dead_hits;
+    dst->backtracks += src->backtracks;
+    if (src->max_depth > dst->max_depth) {
+        dst->max_depth = src->max_depth;
+    }
+    dst->seconds += src->seconds;
+}
+
+void
+SolverStats_fprint_json(FILE *out, const SolverStats *stats)
+{
+    const double nodes_per_sec
+      = (stats->seconds > 0) ? stats->nodes / stats->seconds : 0;
+    fprintf(
+      out, "{\"nodes\":%li,\"seconds\":%.6f,\"nodes_per_sec\":%.0f",
+      stats->nodes, stats->seconds, nodes_per_sec
+    );
+#ifdef TUBES_STATS
+    fprintf(
+      out,
+      ",\"pours_tried\":%li,\"pours_done\":%li,\"pruned\":%li,"
+      "\"visited_hits\":%li,\"dead_hits\":%li,\"backtracks\":%li,"
+      "\"max_depth\":%i",
+      stats->pours_tried, stats->pours_done, stats->pruned,
+      stats->visited_hits, stats->dead_hits, stats->backtracks,
+      stats->max_depth
+    );
+#endif
+    fprintf(out, "}\n");
+}
+
+/**
+ * Loads `*p` (atomically if supported).
+ *
+ * @param[in] p pointer to counter
+ *
+ * @return Value of counter
+ */
+static long
+_load(const long *p)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+#else
+    return *p;
+#endif
+}
+
+/**
+ * Loads `*p` (atomically if supported).
+ *
+ * @param[in] p pointer to value
+ *
+ * @return Value
+ */
+static int
+_load_int(const int *p)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+#else
+    return *p;
+#endif
+}
+
+void
+SolverProgress_init(SolverProgress *progress)
+{
+    memset(progress, 0, sizeof *progress);
+    progress->best_bound = -1;
+}
+
+void
+SolverProgress_publish(
+  const SolverContext *ctx, long nodes, int bound, bool is_final
+)
+{
+    SolverProgress *const progress = ctx->progress;
+    if (progress == NULL) {
+        return;
+    }
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_add_fetch(&progress->nodes, nodes, __ATOMIC_RELAXED);
+    __atomic_store_n(&progress->visited, ctx->visited.size, __ATOMIC_RELAXED);
+    __atomic_store_n(&progress->depth, ctx->log->counter, __ATOMIC_RELAXED);
+    int old = __atomic_load_n(&progress->best_bound, __ATOMIC_RELAXED);
+    while ((old < 0 || bound < old)
+           && !__atomic_compare_exchange_n(
+             &progress->best_bound, &old, bound, true, __ATOMIC_RELAXED,
+             __ATOMIC_RELAXED
+           )) {
+    }
+    if (is_final == true) {
+        __atomic_add_fetch(&progress->searches, 1, __ATOMIC_RELAXED);
+    }
+#else
+    progress->nodes += nodes;
+    progress->visited = ctx->visited.size;
+    progress->depth = ctx->log->counter;
+    if (progress->best_bound < 0 || bound < progress->best_bound) {
+        progress->best_bound = bound;
+    }
+    if (is_final == true) {
+        ++progress->searches;
+    }
+#endif
+}
+
+void
+SolverProgress_read(const SolverProgress *progress, SolverProgress *snapshot)
+{
+    snapshot->nodes = _load(&progress->nodes);
+    snapshot->searches = _load(&progress->searches);
+    snapshot->visited = _load(&progress->visited);
+    snapshot->depth = _load_int(&progress->depth);
+    snapshot->best_bound = _load_int(&progress->best_bound);
+}
+
+uint64_t
+Solver_hash_tube(const Tube *tube)
+{
+    uint64_t hash = (uint64_t) tube->num_slots;
+    for (int i = 0; i < tube->num_slots; ++i) {
+        hash = hash * 0x100000001b3 + (uint64_t) (tube->slots[i].color + 2);
+    }
+    return Rng_mix64(hash);
+}
+
+DeadTable *
+DeadTable_create(void)
+{
+    DeadTable *table = Alloc_malloc(ALLOC_SOLVER, sizeof *table);
+
+    table->keys
+      = Alloc_calloc(ALLOC_SOLVER, DEAD_TABLE_SIZE, sizeof *table->keys);
+    table->size = 0;
+
+    return table;
+}
+
+void
+DeadTable_destroy(DeadTable *table)
+{
+    if (table == NULL) {
+        return;
+    }
+
+    Alloc_free(table->keys);
+    Alloc_free(table);
+}
+
+void
+DeadTable_insert(DeadTable *table, uint64_t key)
+{
+    uint64_t *const entry = &table->keys[key & (DEAD_TABLE_SIZE - 1)];
+    if (key == 0) {
+        return;
+    }
+#if defined(__GNUC__) || defined(__clang__)
+    if (__atomic_exchange_n(entry, key, __ATOMIC_RELAXED) == 0) {
+        __atomic_add_fetch(&table->size, 1, __ATOMIC_RELAXED);
+    }
+#else
+    table->size += *entry == 0;
+    *entry = key;
+#endif
+}
+
+bool
+DeadTable_contains(const DeadTable *table, uint64_t key)
+{
+    const uint64_t *const entry = &table->keys[key & (DEAD_TABLE_SIZE - 1)];
+#if defined(__GNUC__) || defined(__clang__)
+    return key != 0 && __atomic_load_n(entry, __ATOMIC_RELAXED) == key;
+#else
+    return key != 0 && *entry == key;
+#endif
+}
@@ -0,0 +1,315 @@
+/** solver.h
+ *
+ * Header for reusable state of the solver of 'tubes'. A SolverContext owns all
+ * buffers needed by a search (path, explicit DFS stack, hashes and visited
+ * table). It is reset rather than freed between solves, so solving many games
+ * in a row does (almost) no allocations in steady state. A context must only be
+ * used by one thread at a time.
+ */
+
+#ifndef SOLVER_H_INCLUDED
+#define SOLVER_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "log.h"
+#include "trace.h"
+#include "tube.h"
+
+/**
+ * Revision of the search. Bump whenever the solver may find different results
+ * for the same game (invalidates cached verdicts, see cache.h).
+ */
+#define SOLVER_REVISION 2
+
+/**
+ * Number of entries of a DeadTable (power of two).
+ */
+#define DEAD_TABLE_SIZE 65536
+
+/**
+ * Struct for statistics of searches. The counters are only maintained if
+ * compiled with TUBES_STATS (otherwise the macros below compile to nothing).
+ */
+typedef struct {
+    long nodes;        /* boards expanded */
+    long pours_tried;  /* pours attempted */
+    long pours_done;   /* pours that succeeded */
+    long pruned;       /* pointless or symmetric pours skipped */
+    long visited_hits; /* pours leading to an already visited board */
+    long dead_hits;    /* pours leading to a board known to be unsolvable */
+    long backtracks;   /* boards whose moves were exhausted */
+    int max_depth;     /* maximum depth of search */
+    double seconds;    /* time spent searching (filled in by caller) */
+} SolverStats;
+
+#ifdef TUBES_STATS
+#define SOLVER_STATS_INC(ctx, field) (++(ctx)->stats.field)
+#define SOLVER_STATS_MAX(ctx, field, value)                                    \
+    do {                                                                       \
+        if ((value) > (ctx)->stats.field) {                                    \
+            (ctx)->stats.field = (value);                                      \
+        }                                                                      \
+    } while (0)
+#else
+#define SOLVER_STATS_INC(ctx, field) ((void) 0)
+#define SOLVER_STATS_MAX(ctx, field, value) ((void) 0)
+#endif
+
+/**
+ * Number of nodes between two publications of progress (power of two).
+ */
+#define SOLVER_PROGRESS_INTERVAL 4096
+
+/**
+ * Struct for progress of searches. The solver publishes it every
+ * SOLVER_PROGRESS_INTERVAL nodes (and at the end of each search) with atomic
+ * stores, so another thread can sample it at any time (see
+ * SolverProgress_read()). It may be shared by several contexts.
+ */
+typedef struct {
+    long nodes;     /* boards expanded (by all searches) */
+    long searches;  /* finished searches */
+    long visited;   /* boards in visited table of last publishing search */
+    int depth;      /* current depth of last publishing search */
+    int best_bound; /* smallest lower bound on moves left seen (or -1) */
+} SolverProgress;
+
+/**
+ * Struct for periodic checkpoints of searches (see checkpoint.h). The time is
+ * checked every SOLVER_PROGRESS_INTERVAL nodes, a checkpoint is written at most
+ * every `interval` seconds. A finished search removes its checkpoint, a search
+ * aborted by its node limit keeps it (so it can be resumed with a higher one).
+ */
+typedef struct {
+    const char *filename; /* checkpoint file */
+    double interval;      /* minimum seconds between two checkpoints */
+    bool do_resume;       /* continue search from `filename` (if valid)? */
+    bool is_resumed;      /* was last search continued from checkpoint? */
+    long num_written;     /* number of checkpoints written */
+    time_t last;          /* time of last checkpoint (or start of search) */
+    unsigned char *key;   /* encoded initial board of current search */
+    size_t len;           /* length of `key` (0 if board cannot be encoded) */
+} SolverCheckpoint;
+
+/**
+ * Struct for set of visited board hashes (open addressing). Entries are only
+ * valid if their stamp matches the current one, so clearing is O(1).
+ */
+typedef struct {
+    uint64_t *keys;
+    uint32_t *stamps;
+    long capacity; /* power of two */
+    long size;
+    uint32_t stamp;
+} VisitedTable;
+
+/**
+ * Struct for set of hashes of boards proven unsolvable (direct-mapped, so a
+ * colliding board simply replaces the older one). Unlike the visited table, it
+ * survives searches: an unsolvable search adds every board it visited (see
+ * SolverContext_learn_dead()), so later searches in the same game (e.g., of
+ * the hint engine) skip them right away. Since the solver hash does not depend
+ * on the game (but covers the number of slots of every tube), one table may be
+ * shared by searches of boards of any size, also by the contexts of several
+ * threads (entries are read and written atomically if supported).
+ */
+typedef struct {
+    uint64_t *keys; /* 0 for empty entry */
+    long size;      /* number of occupied entries */
+} DeadTable;
+
+/**
+ * Struct for reusable solver state. The topmost chunks and free slots of the
+ * tubes are maintained along with their hashes, so most impossible pours are
+ * skipped without touching the tubes.
+ */
+typedef struct {
+    ActionLog *log;               /* moves of current path */
+    int *frames;                  /* next source tube per depth of DFS */
+    int capacity;                 /* capacity of `frames` */
+    uint64_t *tube_hashes;        /* hashes of tubes of current board */
+    ColorChunk *tops;             /* topmost chunks of tubes of current board */
+    int *num_free;                /* free slots of tubes of current board */
+    int num_tubes;                /* capacity of per-tube arrays */
+    uint64_t hash;                /* hash of current board */
+    VisitedTable visited;
+    DeadTable *dead;              /* boards proven unsolvable (or NULL) */
+    SolverStats stats;            /* of last search */
+    SearchTrace *trace;           /* records events of searches (or NULL) */
+    SolverProgress *progress;     /* published progress of searches (or NULL) */
+    SolverCheckpoint *checkpoint; /* periodic checkpoints (or NULL) */
+} SolverContext;
+
+/**
+ * Records event `type` (with current depth and hash) to trace of `ctx` (if
+ * any).
+ */
+#define SOLVER_TRACE(ctx, type, i_src, i_dst)                                  \
+    do {                                                                       \
+        if ((ctx)->trace != NULL) {                                            \
+            SearchTrace_record(                                                \
+              (ctx)->trace, (type), (i_src), (i_dst), (ctx)->log->counter,     \
+              (ctx)->hash                                                      \
+            );                                                                 \
+        }                                                                      \
+    } while (0)
+
+/**
+ * Allocates and initializes SolverContext object.
+ *
+ * @return Pointer to newly allocated SolverContext object
+ */
+SolverContext *
+SolverContext_create(void);
+
+/**
+ * Destroys `ctx` and frees memory (not its SearchTrace, which is owned by the
+ * caller).
+ *
+ * @param[in] ctx SolverContext to be destroyed
+ */
+void
+SolverContext_destroy(SolverContext *ctx);
+
+/**
+ * Resets `ctx` for a new search on a board with `num_tubes` tubes (keeps all
+ * memory).
+ *
+ * @param[in,out] ctx SolverContext to reset
+ * @param[in] num_tubes number of tubes of board
+ */
+void
+SolverContext_reset(SolverContext *ctx, int num_tubes);
+
+/**
+ * Makes sure that `ctx` can hold a DFS stack of depth `depth`.
+ *
+ * @param[in,out] ctx SolverContext to potentially grow
+ * @param[in] depth required depth
+ */
+void
+SolverContext_reserve(SolverContext *ctx, int depth);
+
+/**
+ * Adds every board visited by the last search of `ctx` to its DeadTable (if
+ * any). Only sound if that search was exhaustive, i.e., ended unsolved.
+ *
+ * @param[in,out] ctx SolverContext of finished search
+ */
+void
+SolverContext_learn_dead(SolverContext *ctx);
+
+/**
+ * Adds counters and time of `src` to `dst` (maximum for depth).
+ *
+ * @param[in,out] dst SolverStats to add to
+ * @param[in] src SolverStats to add
+ */
+void
+SolverStats_add(SolverStats *dst, const SolverStats *src);
+
+/**
+ * Prints `stats` as single-line JSON object (including nodes per second) to
+ * `out`. Without TUBES_STATS, only nodes and time are printed.
+ *
+ * @param[in] out output FILE stream
+ * @param[in] stats SolverStats to print
+ */
+void
+SolverStats_fprint_json(FILE *out, const SolverStats *stats);
+
+/**
+ * Initializes `progress` (no nodes, no bound yet).
+ *
+ * @param[out] progress SolverProgress to initialize
+ */
+void
+SolverProgress_init(SolverProgress *progress);
+
+/**
+ * Publishes state of search of `ctx` to its progress (if any): adds `nodes`
+ * to the node count, stores current depth and size of visited table and
+ * lowers the best bound to `bound`. Finishes a search if `is_final` is true.
+ *
+ * @param[in] ctx SolverContext of search
+ * @param[in] nodes number of nodes since last publication
+ * @param[in] bound lower bound on number of moves left of current board
+ * @param[in] is_final is search finished?
+ */
+void
+SolverProgress_publish(
+  const SolverContext *ctx, long nodes, int bound, bool is_final
+);
+
+/**
+ * Takes snapshot of `progress` (may be published concurrently).
+ *
+ * @param[in] progress SolverProgress to read
+ * @param[out] snapshot SolverProgress to write to
+ */
+void
+SolverProgress_read(const SolverProgress *progress, SolverProgress *snapshot);
+
+/**
+ * Returns hash of `tube` (contribution to hash of board). The hash of a board
+ * is the sum of the hashes of its tubes and thus independent of their order.
+ *
+ * @param[in] tube Tube to hash
+ *
+ * @return Hash of `tube`
+ */
+uint64_t
+Solver_hash_tube(const Tube *tube);
+
+/**
+ * Inserts `key` into `table` (and potentially grows it).
+ *
+ * @param[in,out] table VisitedTable to insert into
+ * @param[in] key hash to insert
+ *
+ * @return Was `key` newly inserted (i.e., not visited before)?
+ */
+bool
+VisitedTable_insert(VisitedTable *table, uint64_t key);
+
+/**
+ * Allocates and initializes empty DeadTable object.
+ *
+ * @return Pointer to newly allocated DeadTable object
+ */
+DeadTable *
+DeadTable_create(void);
+
+/**
+ * Destroys `table` and frees memory.
+ *
+ * @param[in] table DeadTable to be destroyed (or NULL)
+ */
+void
+DeadTable_destroy(DeadTable *table);
+
+/**
+ * Inserts `key` into `table` (replacing any colliding key).
+ *
+ * @param[in,out] table DeadTable to insert into
+ * @param[in] key hash of unsolvable board
+ */
+void
+DeadTable_insert(DeadTable *table, uint64_t key);
+
+/**
+ * Returns if `key` is in `table`.
+ *
+ * @param[in] table DeadTable to look up
+ * @param[in] key hash of board
+ *
+ * @return Is board known to be unsolvable?
+ */
+bool
+DeadTable_contains(const DeadTable *table, uint64_t key);
+
+#endif /* SOLVER_H_INCLUDED */
@@ -0,0 +1,33 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "ticker.h"
+
+double
+Ticker_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void
+Ticker_init(Ticker *ticker, double interval)
+{
+    /* Realtime, as expected by pthread_cond_timedwait() */
+    clock_gettime(CLOCK_REALTIME, &ticker->deadline);
+    ticker->interval = interval;
+}
+
+void
+Ticker_wait(
+  Ticker *ticker, pthread_cond_t *cond, pthread_mutex_t *mutex,
+  const bool *p_is_stopped
+)
+{
+    const double next = ticker->deadline.tv_nsec * 1e-9 + ticker->interval;
+    ticker->deadline.tv_sec += (time_t) next;
+    ticker->deadline.tv_nsec = (long) ((next - (time_t) next) * 1e9);
+    while (*p_is_stopped == false
+           && pthread_cond_timedwait(cond, mutex, &ticker->deadline) == 0) {
+    }
+}
@@ -0,0 +1,55 @@
+/** ticker.h
+ *
+ * Header for the clock and periodic wait shared by the background threads of
+ * 'tubes' (progress reporter, metrics writer of the daemon). A Ticker wakes
+ * its thread at a fixed interval, or as soon as the thread is told to stop.
+ */
+
+#ifndef TICKER_H_INCLUDED
+#define TICKER_H_INCLUDED
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <time.h>
+
+/**
+ * Struct for periodic deadline.
+ */
+typedef struct {
+    struct timespec deadline; /* of next tick (realtime clock) */
+    double interval;          /* seconds between two ticks */
+} Ticker;
+
+/**
+ * Returns current time (monotonic).
+ *
+ * @return Time in seconds
+ */
+double
+Ticker_now(void);
+
+/**
+ * Initializes `ticker` to tick every `interval` seconds from now.
+ *
+ * @param[out] ticker Ticker to initialize
+ * @param[in] interval seconds between two ticks
+ */
+void
+Ticker_init(Ticker *ticker, double interval);
+
+/**
+ * Waits on `cond` until next tick of `ticker` or until `*p_is_stopped` is set
+ * (guarded by `mutex`, which must be locked).
+ *
+ * @param[in,out] ticker Ticker to wait for
+ * @param[in] cond condition signaled on stop
+ * @param[in] mutex locked mutex guarding `*p_is_stopped`
+ * @param[in] p_is_stopped pointer to stop flag
+ */
+void
+Ticker_wait(
+  Ticker *ticker, pthread_cond_t *cond, pthread_mutex_t *mutex,
+  const bool *p_is_stopped
+);
+
+#endif /* TICKER_H_INCLUDED */
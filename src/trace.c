@@ -0,0 +1,121 @@
+#include "trace.h"
+
+#include <string.h>
+
+#include "alloc.h"
+#include "util.h"
+
+#define TRACE_MAX_TUBE_INDEX 255
+
+/**
+ * Encodes `event` to `TRACE_EVENT_SIZE` bytes at `p`.
+ *
+ * @param[out] p pointer to bytes
+ * @param[in] event TraceEvent to encode
+ */
+static void
+TraceEvent_encode(unsigned char *p, const TraceEvent *event)
+{
+    p[0] = event->type;
+    p[1] = event->i_src;
+    p[2] = event->i_dst;
+    p[3] = 0;
+    for (int i = 0; i < 4; ++i) {
+        p[4 + i] = (unsigned char) ((event->depth >> (8 * i)) & 0xff);
+    }
+    for (int i = 0; i < 8; ++i) {
+        p[8 + i] = (unsigned char) ((event->hash >> (8 * i)) & 0xff);
+    }
+}
+
+void
+TraceEvent_decode(const unsigned char *p, TraceEvent *event)
+{
+    event->type = p[0];
+    event->i_src = p[1];
+    event->i_dst = p[2];
+    event->depth = 0;
+    for (int i = 3; i >= 0; --i) {
+        event->depth = (event->depth << 8) | p[4 + i];
+    }
+    event->hash = 0;
+    for (int i = 7; i >= 0; --i) {
+        event->hash = (event->hash << 8) | p[8 + i];
+    }
+}
+
+SearchTrace *
+SearchTrace_create(FILE *out, long capacity, bool keep_last)
+{
+    SearchTrace *trace = Alloc_malloc(ALLOC_SOLVER, sizeof *trace);
+
+    trace->out = out;
+    trace->capacity = 1;
+    while (trace->capacity < capacity) {
+        trace->capacity *= 2;
+    }
+    trace->events = Alloc_malloc(
+      ALLOC_SOLVER, trace->capacity * sizeof *trace->events
+    );
+    trace->head = 0;
+    trace->keep_last = keep_last;
+
+    unsigned char header[TRACE_HEADER_SIZE] = {0};
+    memcpy(header, TRACE_MAGIC, sizeof TRACE_MAGIC - 1);
+    header[8] = TRACE_EVENT_SIZE;
+    fwrite(header, 1, sizeof header, out);
+
+    return trace;
+}
+
+void
+SearchTrace_destroy(SearchTrace *trace)
+{
+    if (trace == NULL) {
+        return;
+    }
+
+    SearchTrace_flush(trace);
+    Alloc_free(trace->events);
+
+    Alloc_free(trace);
+}
+
+void
+SearchTrace_record(
+  SearchTrace *trace, int type, int i_src, int i_dst, int depth, uint64_t hash
+)
+{
+    if (trace->head == trace->capacity && trace->keep_last == false) {
+        SearchTrace_flush(trace);
+    }
+    TraceEvent *const event
+      = &trace->events[trace->head++ & (trace->capacity - 1)];
+    event->hash = hash;
+    event->depth = (uint32_t) depth;
+    event->type = (uint8_t) type;
+    event->i_src = (uint8_t) ((i_src < TRACE_MAX_TUBE_INDEX)
+                                ? i_src
+                                : TRACE_MAX_TUBE_INDEX);
+    event->i_dst = (uint8_t) ((i_dst < TRACE_MAX_TUBE_INDEX)
+                                ? i_dst
+                                : TRACE_MAX_TUBE_INDEX);
+}
+
+int
+SearchTrace_flush(SearchTrace *trace)
+{
+    const long num_events
+      = (trace->head < trace->capacity) ? trace->head : trace->capacity;
+    unsigned char buffer[TRACE_EVENT_SIZE];
+    int status = TUBE_SUCCESS;
+    for (long i = trace->head - num_events; i < trace->head; ++i) {
+        TraceEvent_encode(buffer, &trace->events[i & (trace->capacity - 1)]);
+        if (fwrite(buffer, 1, sizeof buffer, trace->out) != sizeof buffer) {
+            status = TUBE_FAILURE;
+        }
+    }
+    trace->head = 0;
+    fflush(trace->out);
+    return status;
+}
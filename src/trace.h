@@ -0,0 +1,129 @@
+/** trace.h
+ *
+ * Header for the binary search trace of 'tubes'. A SearchTrace records compact
+ * events of the solver (expansions, pours, reverts, prunes and visited-table
+ * hits, each with the depth and board hash) into a buffer that is written to a
+ * trace file. It is attached to a SolverContext (and thus per thread); without
+ * one, recording costs a single pointer check per event.
+ *
+ * A trace file starts with a header of 16 bytes (TRACE_MAGIC and the size of an
+ * event as 32-bit integer, then zero padding), followed by the events in order,
+ * all integers little-endian:
+ *
+ *   offset  size  field
+ *        0     1  type (trace event enumerator)
+ *        1     1  index of source tube (solver status for TRACE_END)
+ *        2     1  index of destination tube
+ *        3     1  zero
+ *        4     4  depth (number of moves on current path)
+ *        8     8  hash of board (after the event)
+ *
+ * Tube indices above 254 are stored as 255. The decoder is 'tubes-traceview'.
+ */
+
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define TRACE_MAGIC "TUBETRC1"
+#define TRACE_HEADER_SIZE 16
+#define TRACE_EVENT_SIZE 16
+#define TRACE_DEFAULT_CAPACITY 65536 /* events buffered between writes */
+
+/**
+ * Trace event enumerator.
+ */
+enum {
+    TRACE_BEGIN,   /* start of search (initial board) */
+    TRACE_EXPAND,  /* board expanded (counted as node) */
+    TRACE_POUR,    /* pour to unvisited board */
+    TRACE_VISITED, /* pour to visited or dead board (undone right away) */
+    TRACE_PRUNE,   /* pointless pour skipped */
+    TRACE_REVERT,  /* backtracking */
+    TRACE_END,     /* end of search */
+    TRACE_NUM_TYPES,
+};
+
+/**
+ * Auxiliary struct for a single event (in memory).
+ */
+typedef struct {
+    uint64_t hash;
+    uint32_t depth;
+    uint8_t type;
+    uint8_t i_src;
+    uint8_t i_dst;
+} TraceEvent;
+
+/**
+ * Struct for search trace.
+ */
+typedef struct {
+    FILE *out;
+    TraceEvent *events;
+    long capacity; /* power of two */
+    long head;     /* number of events recorded since last flush */
+    bool keep_last;
+} SearchTrace;
+
+/**
+ * Allocates SearchTrace writing to `out` (header is written immediately). By
+ * default, the buffer of `capacity` events is written whenever it is full. If
+ * `keep_last` is true, it is used as ring buffer instead, i.e., only the last
+ * `capacity` events (before each flush) are written.
+ *
+ * @param[in] out output FILE stream (binary)
+ * @param[in] capacity number of events to buffer (rounded up to power of two)
+ * @param[in] keep_last keep last events only?
+ *
+ * @return Pointer to newly allocated SearchTrace object
+ */
+SearchTrace *
+SearchTrace_create(FILE *out, long capacity, bool keep_last);
+
+/**
+ * Flushes and destroys `trace` and frees memory (does not close its stream).
+ *
+ * @param[in] trace SearchTrace to be destroyed
+ */
+void
+SearchTrace_destroy(SearchTrace *trace);
+
+/**
+ * Records event of type `type` in `trace`.
+ *
+ * @param[in,out] trace SearchTrace to record to
+ * @param[in] type trace event enumerator
+ * @param[in] i_src index of source tube
+ * @param[in] i_dst index of destination tube
+ * @param[in] depth depth of search
+ * @param[in] hash hash of board
+ */
+void
+SearchTrace_record(
+  SearchTrace *trace, int type, int i_src, int i_dst, int depth, uint64_t hash
+);
+
+/**
+ * Writes buffered events of `trace` to its stream.
+ *
+ * @param[in,out] trace SearchTrace to flush
+ *
+ * @return Error code
+ */
+int
+SearchTrace_flush(SearchTrace *trace);
+
+/**
+ * Decodes event of `TRACE_EVENT_SIZE` bytes at `p` to `event`.
+ *
+ * @param[in] p pointer to bytes
+ * @param[out] event TraceEvent to write to
+ */
+void
+TraceEvent_decode(const unsigned char *p, TraceEvent *event);
+
+#endif /* TRACE_H_INCLUDED */
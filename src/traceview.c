@@ -0,0 +1,339 @@
+/** traceview.c
+ *
+ * 'tubes-traceview': summarizes binary search traces of 'tubes' (see trace.h),
+ * i.e., numbers of events and searches, hot subtrees (expansions below the
+ * first one or two moves), repeatedly reached boards (visited-table hits by
+ * hash) and the depth of the search over time.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gameinfo.h"
+#include "trace.h"
+#include "util.h"
+
+#define INITIAL_CAPACITY 1024
+#define MAXIMUM_PATH_LENGTH 2
+#define NUMBER_OF_TOP_ENTRIES 10
+#define NUMBER_OF_BUCKETS 20
+
+/**
+ * Names of trace event types (for output).
+ */
+static const char *const TYPE_NAMES[TRACE_NUM_TYPES] = {
+  [TRACE_BEGIN] = "begin",   [TRACE_EXPAND] = "expand",
+  [TRACE_POUR] = "pour",     [TRACE_VISITED] = "visited",
+  [TRACE_PRUNE] = "prune",   [TRACE_REVERT] = "revert",
+  [TRACE_END] = "end",
+};
+
+/**
+ * Auxiliary struct for a counter of a key.
+ */
+typedef struct {
+    uint64_t key;
+    long count; /* zero if unused */
+} Counter;
+
+/**
+ * Auxiliary struct for hash table of counters.
+ */
+typedef struct {
+    Counter *entries;
+    long capacity; /* power of two */
+    long size;
+} CounterTable;
+
+/**
+ * Auxiliary struct for depth of one bucket of the trace.
+ */
+typedef struct {
+    long num_events;
+    double sum_depth;
+    long max_depth;
+} DepthBucket;
+
+/**
+ * Initializes empty `table`.
+ *
+ * @param[out] table CounterTable to initialize
+ */
+static void
+CounterTable_init(CounterTable *table)
+{
+    table->capacity = INITIAL_CAPACITY;
+    table->entries = calloc(table->capacity, sizeof *table->entries);
+    table->size = 0;
+}
+
+/**
+ * Adds `count` to counter of `key` in `table`.
+ *
+ * @param[in,out] table CounterTable to update
+ * @param[in] key key of counter
+ * @param[in] count value to add (positive)
+ */
+static void
+CounterTable_add(CounterTable *table, uint64_t key, long count)
+{
+    /* Keep load factor below 1/2 */
+    if (2 * (table->size + 1) > table->capacity) {
+        CounterTable old = *table;
+        table->capacity *= 2;
+        table->entries = calloc(table->capacity, sizeof *table->entries);
+        table->size = 0;
+        for (long i = 0; i < old.capacity; ++i) {
+            const Counter *const entry = &old.entries[i];
+            if (entry->count > 0) {
+                CounterTable_add(table, entry->key, entry->count);
+            }
+        }
+        free(old.entries);
+    }
+    const long mask = table->capacity - 1;
+    const uint64_t mixed = key * 0x9e3779b97f4a7c15;
+    for (long i = (long) ((mixed >> 32) & mask);; i = (i + 1) & mask) {
+        Counter *const entry = &table->entries[i];
+        if (entry->count == 0) {
+            entry->key = key;
+            entry->count = count;
+            ++table->size;
+            return;
+        }
+        if (entry->key == key) {
+            entry->count += count;
+            return;
+        }
+    }
+}
+
+/**
+ * Comparison function for Counter objects (by descending count, then key) in
+ * the style of the C standard library.
+ *
+ * @param[in] lhs pointer to left hand side
+ * @param[in] rhs pointer to right hand side
+ *
+ * @return <0 if `lhs` is less than `rhs, >0 if greater than, 0 if equal
+ */
+static int
+_cmp_fnc_counter(const void *lhs, const void *rhs)
+{
+    const Counter *const a = lhs;
+    const Counter *const b = rhs;
+    if (a->count != b->count) {
+        return (a->count < b->count) - (a->count > b->count);
+    }
+    return (a->key > b->key) - (a->key < b->key);
+}
+
+/**
+ * Sorts used entries of `table` to its front (by descending count).
+ *
+ * @param[in,out] table CounterTable to sort (no longer usable as table)
+ */
+static void
+CounterTable_sort(CounterTable *table)
+{
+    long n = 0;
+    for (long i = 0; i < table->capacity; ++i) {
+        if (table->entries[i].count > 0) {
+            table->entries[n++] = table->entries[i];
+        }
+    }
+    qsort(table->entries, n, sizeof *table->entries, _cmp_fnc_counter);
+}
+
+/**
+ * Encodes move prefix of `length` moves as key (one byte per tube index, length
+ * in the top bits).
+ *
+ * @param[in] path source and destination tubes of moves
+ * @param[in] length number of moves
+ *
+ * @return Key of prefix
+ */
+static uint64_t
+_prefix_key(uint8_t path[][2], int length)
+{
+    uint64_t key = 0;
+    for (int i = 0; i < length; ++i) {
+        key = (key << 16) | ((uint64_t) path[i][0] << 8) | path[i][1];
+    }
+    return key | ((uint64_t) length << 48);
+}
+
+/**
+ * Prints move prefix encoded in `key` (see _prefix_key()) to `out`.
+ *
+ * @param[in] out output FILE stream
+ * @param[in] key key of prefix
+ */
+static void
+_fprint_prefix(FILE *out, uint64_t key)
+{
+    const int length = (int) (key >> 48);
+    for (int i = length - 1; i >= 0; --i) {
+        const uint64_t move = key >> (16 * i);
+        fprintf(
+          out, "%s%i>%i", (i == length - 1) ? "" : " ",
+          (int) ((move >> 8) & 0xff), (int) (move & 0xff)
+        );
+    }
+}
+
+/**
+ * Usage string.
+ */
+static const char *const usage
+  = "Usage: tubes-traceview TRACE...\n"
+    "Summarizes binary search traces of 'tubes' (written with option -X).\n";
+
+int
+main(int argc, char **argv)
+{
+    if (argc < 2 || strcmp(argv[1], "-h") == 0) {
+        ERROR("%s", usage);
+    }
+
+    for (int i_arg = 1; i_arg < argc; ++i_arg) {
+        const char *const filename = argv[i_arg];
+        FILE *in = fopen(filename, "rb");
+        if (in == NULL) {
+            ERROR("Could not open trace '%s'!", filename);
+        }
+        unsigned char header[TRACE_HEADER_SIZE];
+        if (fread(header, 1, sizeof header, in) != sizeof header
+            || memcmp(header, TRACE_MAGIC, sizeof TRACE_MAGIC - 1) != 0
+            || header[8] != TRACE_EVENT_SIZE) {
+            ERROR("Invalid header of trace '%s'!", filename);
+        }
+        fseek(in, 0, SEEK_END);
+        const long num_events
+          = (ftell(in) - TRACE_HEADER_SIZE) / TRACE_EVENT_SIZE;
+        fseek(in, TRACE_HEADER_SIZE, SEEK_SET);
+
+        long counts[TRACE_NUM_TYPES] = {0};
+        long num_status[SOLVER_ABORTED + 1] = {0};
+        CounterTable prefixes, hits, boards;
+        CounterTable_init(&prefixes);
+        CounterTable_init(&hits);
+        CounterTable_init(&boards);
+        DepthBucket buckets[NUMBER_OF_BUCKETS] = {{0}};
+        uint8_t path[MAXIMUM_PATH_LENGTH][2] = {{0}};
+        int num_known = 0; /* number of moves of path known from trace */
+
+        unsigned char buffer[TRACE_EVENT_SIZE];
+        for (long i = 0; i < num_events; ++i) {
+            if (fread(buffer, 1, sizeof buffer, in) != sizeof buffer) {
+                ERROR("Truncated trace '%s'!", filename);
+            }
+            TraceEvent event;
+            TraceEvent_decode(buffer, &event);
+            if (event.type >= TRACE_NUM_TYPES) {
+                ERROR("Invalid event %li of trace '%s'!", i, filename);
+            }
+            ++counts[event.type];
+
+            DepthBucket *const bucket
+              = &buckets[i * NUMBER_OF_BUCKETS / num_events];
+            ++bucket->num_events;
+            bucket->sum_depth += event.depth;
+            if ((long) event.depth > bucket->max_depth) {
+                bucket->max_depth = event.depth;
+            }
+
+            switch (event.type) {
+            case TRACE_BEGIN:
+                CounterTable_add(&boards, event.hash, 1);
+                num_known = 0;
+                break;
+            case TRACE_POUR:
+                CounterTable_add(&boards, event.hash, 1);
+                /* Partial traces (-x) may start below the first moves */
+                if (event.depth >= 1 && event.depth <= MAXIMUM_PATH_LENGTH
+                    && (int) event.depth - 1 <= num_known) {
+                    path[event.depth - 1][0] = event.i_src;
+                    path[event.depth - 1][1] = event.i_dst;
+                    num_known = event.depth;
+                }
+                break;
+            case TRACE_REVERT:
+                if ((int) event.depth < num_known) {
+                    num_known = event.depth;
+                }
+                break;
+            case TRACE_VISITED:
+                CounterTable_add(&hits, event.hash, 1);
+                break;
+            case TRACE_EXPAND:
+                for (int n = 1; n <= MAXIMUM_PATH_LENGTH; ++n) {
+                    if (n <= (int) event.depth && n <= num_known) {
+                        CounterTable_add(&prefixes, _prefix_key(path, n), 1);
+                    }
+                }
+                break;
+            case TRACE_END:
+                if (event.i_src <= SOLVER_ABORTED) {
+                    ++num_status[event.i_src];
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        fclose(in);
+
+        printf("%s: %li events\n", filename, num_events);
+        for (int type = 0; type < TRACE_NUM_TYPES; ++type) {
+            printf("  %-8s %li\n", TYPE_NAMES[type], counts[type]);
+        }
+        printf(
+          "searches: %li (solved %li, unsolved %li, aborted %li)\n",
+          counts[TRACE_BEGIN], num_status[SOLVER_SOLVED],
+          num_status[SOLVER_UNSOLVED], num_status[SOLVER_ABORTED]
+        );
+
+        printf("hot subtrees (expansions below first moves):\n");
+        CounterTable_sort(&prefixes);
+        for (long i = 0; i < prefixes.size && i < NUMBER_OF_TOP_ENTRIES; ++i) {
+            printf("  %10li  ", prefixes.entries[i].count);
+            _fprint_prefix(stdout, prefixes.entries[i].key);
+            printf("\n");
+        }
+
+        printf(
+          "repeated boards (%li distinct, %li visited hits):\n", boards.size,
+          counts[TRACE_VISITED]
+        );
+        CounterTable_sort(&hits);
+        for (long i = 0; i < hits.size && i < NUMBER_OF_TOP_ENTRIES; ++i) {
+            printf(
+              "  %10li  %016llx\n", hits.entries[i].count,
+              (unsigned long long) hits.entries[i].key
+            );
+        }
+
+        printf("depth over time (average, maximum):\n");
+        for (int i = 0; i < NUMBER_OF_BUCKETS; ++i) {
+            if (buckets[i].num_events == 0) {
+                continue;
+            }
+            printf(
+              "  %3i%%  %8.1f  %6li\n", i * 100 / NUMBER_OF_BUCKETS,
+              buckets[i].sum_depth / buckets[i].num_events,
+              buckets[i].max_depth
+            );
+        }
+
+        free(boards.entries);
+        free(hits.entries);
+        free(prefixes.entries);
+    }
+
+    return EXIT_SUCCESS;
+}
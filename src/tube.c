@@ -2,19 +2,25 @@
 
 #include <stdlib.h>
 
+#include "alloc.h"
 #include "util.h"
 
 /**
- * Returns if `tube` is empty.
+ * Returns if `tube` with `num_slots` slots is empty.
+ *
+ * All auxiliary functions taking `num_slots` explicitly are force-inlined so
+ * that the specialized kernels below get constant trip counts (and thus fully
+ * unrolled loops).
  *
  * @param[in] tube Tube to check
+ * @param[in] num_slots number of slots of `tube`
  *
  * @return Is `tube` empty?
  */
-static bool
-Tube_is_empty(const Tube *tube)
+static ALWAYS_INLINE bool
+Tube_is_empty_n(const Tube *tube, int num_slots)
 {
-    for (int i = tube->num_slots - 1; i >= 0; --i) {
+    for (int i = num_slots - 1; i >= 0; --i) {
         if (tube->slots[i].color != EMPTY_COLOR_INDEX) {
             return false;
         }
@@ -23,16 +29,17 @@ Tube_is_empty(const Tube *tube)
 }
 
 /**
- * Returns if `tube` is full.
+ * Returns if `tube` with `num_slots` slots is full.
  *
  * @param[in] tube Tube to check
+ * @param[in] num_slots number of slots of `tube`
  *
  * @return Is `tube` full?
  */
-static bool
-Tube_is_full(const Tube *tube)
+static ALWAYS_INLINE bool
+Tube_is_full_n(const Tube *tube, int num_slots)
 {
-    for (int i = 0; i < tube->num_slots; ++i) {
+    for (int i = 0; i < num_slots; ++i) {
         if (tube->slots[i].color == EMPTY_COLOR_INDEX) {
             return false;
         }
@@ -43,10 +50,10 @@ Tube_is_full(const Tube *tube)
 Tube *
 Tube_create(int num_slots)
 {
-    Tube *tube = malloc(sizeof *tube);
+    Tube *tube = Alloc_malloc(ALLOC_TUBE, sizeof *tube);
 
     tube->num_slots = num_slots;
-    tube->slots = malloc(num_slots * sizeof *tube->slots);
+    tube->slots = Alloc_malloc(ALLOC_TUBE, num_slots * sizeof *tube->slots);
     Tube_clear(tube);
 
     return tube;
@@ -59,9 +66,9 @@ Tube_destroy(Tube *tube)
         return;
     }
 
-    free(tube->slots);
+    Alloc_free(tube->slots);
 
-    free(tube);
+    Alloc_free(tube);
 }
 
 void
@@ -76,7 +83,7 @@ Tube_clear(Tube *tube)
 int
 Tube_add_color(Tube *tube, int color)
 {
-    if (Tube_is_full(tube)) {
+    if (Tube_is_full_n(tube, tube->num_slots)) {
         return TUBE_FAILURE;
     }
     for (int i = 0; i < tube->num_slots; ++i) {
@@ -93,13 +100,14 @@ Tube_add_color(Tube *tube, int color)
  * Writes topmost ColorChunk of `tube` to ColorChunk pointed to by `p_chunk`.
  *
  * @param[in] tube Tube to check
+ * @param[in] num_slots number of slots of `tube`
  * @param[out] p_chunk pointer to ColorChunk to write result to
  */
-static void
-Tube_get_top_chunk(const Tube *tube, ColorChunk *p_chunk)
+static ALWAYS_INLINE void
+Tube_get_top_chunk_n(const Tube *tube, int num_slots, ColorChunk *p_chunk)
 {
     int color = EMPTY_COLOR_INDEX;
-    int i = tube->num_slots - 1;
+    int i = num_slots - 1;
     for (; i >= 0; --i) {
         if (tube->slots[i].color != EMPTY_COLOR_INDEX) {
             color = tube->slots[i].color;
@@ -122,17 +130,20 @@ Tube_get_top_chunk(const Tube *tube, ColorChunk *p_chunk)
  * `check`.
  *
  * @param[in] tube Tube to add chunk to
+ * @param[in] num_slots number of slots of `tube`
  * @param[in] p_chunk pointer to ColorChunk to add
  * @param[in] check perform check for push?
  *
  * @return Error code
  */
-static int
-Tube_push_chunk_aux(Tube *tube, const ColorChunk *p_chunk, bool check)
+static ALWAYS_INLINE int
+Tube_push_chunk_aux(
+  Tube *tube, int num_slots, const ColorChunk *p_chunk, bool check
+)
 {
     int color = EMPTY_COLOR_INDEX;
     int count = 0;
-    int i = tube->num_slots - 1;
+    int i = num_slots - 1;
     for (; i >= 0; --i) {
         if (tube->slots[i].color != EMPTY_COLOR_INDEX) {
             break;
@@ -162,13 +173,14 @@ Tube_push_chunk_aux(Tube *tube, const ColorChunk *p_chunk, bool check)
  * remove topmost chunk of tube. If not, only remove if it fits `p_chunk`.
  *
  * @param[in] tube Tube to remove chunk from
+ * @param[in] num_slots number of slots of `tube`
  * @param[in] p_chunk pointer to ColorChunk to remove (NULL for any)
  */
-static void
-Tube_pop_chunk_aux(Tube *tube, const ColorChunk *p_chunk)
+static ALWAYS_INLINE void
+Tube_pop_chunk_aux(Tube *tube, int num_slots, const ColorChunk *p_chunk)
 {
     int color = EMPTY_COLOR_INDEX;
-    int i = tube->num_slots - 1;
+    int i = num_slots - 1;
     for (; i >= 0; --i) {
         if (tube->slots[i].color != EMPTY_COLOR_INDEX) {
             color = tube->slots[i].color;
@@ -193,42 +205,30 @@ Tube_pop_chunk_aux(Tube *tube, const ColorChunk *p_chunk)
 }
 
 /**
- * Adds ColorChunk pointed to by `p_chunk` to `tube` (with check).
+ * Tries to pour contents of `tube_src` to `tube_dst` (both with `num_slots`
+ * slots) and writes moved chunk to `p_chunk` if successful.
  *
- * @param[in] tube Tube to add chunk to
- * @param[in] p_chunk pointer to ColorChunk to add
+ * @param[in] tube_src source tube
+ * @param[in] tube_dst destination tube
+ * @param[in] num_slots number of slots of both tubes
+ * @param[out] p_chunk pointer to moved ColorChunk
  *
  * @return Error code
  */
-static inline int
-Tube_push_chunk(Tube *tube, const ColorChunk *p_chunk)
-{
-    return Tube_push_chunk_aux(tube, p_chunk, true);
-}
-
-/**
- * Removes topmost ColorChunk from `tube`.
- *
- * @param[in] tube Tube to remove topmost chunk from
- */
-static inline void
-Tube_pop_chunk(Tube *tube)
+static ALWAYS_INLINE int
+Tube_pour_n(Tube *tube_src, Tube *tube_dst, int num_slots, ColorChunk *p_chunk)
 {
-    Tube_pop_chunk_aux(tube, NULL);
-}
-
-int
-Tube_pour(Tube *tube_src, Tube *tube_dst, ColorChunk *p_chunk)
-{
-    if (Tube_is_empty(tube_src) || Tube_is_full(tube_dst)) {
+    if (Tube_is_empty_n(tube_src, num_slots)
+        || Tube_is_full_n(tube_dst, num_slots)) {
         return TUBE_FAILURE;
     }
     ColorChunk chunk = {0};
-    Tube_get_top_chunk(tube_src, &chunk);
-    if (Tube_push_chunk(tube_dst, &chunk) == TUBE_FAILURE) {
+    Tube_get_top_chunk_n(tube_src, num_slots, &chunk);
+    if (Tube_push_chunk_aux(tube_dst, num_slots, &chunk, true)
+        == TUBE_FAILURE) {
         return TUBE_FAILURE;
     }
-    Tube_pop_chunk(tube_src);
+    Tube_pop_chunk_aux(tube_src, num_slots, NULL);
     if (p_chunk != NULL) {
         *p_chunk = chunk;
     }
@@ -236,44 +236,37 @@ Tube_pour(Tube *tube_src, Tube *tube_dst, ColorChunk *p_chunk)
 }
 
 /**
- * Adds ColorChunk pointed to by `p_chunk` to `tube` (without check).
+ * Reverts pouring of `p_chunk` from `tube_src` to `tube_dst` (both with
+ * `num_slots` slots). We assume everything went smoothly so we don't need
+ * checks.
  *
- * @param[in] tube Tube to add chunk to
- * @param[in] p_chunk pointer to ColorChunk to add
+ * @param[in] tube_src original source tube
+ * @param[in] tube_dst original destination tube
+ * @param[in] num_slots number of slots of both tubes
+ * @param[in] p_chunk pointer to moved ColorChunk to revert
  */
-static void
-Tube_add_chunk(Tube *tube, const ColorChunk *p_chunk)
+static ALWAYS_INLINE void
+Tube_revert_n(
+  Tube *tube_src, Tube *tube_dst, int num_slots, const ColorChunk *p_chunk
+)
 {
-    Tube_push_chunk_aux(tube, p_chunk, false);
+    Tube_pop_chunk_aux(tube_dst, num_slots, p_chunk);
+    Tube_push_chunk_aux(tube_src, num_slots, p_chunk, false);
 }
 
 /**
- * Removes ColorChunk pointed to by `p_chunk` from `tube`.
+ * Returns if `tube` with `num_slots` slots is pure (all slots have same color).
  *
- * @param[in] tube Tube to remove chunk from
- * @param[in] p_chunk pointer to ColorChunk to remove
- */
-static void
-Tube_remove_chunk(Tube *tube, const ColorChunk *p_chunk)
-{
-    Tube_pop_chunk_aux(tube, p_chunk);
-}
-
-/**
- * We assume everything went smoothly so we don't need checks
+ * @param[in] tube Tube to check
+ * @param[in] num_slots number of slots of `tube`
+ *
+ * @return Is `tube` pure?
  */
-void
-Tube_revert(Tube *tube_src, Tube *tube_dst, const ColorChunk *p_chunk)
-{
-    Tube_remove_chunk(tube_dst, p_chunk);
-    Tube_add_chunk(tube_src, p_chunk);
-}
-
-bool
-Tube_is_pure(const Tube *tube)
+static ALWAYS_INLINE bool
+Tube_is_pure_n(const Tube *tube, int num_slots)
 {
     const int color = tube->slots[0].color;
-    for (int i = 1; i < tube->num_slots; ++i) {
+    for (int i = 1; i < num_slots; ++i) {
         if (tube->slots[i].color != color) {
             return false;
         }
@@ -281,11 +274,20 @@ Tube_is_pure(const Tube *tube)
     return true;
 }
 
-bool
-Tube_is_one_color(const Tube *tube)
+/**
+ * Returns if `tube` with `num_slots` slots is one color (even if not all slots
+ * are filled).
+ *
+ * @param[in] tube Tube to check
+ * @param[in] num_slots number of slots of `tube`
+ *
+ * @return Is `tube` only one color?
+ */
+static ALWAYS_INLINE bool
+Tube_is_one_color_n(const Tube *tube, int num_slots)
 {
     const int color = tube->slots[0].color;
-    for (int i = 1; i < tube->num_slots; ++i) {
+    for (int i = 1; i < num_slots; ++i) {
         if (tube->slots[i].color == EMPTY_COLOR_INDEX) {
             continue;
         }
@@ -295,3 +297,135 @@ Tube_is_one_color(const Tube *tube)
     }
     return true;
 }
+
+void
+Tube_get_top_chunk(const Tube *tube, ColorChunk *p_chunk)
+{
+    Tube_get_top_chunk_n(tube, tube->num_slots, p_chunk);
+}
+
+int
+Tube_reveal(Tube *tube)
+{
+    ColorChunk chunk;
+    Tube_get_top_chunk(tube, &chunk);
+    const int i_top = tube->num_slots - Tube_count_free(tube) - 1;
+    int count = 0;
+    for (int i = i_top; i > i_top - chunk.count; --i) {
+        count += tube->slots[i].is_hidden == true;
+        tube->slots[i].is_hidden = false;
+    }
+    return count;
+}
+
+int
+Tube_count_free(const Tube *tube)
+{
+    int count = 0;
+    for (int i = tube->num_slots - 1; i >= 0; --i) {
+        if (tube->slots[i].color != EMPTY_COLOR_INDEX) {
+            break;
+        }
+        ++count;
+    }
+    return count;
+}
+
+int
+Tube_pour(Tube *tube_src, Tube *tube_dst, ColorChunk *p_chunk)
+{
+    return Tube_pour_n(tube_src, tube_dst, tube_src->num_slots, p_chunk);
+}
+
+void
+Tube_revert(Tube *tube_src, Tube *tube_dst, const ColorChunk *p_chunk)
+{
+    Tube_revert_n(tube_src, tube_dst, tube_src->num_slots, p_chunk);
+}
+
+bool
+Tube_is_pure(const Tube *tube)
+{
+    return Tube_is_pure_n(tube, tube->num_slots);
+}
+
+bool
+Tube_is_one_color(const Tube *tube)
+{
+    return Tube_is_one_color_n(tube, tube->num_slots);
+}
+
+/**
+ * Defines kernels with the compile-time constant number of slots `N` and the
+ * corresponding TubeOps table `TUBE_OPS_N`.
+ */
+#define TUBE_DEFINE_KERNELS(N)                                                 \
+    static int Tube_pour_##N(                                                  \
+      Tube *tube_src, Tube *tube_dst, ColorChunk *p_chunk                      \
+    )                                                                          \
+    {                                                                          \
+        return Tube_pour_n(tube_src, tube_dst, N, p_chunk);                    \
+    }                                                                          \
+    static void Tube_revert_##N(                                               \
+      Tube *tube_src, Tube *tube_dst, const ColorChunk *p_chunk                \
+    )                                                                          \
+    {                                                                          \
+        Tube_revert_n(tube_src, tube_dst, N, p_chunk);                         \
+    }                                                                          \
+    static bool Tube_is_pure_##N(const Tube *tube)                             \
+    {                                                                          \
+        return Tube_is_pure_n(tube, N);                                        \
+    }                                                                          \
+    static bool Tube_is_one_color_##N(const Tube *tube)                        \
+    {                                                                          \
+        return Tube_is_one_color_n(tube, N);                                   \
+    }                                                                          \
+    static const TubeOps TUBE_OPS_##N = {                                      \
+      .num_slots = N,                                                          \
+      .pour = &Tube_pour_##N,                                                  \
+      .revert = &Tube_revert_##N,                                              \
+      .is_pure = &Tube_is_pure_##N,                                            \
+      .is_one_color = &Tube_is_one_color_##N,                                  \
+    }
+
+TUBE_DEFINE_KERNELS(2);
+TUBE_DEFINE_KERNELS(3);
+TUBE_DEFINE_KERNELS(4);
+TUBE_DEFINE_KERNELS(5);
+TUBE_DEFINE_KERNELS(6);
+TUBE_DEFINE_KERNELS(7);
+TUBE_DEFINE_KERNELS(8);
+
+/**
+ * Generic kernels for all other numbers of slots.
+ */
+static const TubeOps TUBE_OPS_GENERIC = {
+  .num_slots = 0,
+  .pour = &Tube_pour,
+  .revert = &Tube_revert,
+  .is_pure = &Tube_is_pure,
+  .is_one_color = &Tube_is_one_color,
+};
+
+const TubeOps *
+TubeOps_get(int num_slots)
+{
+    switch (num_slots) {
+    case 2:
+        return &TUBE_OPS_2;
+    case 3:
+        return &TUBE_OPS_3;
+    case 4:
+        return &TUBE_OPS_4;
+    case 5:
+        return &TUBE_OPS_5;
+    case 6:
+        return &TUBE_OPS_6;
+    case 7:
+        return &TUBE_OPS_7;
+    case 8:
+        return &TUBE_OPS_8;
+    default:
+        return &TUBE_OPS_GENERIC;
+    }
+}
@@ -70,6 +70,37 @@ Tube_clear(Tube *tube);
 int
 Tube_add_color(Tube *tube, int color);
 
+/**
+ * Writes topmost ColorChunk of `tube` to ColorChunk pointed to by `p_chunk`
+ * (color EMPTY_COLOR_INDEX if `tube` is empty).
+ *
+ * @param[in] tube Tube to check
+ * @param[out] p_chunk pointer to ColorChunk to write result to
+ */
+void
+Tube_get_top_chunk(const Tube *tube, ColorChunk *p_chunk);
+
+/**
+ * Reveals topmost chunk of `tube`: a hidden slot becomes visible as soon as it
+ * belongs to the topmost chunk (so only visible slots are ever poured).
+ *
+ * @param[in,out] tube Tube to reveal top of
+ *
+ * @return Number of slots revealed
+ */
+int
+Tube_reveal(Tube *tube);
+
+/**
+ * Returns number of free (empty) slots of `tube`.
+ *
+ * @param[in] tube Tube to check
+ *
+ * @return Number of free slots
+ */
+int
+Tube_count_free(const Tube *tube);
+
 /**
  * Tries to pour contents of `tube_src` to `tube_dst` and writes moved chunk to
  * `p_chunk_log` if successful.
@@ -114,4 +145,29 @@ Tube_is_pure(const Tube *tube);
 bool
 Tube_is_one_color(const Tube *tube);
 
+/**
+ * Table of tube kernels for a fixed number of slots. For common numbers of
+ * slots, these are specialized with compile-time constant sizes (and thus fully
+ * unrolled), for all other numbers they fall back to the generic functions
+ * above.
+ */
+typedef struct {
+    int num_slots; /* 0 for generic kernels */
+    int (*pour)(Tube *tube_src, Tube *tube_dst, ColorChunk *p_chunk);
+    void (*revert)(Tube *tube_src, Tube *tube_dst, const ColorChunk *p_chunk);
+    bool (*is_pure)(const Tube *tube);
+    bool (*is_one_color)(const Tube *tube);
+} TubeOps;
+
+/**
+ * Returns the table of tube kernels suited best for tubes with `num_slots`
+ * slots (specialized for 2 to 8 slots, generic otherwise).
+ *
+ * @param[in] num_slots number of slots per tube
+ *
+ * @return Pointer to static TubeOps table
+ */
+const TubeOps *
+TubeOps_get(int num_slots);
+
 #endif /* TUBE_H_INCLUDED */
@@ -11,6 +11,17 @@
 
 #define EMPTY_COLOR_INDEX -1
 
+/**
+ * Forces inlining of (small) functions where the compiler supports it.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define ALWAYS_INLINE __forceinline
+#else
+#define ALWAYS_INLINE inline
+#endif
+
 /**
  * Error codes/return values of functions.
  */
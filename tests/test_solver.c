@@ -0,0 +1,622 @@
+/** test_solver.c
+ *
+ * 'tubes-test-solver': regression tests of the solver of 'tubes' (run by
+ * 'ctest'). Prints every failed check and exits with failure if there is any.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "gameinfo.h"
+#include "input.h"
+#include "rng.h"
+#include "segment.h"
+#include "solver.h"
+#include "tube.h"
+#include "util.h"
+
+#define TEST_NUM_TUBES 4
+#define TEST_NUM_STEPS 1000
+
+/**
+ * Counts failed check `cond` (and prints it with its line).
+ */
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            fprintf(stderr, "%s:%i: check failed: %s\n", __FILE__, __LINE__,  \
+                    #cond);                                                    \
+            ++num_failed;                                                      \
+        }                                                                      \
+    } while (0)
+
+static int num_failed = 0;
+
+/**
+ * Creates game from single line `line` in the row format.
+ *
+ * @param[in] line null-terminated line
+ *
+ * @return Pointer to newly allocated GameInfo object
+ */
+static GameInfo *
+_create(const char *line)
+{
+    GameInfo *info = GameInfo_create_from_line(line, strlen(line));
+    if (info == NULL) {
+        fprintf(stderr, "Invalid game: '%s'\n", line);
+        exit(EXIT_FAILURE);
+    }
+    return info;
+}
+
+/**
+ * An already solved board is solved with 0 moves.
+ */
+static void
+test_solved_root(void)
+{
+    GameInfo *info = _create("0 0 0 | 1 1 1 | -1 -1 -1");
+    ActionLog *log = ActionLog_create();
+    SolverResult result;
+    CHECK(GameInfo_find_solution(info, NULL, log, NULL, &result)
+          == SOLVER_SOLVED);
+    CHECK(result.num_moves == 0);
+    CHECK(log->counter == 0);
+    ActionLog_destroy(log);
+    GameInfo_destroy(info);
+}
+
+/**
+ * Solving a solved board must not mark the (common) hash of all solved boards
+ * as dead, so a board one move from a win stays solvable on the same context.
+ */
+static void
+test_dead_table_keeps_goal(void)
+{
+    GameInfo *near = _create("0 0 0 | 1 1 -1 | 1 -1 -1");
+    GameInfo *solved = _create("0 0 0 | 1 1 1 | -1 -1 -1");
+    SolverContext *ctx = SolverContext_create();
+    ctx->dead = DeadTable_create();
+    SolverResult result;
+
+    CHECK(GameInfo_find_solution(near, ctx, NULL, NULL, &result)
+          == SOLVER_SOLVED);
+    GameInfo_revert_all(near, ctx->log);
+    CHECK(GameInfo_find_solution(solved, ctx, NULL, NULL, &result)
+          == SOLVER_SOLVED);
+    CHECK(GameInfo_find_solution(near, ctx, NULL, NULL, &result)
+          == SOLVER_SOLVED);
+    CHECK(result.num_moves == 1);
+    CHECK(ctx->dead->size == 0);
+
+    DeadTable_destroy(ctx->dead);
+    SolverContext_destroy(ctx);
+    GameInfo_destroy(solved);
+    GameInfo_destroy(near);
+}
+
+/**
+ * An unsolvable board is learned as dead and refuted right away afterwards.
+ */
+static void
+test_dead_table_learns(void)
+{
+    GameInfo *info = _create("2 2 1 | 2 0 0 | 1 0 1 | -1 -1 -1");
+    SolverContext *ctx = SolverContext_create();
+    ctx->dead = DeadTable_create();
+    SolverResult result;
+
+    CHECK(GameInfo_find_solution(info, ctx, NULL, NULL, &result)
+          == SOLVER_UNSOLVED);
+    CHECK(ctx->dead->size > 0);
+    CHECK(GameInfo_find_solution(info, ctx, NULL, NULL, &result)
+          == SOLVER_UNSOLVED);
+    CHECK(result.num_nodes == 1);
+
+    DeadTable_destroy(ctx->dead);
+    SolverContext_destroy(ctx);
+    GameInfo_destroy(info);
+}
+
+/**
+ * Dead ends are learned even by an aborted search, so the next search of the
+ * same board expands fewer nodes.
+ */
+static void
+test_dead_table_learns_dead_ends(void)
+{
+    GameInfo *info = _create("2 2 1 | 2 0 0 | 1 0 1 | -1 -1 -1");
+    SolverContext *ctx = SolverContext_create();
+    const SolverLimits limits = {.max_nodes = 4};
+    SolverResult result;
+
+    CHECK(GameInfo_find_solution(info, ctx, NULL, NULL, &result)
+          == SOLVER_UNSOLVED);
+    const long num_nodes = result.num_nodes;
+    ctx->dead = DeadTable_create();
+    CHECK(GameInfo_find_solution(info, ctx, NULL, &limits, &result)
+          == SOLVER_ABORTED);
+    CHECK(ctx->dead->size > 0);
+    CHECK(GameInfo_find_solution(info, ctx, NULL, NULL, &result)
+          == SOLVER_UNSOLVED);
+    CHECK(result.num_nodes < num_nodes);
+
+    DeadTable_destroy(ctx->dead);
+    SolverContext_destroy(ctx);
+    GameInfo_destroy(info);
+}
+
+/**
+ * A binary solution is read back move by move (for both sizes of ActionCode).
+ */
+static void
+test_solution_round_trip(void)
+{
+    const int num_tubes[] = {5, 300};
+    for (int k = 0; k < 2; ++k) {
+        FILE *file = tmpfile();
+        SolutionWriter *writer
+          = SolutionWriter_create(file, SOLUTION_BINARY, num_tubes[k], 0);
+        for (int i = 0; i < 1000; ++i) {
+            const Action action
+              = {.i_src = i % num_tubes[k], .i_dst = (7 * i) % num_tubes[k]};
+            SolutionWriter_write(writer, &action);
+        }
+        SolutionWriter_destroy(writer);
+
+        rewind(file);
+        SolutionReader *reader = SolutionReader_create(file);
+        CHECK(reader != NULL && reader->num_tubes == num_tubes[k]);
+        Action action;
+        int num_moves = 0;
+        while (reader != NULL
+               && SolutionReader_read(reader, &action) == TUBE_SUCCESS) {
+            CHECK(action.i_src == num_moves % num_tubes[k]);
+            CHECK(action.i_dst == (7 * num_moves) % num_tubes[k]);
+            ++num_moves;
+        }
+        CHECK(num_moves == 1000);
+        SolutionReader_destroy(reader);
+        fclose(file);
+    }
+}
+
+/**
+ * Returns if tubes `a` and `b` hold the same colors.
+ *
+ * @param[in] a first tube
+ * @param[in] b second tube
+ *
+ * @return Same colors?
+ */
+static bool
+_is_same_tube(const Tube *a, const Tube *b)
+{
+    for (int i = 0; i < a->num_slots; ++i) {
+        if (a->slots[i].color != b->slots[i].color) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * The specialized tube kernels behave like the generic ones on random pours,
+ * reverts and checks (for every specialized number of slots).
+ */
+static void
+test_tube_kernels(void)
+{
+    const TubeOps *const generic = TubeOps_get(0);
+    Rng rng;
+    Rng_seed(&rng, 42);
+    for (int num_slots = 2; num_slots <= 8; ++num_slots) {
+        const TubeOps *const ops = TubeOps_get(num_slots);
+        CHECK(ops->num_slots == num_slots);
+        Tube *tubes[TEST_NUM_TUBES];
+        Tube *tubes_generic[TEST_NUM_TUBES];
+        for (int i = 0; i < TEST_NUM_TUBES; ++i) {
+            tubes[i] = Tube_create(num_slots);
+            tubes_generic[i] = Tube_create(num_slots);
+            const int num_filled = (int) Rng_below(&rng, num_slots + 1);
+            for (int j = 0; j < num_filled; ++j) {
+                const int color = (int) Rng_below(&rng, 3);
+                Tube_add_color(tubes[i], color);
+                Tube_add_color(tubes_generic[i], color);
+            }
+        }
+
+        Action moves[TEST_NUM_STEPS];
+        int num_moves = 0;
+        for (int step = 0; step < TEST_NUM_STEPS; ++step) {
+            if (num_moves > 0 && Rng_below(&rng, 3) == 0) {
+                const Action *const move = &moves[--num_moves];
+                ops->revert(
+                  tubes[move->i_src], tubes[move->i_dst], &move->chunk
+                );
+                generic->revert(
+                  tubes_generic[move->i_src], tubes_generic[move->i_dst],
+                  &move->chunk
+                );
+            } else {
+                const int i_src = (int) Rng_below(&rng, TEST_NUM_TUBES);
+                const int i_dst = (i_src + 1 + (int) Rng_below(
+                                                 &rng, TEST_NUM_TUBES - 1
+                                               ))
+                                  % TEST_NUM_TUBES;
+                ColorChunk chunk = {0};
+                ColorChunk chunk_generic = {0};
+                const int res = ops->pour(tubes[i_src], tubes[i_dst], &chunk);
+                CHECK(res
+                      == generic->pour(
+                        tubes_generic[i_src], tubes_generic[i_dst],
+                        &chunk_generic
+                      ));
+                CHECK(chunk.color == chunk_generic.color);
+                CHECK(chunk.count == chunk_generic.count);
+                if (res == TUBE_SUCCESS) {
+                    moves[num_moves++] = (Action){
+                      .i_src = i_src, .i_dst = i_dst, .chunk = chunk
+                    };
+                }
+            }
+            for (int i = 0; i < TEST_NUM_TUBES; ++i) {
+                CHECK(_is_same_tube(tubes[i], tubes_generic[i]) == true);
+                CHECK(ops->is_pure(tubes[i])
+                      == generic->is_pure(tubes_generic[i]));
+                CHECK(ops->is_one_color(tubes[i])
+                      == generic->is_one_color(tubes_generic[i]));
+            }
+        }
+
+        for (int i = 0; i < TEST_NUM_TUBES; ++i) {
+            Tube_destroy(tubes[i]);
+            Tube_destroy(tubes_generic[i]);
+        }
+    }
+}
+
+/**
+ * Parses `text` with Input_parse() and checks error code `code` and line
+ * `line` (and the number of tubes `num_tubes` on success).
+ *
+ * @param[in] text null-terminated input
+ * @param[in] code expected input error enumerator
+ * @param[in] line expected line of error
+ * @param[in] num_tubes expected number of tubes (if valid)
+ */
+static void
+_check_parse(const char *text, int code, int line, int num_tubes)
+{
+    InputError error;
+    Input *input = Input_parse(text, strlen(text), &error);
+    CHECK(error.code == code);
+    CHECK(error.line == line);
+    CHECK((input != NULL) == (code == INPUT_OK));
+    if (input != NULL) {
+        CHECK(input->num_tubes == num_tubes);
+    }
+    if (error.code != code || error.line != line) {
+        fprintf(stderr, "  input: '%s'\n", text);
+    }
+    Input_destroy(input);
+}
+
+/**
+ * The parser reports the kind and line of errors in the input file format.
+ */
+static void
+test_input_errors(void)
+{
+    InputError error;
+    const char *const text = "0 0\n1 1 1\n-1 -1\n";
+    CHECK(Input_parse(text, strlen(text), &error) == NULL);
+    CHECK(error.code == INPUT_ERROR_NUM_SLOTS);
+    CHECK(error.line == 2);
+    CHECK(error.expected == 2 && error.got == 3);
+
+    _check_parse("0 0 0\n1 x 1\n-1 -1 -1\n", INPUT_ERROR_SYNTAX, 2, 0);
+    _check_parse("0 0 0\n1 - 1\n-1 -1 -1\n", INPUT_ERROR_SYNTAX, 2, 0);
+    _check_parse(
+      "# game 1\n0 0 0 # first tube\n\n1 1 1\n#\n-1 -1 -1\n", INPUT_OK, 0, 3
+    );
+    _check_parse("0 1\n1 0\n-1 -1", INPUT_OK, 0, 3);
+    _check_parse("0 1\n1 0\n-1 -1 -1", INPUT_ERROR_NUM_SLOTS, 3, 0);
+    _check_parse("0 0\n0 1\n-1 -1\n", INPUT_ERROR_SANITY, 0, 0);
+    _check_parse("# only a comment\n", INPUT_ERROR_SANITY, 0, 0);
+}
+
+/**
+ * Returns size of file `filename`.
+ *
+ * @param[in] filename name of file
+ *
+ * @return Size of file in bytes (-1 on error)
+ */
+static long
+_file_size(const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+/**
+ * Appends record `record` to segment `filename`, opened (and resumed) with a
+ * fresh IdSet `done`.
+ *
+ * @param[in] filename name of segment file
+ * @param[in] record record to append (or NULL)
+ * @param[out] done IdSet to insert ids of existing records into
+ */
+static void
+_append_record(const char *filename, const char *record, IdSet *done)
+{
+    FILE *out = Segment_open(filename, 0, 1, "test", done);
+    CHECK(out != NULL);
+    if (out != NULL) {
+        if (record != NULL) {
+            Segment_write_record(out, record, strlen(record));
+        }
+        fclose(out);
+    }
+}
+
+/**
+ * Appends raw text `text` to file `filename`.
+ *
+ * @param[in] filename name of file
+ * @param[in] text text to append
+ */
+static void
+_append_text(const char *filename, const char *text)
+{
+    FILE *out = fopen(filename, "a");
+    fputs(text, out);
+    fclose(out);
+}
+
+/**
+ * A resumed segment keeps the ids of all valid records and cuts off a torn
+ * line or a line with a bad checksum (and everything after it).
+ */
+static void
+test_segment_resume(void)
+{
+    char dir[] = "/tmp/tubes-test-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        CHECK(!"mkdtemp");
+        return;
+    }
+    char *filename = Segment_filename(dir, 0, 1);
+    IdSet *done = IdSet_create();
+    _append_record(filename, "{\"id\":0}", done);
+    _append_record(filename, "{\"id\":1}", done);
+    _append_record(filename, "{\"id\":2}", done);
+    const long size = _file_size(filename);
+
+    /* Torn line (no newline) */
+    _append_text(filename, "01234567 {\"id\":3");
+    IdSet_destroy(done);
+    done = IdSet_create();
+    _append_record(filename, NULL, done);
+    CHECK(IdSet_contains(done, 0) && IdSet_contains(done, 1)
+          && IdSet_contains(done, 2));
+    CHECK(IdSet_contains(done, 3) == false);
+    CHECK(_file_size(filename) == size);
+
+    /* Bad checksum (the valid record after it is cut off as well) */
+    _append_record(filename, "{\"id\":4}", done);
+    const long size_4 = _file_size(filename);
+    _append_text(filename, "00000000 {\"id\":5}\n");
+    FILE *out = fopen(filename, "a");
+    Segment_write_record(out, "{\"id\":6}", strlen("{\"id\":6}"));
+    fclose(out);
+    IdSet_destroy(done);
+    done = IdSet_create();
+    _append_record(filename, NULL, done);
+    CHECK(IdSet_contains(done, 2) && IdSet_contains(done, 4));
+    CHECK(IdSet_contains(done, 5) == false);
+    CHECK(IdSet_contains(done, 6) == false);
+    CHECK(_file_size(filename) == size_4);
+
+    /* Header of other shard */
+    CHECK(Segment_open(filename, 1, 2, "test", done) == NULL);
+
+    IdSet_destroy(done);
+    remove(filename);
+    free(filename);
+    rmdir(dir);
+}
+
+/**
+ * Returns if `log` solves `info` (which is left in its initial state).
+ *
+ * @param[in] info GameInfo object to solve
+ * @param[in] log ActionLog with moves
+ *
+ * @return Does `log` solve `info`?
+ */
+static bool
+_is_solution(GameInfo *info, const ActionLog *log)
+{
+    ActionLog *replay = ActionLog_create();
+    bool is_valid = true;
+    for (int i = 0; i < log->counter && is_valid == true; ++i) {
+        Action action = log->actions[i];
+        is_valid = info->ops->pour(
+                     info->tubes[action.i_src], info->tubes[action.i_dst],
+                     &action.chunk
+                   )
+                   == TUBE_SUCCESS;
+        if (is_valid == true) {
+            ActionLog_push_back(replay, &action);
+        }
+    }
+    is_valid = is_valid && GameInfo_is_solved(info);
+    GameInfo_revert_all(info, replay);
+    ActionLog_destroy(replay);
+    return is_valid;
+}
+
+/**
+ * Solves `info` and stores the verdict in `cache`.
+ *
+ * @param[in] info GameInfo object to solve
+ * @param[in,out] cache SolutionCache to store in
+ *
+ * @return Solver status enumerator
+ */
+static int
+_solve_and_store(GameInfo *info, SolutionCache *cache)
+{
+    SolverContext *ctx = SolverContext_create();
+    ActionLog *log = ActionLog_create();
+    SolverResult result;
+    if (GameInfo_find_solution(info, ctx, log, NULL, &result)
+        == SOLVER_SOLVED) {
+        GameInfo_revert_all(info, ctx->log);
+    }
+    CHECK(GameInfo_store_solution(info, cache, log, &result) == TUBE_SUCCESS);
+    ActionLog_destroy(log);
+    SolverContext_destroy(ctx);
+    return result.status;
+}
+
+/**
+ * Returns the outcome of looking up `info` in a freshly opened cache
+ * `filename` (-1 on a miss) and checks a cached solution by replaying it.
+ *
+ * @param[in] info GameInfo object to look up
+ * @param[in] filename name of cache file
+ *
+ * @return Solver status enumerator or -1
+ */
+static int
+_lookup(GameInfo *info, const char *filename)
+{
+    SolutionCache *cache = SolutionCache_open(filename);
+    CHECK(cache != NULL);
+    if (cache == NULL) {
+        return -1;
+    }
+    ActionLog *log = ActionLog_create();
+    SolverResult result;
+    int status = -1;
+    if (GameInfo_lookup_solution(info, cache, log, &result) == true) {
+        status = result.status;
+        CHECK(result.num_moves == log->counter);
+        CHECK(status != SOLVER_SOLVED || _is_solution(info, log) == true);
+    }
+    ActionLog_destroy(log);
+    SolutionCache_close(cache);
+    return status;
+}
+
+/**
+ * Verdicts survive reopening of the cache, also for boards that only differ
+ * by names of colors and order of tubes. A torn record is skipped (and
+ * overwritten), and records of another solver revision are never returned.
+ */
+static void
+test_cache(void)
+{
+    char dir[] = "/tmp/tubes-test-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        CHECK(!"mkdtemp");
+        return;
+    }
+    char filename[sizeof dir + 16];
+    snprintf(filename, sizeof filename, "%s/cache", dir);
+    GameInfo *solvable
+      = _create("0 2 -1 | 1 1 2 | -1 -1 -1 | 3 3 0 | 2 -1 -1 | 0 3 1");
+    GameInfo *renamed
+      = _create("2 2 3 | 3 2 0 | -1 -1 -1 | 1 -1 -1 | 3 1 -1 | 0 0 1");
+    GameInfo *unsolvable = _create("2 2 1 | 2 0 0 | 1 0 1 | -1 -1 -1");
+    GameInfo *other = _create("0 0 0 | 1 1 -1 | 1 -1 -1");
+
+    SolutionCache *cache = SolutionCache_open(filename);
+    CHECK(cache != NULL);
+    if (cache == NULL) {
+        return;
+    }
+    CHECK(_solve_and_store(solvable, cache) == SOLVER_SOLVED);
+    CHECK(_solve_and_store(unsolvable, cache) == SOLVER_UNSOLVED);
+    SolutionCache_close(cache);
+    CHECK(_lookup(solvable, filename) == SOLVER_SOLVED);
+    CHECK(_lookup(renamed, filename) == SOLVER_SOLVED);
+    CHECK(_lookup(unsolvable, filename) == SOLVER_UNSOLVED);
+    CHECK(_lookup(other, filename) == -1);
+
+    /* Torn record at the end */
+    const long size = _file_size(filename);
+    _append_text(filename, "\x40\x00\x00\x00torn");
+    CHECK(_lookup(solvable, filename) == SOLVER_SOLVED);
+    cache = SolutionCache_open(filename);
+    CHECK(_solve_and_store(other, cache) == SOLVER_SOLVED);
+    SolutionCache_close(cache);
+    CHECK(_file_size(filename) > size);
+    CHECK(_lookup(other, filename) == SOLVER_SOLVED);
+    CHECK(_lookup(unsolvable, filename) == SOLVER_UNSOLVED);
+
+    /* Record of another solver revision (first one, with valid checksum) */
+    FILE *file = fopen(filename, "r+b");
+    unsigned char header[CACHE_HEADER_SIZE + 20];
+    CHECK(fread(header, 1, sizeof header, file) == sizeof header);
+    const unsigned char *const record = header + CACHE_HEADER_SIZE;
+    const long len = record[0] | (record[1] << 8) | (record[2] << 16);
+    unsigned char *bytes = malloc(len);
+    fseek(file, CACHE_HEADER_SIZE, SEEK_SET);
+    CHECK(fread(bytes, 1, len, file) == (size_t) len);
+    bytes[16] ^= 0xff;
+    uint64_t hash = 0xcbf29ce484222325;
+    for (long i = 8; i < len; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3;
+    }
+    for (int i = 0; i < 4; ++i) {
+        bytes[4 + i] = (unsigned char) (hash >> (8 * i));
+    }
+    fseek(file, CACHE_HEADER_SIZE, SEEK_SET);
+    fwrite(bytes, 1, len, file);
+    fclose(file);
+    free(bytes);
+    CHECK(_lookup(solvable, filename) == -1);
+    CHECK(_lookup(unsolvable, filename) == SOLVER_UNSOLVED);
+
+    GameInfo_destroy(other);
+    GameInfo_destroy(unsolvable);
+    GameInfo_destroy(renamed);
+    GameInfo_destroy(solvable);
+    remove(filename);
+    rmdir(dir);
+}
+
+int
+main(void)
+{
+    test_solved_root();
+    test_dead_table_keeps_goal();
+    test_dead_table_learns();
+    test_dead_table_learns_dead_ends();
+    test_solution_round_trip();
+    test_tube_kernels();
+    test_input_errors();
+    test_segment_resume();
+    test_cache();
+    if (num_failed > 0) {
+        fprintf(stderr, "%i check(s) failed!\n", num_failed);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}